@@ -1,8 +1,61 @@
 #include "Emitter.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include "stats/Trace.h"
 using namespace wasmdec;
 using namespace std;
 
-Emitter::Emitter() { }
+namespace {
+	// Operators without a C equivalent, written by both the preamble and the runtime
+	const char* bitOperations =
+		"// Bit operations of wasm, for 32 and 64 bit operands. Each one compiles to a\n"
+		"// single instruction where the target has it (rol, ror, lzcnt, tzcnt, popcnt);\n"
+		"// clz and ctz of 0 are the operand's width, as in wasm.\n"
+		"static inline int32_t wasm_i32_rotl(int32_t value, int32_t count) {\n"
+		"\tuint32_t v = (uint32_t)value, n = (uint32_t)count & 31;\n"
+		"\treturn (int32_t)((v << n) | (v >> ((32 - n) & 31)));\n"
+		"}\n"
+		"static inline int32_t wasm_i32_rotr(int32_t value, int32_t count) {\n"
+		"\tuint32_t v = (uint32_t)value, n = (uint32_t)count & 31;\n"
+		"\treturn (int32_t)((v >> n) | (v << ((32 - n) & 31)));\n"
+		"}\n"
+		"static inline int64_t wasm_i64_rotl(int64_t value, int64_t count) {\n"
+		"\tuint64_t v = (uint64_t)value, n = (uint64_t)count & 63;\n"
+		"\treturn (int64_t)((v << n) | (v >> ((64 - n) & 63)));\n"
+		"}\n"
+		"static inline int64_t wasm_i64_rotr(int64_t value, int64_t count) {\n"
+		"\tuint64_t v = (uint64_t)value, n = (uint64_t)count & 63;\n"
+		"\treturn (int64_t)((v >> n) | (v << ((64 - n) & 63)));\n"
+		"}\n"
+		"static inline int32_t wasm_i32_clz(int32_t value) {\n"
+		"\treturn value ? __builtin_clz((uint32_t)value) : 32;\n"
+		"}\n"
+		"static inline int32_t wasm_i32_ctz(int32_t value) {\n"
+		"\treturn value ? __builtin_ctz((uint32_t)value) : 32;\n"
+		"}\n"
+		"static inline int32_t wasm_i32_popcnt(int32_t value) {\n"
+		"\treturn __builtin_popcount((uint32_t)value);\n"
+		"}\n"
+		"static inline int64_t wasm_i64_clz(int64_t value) {\n"
+		"\tint count = value ? __builtin_clzll((uint64_t)value) : 64; // An int, or the zero check isn't folded\n"
+		"\treturn count;\n"
+		"}\n"
+		"static inline int64_t wasm_i64_ctz(int64_t value) {\n"
+		"\tint count = value ? __builtin_ctzll((uint64_t)value) : 64;\n"
+		"\treturn count;\n"
+		"}\n"
+		"static inline int64_t wasm_i64_popcnt(int64_t value) {\n"
+		"\treturn __builtin_popcountll((uint64_t)value);\n"
+		"}\n";
+}
+
+Emitter::Emitter() {
+	fd = -1;
+	writeFailed = false;
+	bytesWritten = 0;
+	writeTime = stats::PhaseTime{0, 0, 0};
+}
 void Emitter::preamble() {
 	str <<
 		"/* Preamble: \n"
@@ -16,16 +69,7 @@ void Emitter::preamble() {
 		"// Bit size specific types not declared in stdint.h:\n"
 		"typedef float float32_t;\n"
 		"typedef double float64_t;\n"
-		"// C implementation of WASM expressions:\n"
-		"unsigned int _rotl(const unsigned int value, int shift) {\n"
-		"\tif ((shift &= sizeof(value) * 8 - 1) == 0)\n"
-		"\t\treturn value;\n"
-		"\treturn (value << shift) | (value >> (sizeof(value)*8 - shift));\n"
-		"}\n"
-		"unsigned int _rotr(const unsigned int value, int shift) {\n"
-	    "\tif ((shift &= sizeof(value) * 8 - 1) == 0)\n"
-	    "\t\treturn value;\n"
-	    "\treturn (value >> shift) | (value << (sizeof(value)*8 - shift));\n}\n"
+		<< bitOperations <<
 	    "#define MAX(a,b) ((a) > (b) ? a : b)\n"
 		"#define MIN(a,b) ((a) < (b) ? a : b)\n"
 		"// Host functions: used to request information from host machine.\n"
@@ -35,6 +79,276 @@ void Emitter::preamble() {
 		"extern int32_t host_get_page_size(void);\n"
 		"// End of preamble\n\n";
 }
+void Emitter::runtime() {
+	// Support code of --compilable output, see src/native
+	str <<
+		"/* Runtime of the compilable output of wasmdec.\n"
+		"\twasm_init() sets up the module and must be called before any export. The linear\n"
+		"\tmemory is the byte array wasm_memory, accessed in little endian order. Define\n"
+		"\tWASM_TRAP(reason) before this point to handle traps; it must not return, and it\n"
+		"\tis also called from the SIGSEGV handler for out of bounds accesses. Define\n"
+		"\tWASM_NO_GUARD_PAGES to check every access instead of reserving guard pages, and\n"
+		"\tWASM_NO_COUNTED_LOOPS to run counted loops in their general form only.\n"
+		"*/\n"
+		"#include <stdint.h>\n"
+		"#include <stdlib.h>\n"
+		"#include <string.h>\n"
+		"#include <math.h>\n"
+		"#ifndef WASM_TRAP\n"
+		"#include <stdio.h>\n"
+		"#define WASM_TRAP(reason) (fprintf(stderr, \"wasm trap: %s\\n\", reason), abort())\n"
+		"#endif\n"
+		"#ifdef WASM_NO_COUNTED_LOOPS\n"
+		"#define WASM_COUNTED_LOOPS 0\n"
+		"#else\n"
+		"#define WASM_COUNTED_LOOPS 1\n"
+		"#endif\n"
+		"#define WASM_PAGE_SIZE 65536\n"
+		"typedef void (*wasm_funcptr_t)(void);\n"
+		"static uint8_t* wasm_memory;\n"
+		"static uint32_t wasm_memory_pages;\n"
+		"static uint32_t wasm_memory_max_pages;\n"
+		"// Functions of the table, with the signature calls through it must have; empty\n"
+		"// entries have no function\n"
+		"typedef struct {\n"
+		"\twasm_funcptr_t function;\n"
+		"\tuint32_t signature;\n"
+		"} wasm_table_entry_t;\n"
+		"static wasm_table_entry_t* wasm_table;\n"
+		"static uint32_t wasm_table_size;\n"
+		"__attribute__((noreturn, unused)) static void wasm_trap(const char* reason) {\n"
+		"\tWASM_TRAP(reason);\n"
+		"\tabort();\n"
+		"}\n"
+		"__attribute__((unused)) static int64_t wasm_unsupported(void) {\n"
+		"\twasm_trap(\"unsupported operation\");\n"
+		"}\n"
+		"// Table entry of a function left out of the output; nothing emitted calls it\n"
+		"__attribute__((unused)) static void wasm_pruned_function(void) {\n"
+		"\twasm_trap(\"call to a pruned function\");\n"
+		"}\n"
+		"// Memory\n"
+		"#if !defined(WASM_NO_GUARD_PAGES) && UINTPTR_MAX > 0xffffffffu\n"
+		"/* The memory is a reservation that covers every address a wasm32 access can form,\n"
+		"\tptr + offset + size, so it never needs bounds checks: pages past the current size\n"
+		"\tare inaccessible and the faults they cause become traps. Growing the memory makes\n"
+		"\tmore of the reservation accessible, so wasm_memory never moves. */\n"
+		"#include <signal.h>\n"
+		"#include <sys/mman.h>\n"
+		"#define WASM_RESERVATION ((size_t)2 << 32 | 2 * WASM_PAGE_SIZE)\n"
+		"// Handlers of SIGSEGV and SIGBUS from before wasm_memory_init, which get the faults\n"
+		"// outside the reservation\n"
+		"static struct sigaction wasm_previous_segv, wasm_previous_bus;\n"
+		"static int wasm_fault_installed;\n"
+		"static void wasm_fault(int signal, siginfo_t* info, void* context) {\n"
+		"\tuint8_t* address = (uint8_t*)info->si_addr;\n"
+		"\tif (wasm_memory && address >= wasm_memory && address < wasm_memory + WASM_RESERVATION) {\n"
+		"\t\twasm_trap(\"out of bounds memory access\");\n"
+		"\t}\n"
+		"\tstruct sigaction* previous = signal == SIGBUS ? &wasm_previous_bus : &wasm_previous_segv;\n"
+		"\tif (previous->sa_flags & SA_SIGINFO) {\n"
+		"\t\tprevious->sa_sigaction(signal, info, context);\n"
+		"\t} else if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN) {\n"
+		"\t\tprevious->sa_handler(signal);\n"
+		"\t} else {\n"
+		"\t\t// Restore the previous action: a fault happens again once this returns, and\n"
+		"\t\t// a signal sent by a process is raised again\n"
+		"\t\tsigaction(signal, previous, NULL);\n"
+		"\t\tif (info->si_code <= 0) {\n"
+		"\t\t\traise(signal);\n"
+		"\t\t}\n"
+		"\t}\n"
+		"}\n"
+		"static void wasm_memory_init(uint32_t pages, uint32_t maxPages) {\n"
+		"\tstatic uint8_t faultStack[1 << 16]; // Traps may be raised on an overflowed stack\n"
+		"\tstack_t stack;\n"
+		"\tstruct sigaction handler;\n"
+		"\twasm_memory_pages = pages;\n"
+		"\twasm_memory_max_pages = maxPages;\n"
+		"\twasm_memory = (uint8_t*)mmap(NULL, WASM_RESERVATION, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);\n"
+		"\tif (wasm_memory == (uint8_t*)MAP_FAILED) {\n"
+		"\t\twasm_memory = NULL;\n"
+		"\t\twasm_trap(\"out of memory\");\n"
+		"\t}\n"
+		"\tif (pages && mprotect(wasm_memory, (size_t)pages * WASM_PAGE_SIZE, PROT_READ | PROT_WRITE)) {\n"
+		"\t\twasm_trap(\"out of memory\");\n"
+		"\t}\n"
+		"\tstack.ss_sp = faultStack;\n"
+		"\tstack.ss_size = sizeof(faultStack);\n"
+		"\tstack.ss_flags = 0;\n"
+		"\tsigaltstack(&stack, NULL);\n"
+		"\tmemset(&handler, 0, sizeof(handler));\n"
+		"\thandler.sa_sigaction = wasm_fault;\n"
+		"\thandler.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;\n"
+		"\tsigemptyset(&handler.sa_mask);\n"
+		"\tif (!wasm_fault_installed) {\n"
+		"\t\tsigaction(SIGSEGV, &handler, &wasm_previous_segv);\n"
+		"\t\tsigaction(SIGBUS, &handler, &wasm_previous_bus);\n"
+		"\t\twasm_fault_installed = 1;\n"
+		"\t}\n"
+		"}\n"
+		"static inline int32_t wasm_grow_memory(int32_t delta) {\n"
+		"\tuint32_t old = wasm_memory_pages;\n"
+		"\tuint64_t pages = (uint64_t)old + (uint32_t)delta;\n"
+		"\tif (pages > wasm_memory_max_pages) {\n"
+		"\t\treturn -1;\n"
+		"\t}\n"
+		"\t// Pages that were never accessible are still zero\n"
+		"\tif (pages > old && mprotect(wasm_memory + (size_t)old * WASM_PAGE_SIZE, (size_t)(pages - old) * WASM_PAGE_SIZE, PROT_READ | PROT_WRITE)) {\n"
+		"\t\treturn -1;\n"
+		"\t}\n"
+		"\twasm_memory_pages = (uint32_t)pages;\n"
+		"\treturn (int32_t)old;\n"
+		"}\n"
+		"#define WASM_ADDRESS(ptr, offset, size) (wasm_memory + (uint64_t)(ptr) + (offset))\n"
+		"#else\n"
+		"// Without guard pages every access is checked against the current size\n"
+		"static void wasm_memory_init(uint32_t pages, uint32_t maxPages) {\n"
+		"\twasm_memory_pages = pages;\n"
+		"\twasm_memory_max_pages = maxPages;\n"
+		"\twasm_memory = (uint8_t*)calloc(pages ? pages : 1, WASM_PAGE_SIZE);\n"
+		"\tif (!wasm_memory) {\n"
+		"\t\twasm_trap(\"out of memory\");\n"
+		"\t}\n"
+		"}\n"
+		"static inline int32_t wasm_grow_memory(int32_t delta) {\n"
+		"\tuint32_t old = wasm_memory_pages;\n"
+		"\tuint64_t pages = (uint64_t)old + (uint32_t)delta;\n"
+		"\tif (pages > wasm_memory_max_pages) {\n"
+		"\t\treturn -1;\n"
+		"\t}\n"
+		"\tuint8_t* grown = (uint8_t*)realloc(wasm_memory, pages ? pages * WASM_PAGE_SIZE : WASM_PAGE_SIZE);\n"
+		"\tif (!grown) {\n"
+		"\t\treturn -1;\n"
+		"\t}\n"
+		"\tmemset(grown + (uint64_t)old * WASM_PAGE_SIZE, 0, (pages - old) * WASM_PAGE_SIZE);\n"
+		"\twasm_memory = grown;\n"
+		"\twasm_memory_pages = (uint32_t)pages;\n"
+		"\treturn (int32_t)old;\n"
+		"}\n"
+		"static inline uint8_t* wasm_checked_address(uint32_t ptr, uint64_t offset, uint32_t size) {\n"
+		"\tif ((uint64_t)ptr + offset + size > (uint64_t)wasm_memory_pages * WASM_PAGE_SIZE) {\n"
+		"\t\twasm_trap(\"out of bounds memory access\");\n"
+		"\t}\n"
+		"\treturn wasm_memory + (uint64_t)ptr + offset;\n"
+		"}\n"
+		"#define WASM_ADDRESS(ptr, offset, size) wasm_checked_address(ptr, offset, size)\n"
+		"#endif\n"
+		"__attribute__((unused)) static void wasm_memory_copy(uint32_t offset, const char* data, uint32_t size) {\n"
+		"\tif ((uint64_t)offset + size > (uint64_t)wasm_memory_pages * WASM_PAGE_SIZE) {\n"
+		"\t\twasm_trap(\"data segment does not fit in memory\");\n"
+		"\t}\n"
+		"\tmemcpy(wasm_memory + offset, data, size);\n"
+		"}\n"
+		"static inline int32_t wasm_current_memory(void) {\n"
+		"\treturn (int32_t)wasm_memory_pages;\n"
+		"}\n"
+		"// Loads and stores of exactly the accessed width, at ptr + offset without wrapping.\n"
+		"// The offset is 64 bits wide so that counted loops can add their counter to it\n"
+		"#define WASM_LOAD(name, T, M) static inline T name(uint32_t ptr, uint64_t offset) { \\\n"
+		"\tM value; memcpy(&value, WASM_ADDRESS(ptr, offset, sizeof(M)), sizeof(M)); return (T)value; }\n"
+		"#define WASM_STORE(name, T, M) static inline void name(uint32_t ptr, uint64_t offset, T value) { \\\n"
+		"\tM stored = (M)value; memcpy(WASM_ADDRESS(ptr, offset, sizeof(M)), &stored, sizeof(M)); }\n"
+		"WASM_LOAD(wasm_i32_load, int32_t, int32_t)\n"
+		"WASM_LOAD(wasm_i32_load8_s, int32_t, int8_t)\n"
+		"WASM_LOAD(wasm_i32_load8_u, int32_t, uint8_t)\n"
+		"WASM_LOAD(wasm_i32_load16_s, int32_t, int16_t)\n"
+		"WASM_LOAD(wasm_i32_load16_u, int32_t, uint16_t)\n"
+		"WASM_LOAD(wasm_i64_load, int64_t, int64_t)\n"
+		"WASM_LOAD(wasm_i64_load8_s, int64_t, int8_t)\n"
+		"WASM_LOAD(wasm_i64_load8_u, int64_t, uint8_t)\n"
+		"WASM_LOAD(wasm_i64_load16_s, int64_t, int16_t)\n"
+		"WASM_LOAD(wasm_i64_load16_u, int64_t, uint16_t)\n"
+		"WASM_LOAD(wasm_i64_load32_s, int64_t, int32_t)\n"
+		"WASM_LOAD(wasm_i64_load32_u, int64_t, uint32_t)\n"
+		"WASM_LOAD(wasm_f32_load, float, float)\n"
+		"WASM_LOAD(wasm_f64_load, double, double)\n"
+		"WASM_STORE(wasm_i32_store, int32_t, int32_t)\n"
+		"WASM_STORE(wasm_i32_store8, int32_t, uint8_t)\n"
+		"WASM_STORE(wasm_i32_store16, int32_t, uint16_t)\n"
+		"WASM_STORE(wasm_i64_store, int64_t, int64_t)\n"
+		"WASM_STORE(wasm_i64_store8, int64_t, uint8_t)\n"
+		"WASM_STORE(wasm_i64_store16, int64_t, uint16_t)\n"
+		"WASM_STORE(wasm_i64_store32, int64_t, uint32_t)\n"
+		"WASM_STORE(wasm_f32_store, float, float)\n"
+		"WASM_STORE(wasm_f64_store, double, double)\n"
+		"// Table\n"
+		"static void wasm_table_init(uint32_t size) {\n"
+		"\twasm_table_size = size;\n"
+		"\twasm_table = (wasm_table_entry_t*)calloc(size ? size : 1, sizeof(wasm_table_entry_t));\n"
+		"\tif (!wasm_table) {\n"
+		"\t\twasm_trap(\"out of memory\");\n"
+		"\t}\n"
+		"}\n"
+		"__attribute__((unused)) static void wasm_table_set(uint32_t index, wasm_funcptr_t function, uint32_t signature) {\n"
+		"\tif (index >= wasm_table_size) {\n"
+		"\t\twasm_trap(\"table segment does not fit in the table\");\n"
+		"\t}\n"
+		"\twasm_table[index].function = function;\n"
+		"\twasm_table[index].signature = signature;\n"
+		"}\n"
+		"// Function that call_indirect calls, which traps unless it has the call's signature\n"
+		"__attribute__((unused)) static inline wasm_funcptr_t wasm_table_get(uint32_t index, uint32_t signature) {\n"
+		"\tif (index >= wasm_table_size) {\n"
+		"\t\twasm_trap(\"undefined element\");\n"
+		"\t}\n"
+		"\tif (!wasm_table[index].function) {\n"
+		"\t\twasm_trap(\"uninitialized element\");\n"
+		"\t}\n"
+		"\tif (wasm_table[index].signature != signature) {\n"
+		"\t\twasm_trap(\"indirect call signature mismatch\");\n"
+		"\t}\n"
+		"\treturn wasm_table[index].function;\n"
+		"}\n"
+		"// Operators that trap, used unless the output was written with --traps=fast\n"
+		"#define WASM_DIVISION(name, T, U, MIN) \\\n"
+		"\tstatic inline T name##_div_s(T a, T b) { \\\n"
+		"\t\tif (b == 0) wasm_trap(\"integer divide by zero\"); \\\n"
+		"\t\tif (a == MIN && b == -1) wasm_trap(\"integer overflow\"); \\\n"
+		"\t\treturn a / b; } \\\n"
+		"\tstatic inline T name##_div_u(T a, T b) { \\\n"
+		"\t\tif (b == 0) wasm_trap(\"integer divide by zero\"); \\\n"
+		"\t\treturn (T)((U)a / (U)b); } \\\n"
+		"\tstatic inline T name##_rem_s(T a, T b) { \\\n"
+		"\t\tif (b == 0) wasm_trap(\"integer divide by zero\"); \\\n"
+		"\t\treturn b == -1 ? 0 : a % b; } \\\n"
+		"\tstatic inline T name##_rem_u(T a, T b) { \\\n"
+		"\t\tif (b == 0) wasm_trap(\"integer divide by zero\"); \\\n"
+		"\t\treturn (T)((U)a % (U)b); }\n"
+		"WASM_DIVISION(wasm_i32, int32_t, uint32_t, INT32_MIN)\n"
+		"WASM_DIVISION(wasm_i64, int64_t, uint64_t, INT64_MIN)\n"
+		"// Bounds are exclusive and exact in the float type\n"
+		"#define WASM_TRUNC(name, T, C, F, low, high) static inline T name(F value) { \\\n"
+		"\tif (value != value) wasm_trap(\"invalid conversion to integer\"); \\\n"
+		"\tif (!(value > low && value < high)) wasm_trap(\"integer overflow\"); \\\n"
+		"\treturn (T)(C)value; }\n"
+		"WASM_TRUNC(wasm_i32_trunc_s_f32, int32_t, int32_t, float, -2147483904.0f, 2147483648.0f)\n"
+		"WASM_TRUNC(wasm_i32_trunc_u_f32, int32_t, uint32_t, float, -1.0f, 4294967296.0f)\n"
+		"WASM_TRUNC(wasm_i32_trunc_s_f64, int32_t, int32_t, double, -2147483649.0, 2147483648.0)\n"
+		"WASM_TRUNC(wasm_i32_trunc_u_f64, int32_t, uint32_t, double, -1.0, 4294967296.0)\n"
+		"WASM_TRUNC(wasm_i64_trunc_s_f32, int64_t, int64_t, float, -9223373136366403584.0f, 9223372036854775808.0f)\n"
+		"WASM_TRUNC(wasm_i64_trunc_u_f32, int64_t, uint64_t, float, -1.0f, 18446744073709551616.0f)\n"
+		"WASM_TRUNC(wasm_i64_trunc_s_f64, int64_t, int64_t, double, -9223372036854777856.0, 9223372036854775808.0)\n"
+		"WASM_TRUNC(wasm_i64_trunc_u_f64, int64_t, uint64_t, double, -1.0, 18446744073709551616.0)\n"
+		<< bitOperations <<
+		"// min and max propagate NaNs and order -0 below +0\n"
+		"#define WASM_MINMAX(name, T, isMin) static inline T name(T a, T b) { \\\n"
+		"\tif (a != a || b != b) return a + b; \\\n"
+		"\tif (a == b) return (signbit(a) != 0) == isMin ? a : b; \\\n"
+		"\treturn (a < b) == isMin ? a : b; }\n"
+		"WASM_MINMAX(wasm_f32_min, float, 1)\n"
+		"WASM_MINMAX(wasm_f32_max, float, 0)\n"
+		"WASM_MINMAX(wasm_f64_min, double, 1)\n"
+		"WASM_MINMAX(wasm_f64_max, double, 0)\n"
+		"#define WASM_REINTERPRET(name, T, F) static inline T name(F value) { \\\n"
+		"\tT result; memcpy(&result, &value, sizeof(T)); return result; }\n"
+		"WASM_REINTERPRET(wasm_i32_reinterpret_f32, int32_t, float)\n"
+		"WASM_REINTERPRET(wasm_i64_reinterpret_f64, int64_t, double)\n"
+		"WASM_REINTERPRET(wasm_f32_reinterpret_i32, float, int32_t)\n"
+		"WASM_REINTERPRET(wasm_f64_reinterpret_i64, double, int64_t)\n"
+		"// End of runtime\n"
+		"\n";
+}
 stringstream& Emitter::operator<<(string out) {
 	str << out;
 	return str;
@@ -47,4 +361,70 @@ void Emitter::ln() {
 }
 string Emitter::getCode() {
 	return str.str();
+}
+bool Emitter::openFile(string path) {
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	writeFailed = false;
+	bytesWritten = 0;
+	writeTime = stats::PhaseTime{0, 0, 0};
+	return fd >= 0;
+}
+void Emitter::attach(int _fd) {
+	str.str(string());
+	fd = _fd;
+	writeFailed = false;
+	bytesWritten = 0;
+	writeTime = stats::PhaseTime{0, 0, 0};
+}
+void Emitter::flush() {
+	// Only write once a full block has accumulated, so output goes out in large writes
+	if (fd >= 0 && (size_t)str.tellp() >= blockSize) {
+		writeBuffered();
+	}
+}
+bool Emitter::close() {
+	if (fd < 0) {
+		return false;
+	}
+	writeBuffered();
+	double wallStart = stats::wallSeconds(), cpuStart = stats::threadCpuSeconds();
+	if (::close(fd) != 0) {
+		writeFailed = true;
+	}
+	writeTime.wallSeconds += stats::wallSeconds() - wallStart;
+	writeTime.cpuSeconds += stats::threadCpuSeconds() - cpuStart;
+	fd = -1;
+	return !writeFailed;
+}
+bool Emitter::isStreaming() {
+	return fd >= 0;
+}
+void Emitter::writeBuffered() {
+	stats::TraceSpan span("write", "write output");
+	double wallStart = stats::wallSeconds(), cpuStart = stats::threadCpuSeconds();
+	string block = str.str();
+	str.str(string());
+	const char* data = block.data();
+	size_t left = block.size();
+	while (left && !writeFailed) {
+		ssize_t n = ::write(fd, data, left);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			writeFailed = true;
+			break;
+		}
+		data += n;
+		left -= (size_t)n;
+		bytesWritten += (size_t)n;
+	}
+	writeTime.wallSeconds += stats::wallSeconds() - wallStart;
+	writeTime.cpuSeconds += stats::threadCpuSeconds() - cpuStart;
+}
+size_t Emitter::getBytesWritten() {
+	return bytesWritten;
+}
+stats::PhaseTime Emitter::getWriteTime() {
+	return writeTime;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <string>
 #include <iostream>
 #include <iterator>
+#include "stats/PhaseStats.h"
 using namespace std;
 
 namespace wasmdec {
@@ -16,10 +17,29 @@ namespace wasmdec {
 		stringstream& operator<<(string);
 		void comment(string);
 		void preamble();
+		// Types, memory and helpers that compilable output is written against
+		void runtime();
 		void ln();
 		string getCode();
+		// Streaming output: once a file is opened, flush() writes buffered code to it
+		// in large blocks and close() writes whatever is left
+		bool openFile(string);
+		// Streams to an already open descriptor (e.g. a socket) and takes ownership of it
+		void attach(int);
+		void flush();
+		bool close();
+		bool isStreaming();
+		// Totals since the output was opened
+		size_t getBytesWritten();
+		stats::PhaseTime getWriteTime();
 	protected:
+		void writeBuffered();
 		stringstream str;
+		int fd;
+		bool writeFailed;
+		size_t bytesWritten;
+		stats::PhaseTime writeTime; // CPU time is the writing thread's only
+		static const size_t blockSize = 1 << 20;
 	};
 } // namespace wasmdec
 
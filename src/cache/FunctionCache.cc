@@ -0,0 +1,334 @@
+#include "FunctionCache.h"
+#include "../wasm/WasmUtils.h"
+#include "wasm-traversal.h"
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+using namespace wasmdec;
+
+namespace {
+	// Two independent 64 bit lanes: FNV-1a over bytes and a multiply-rotate mix over words
+	struct StructuralHasher {
+		uint64_t fnv = 0xcbf29ce484222325ULL;
+		uint64_t mix = 0x9e3779b97f4a7c15ULL;
+		void add(uint64_t v) {
+			for (int i = 0; i < 8; ++i) {
+				fnv ^= (v >> (i * 8)) & 0xff;
+				fnv *= 0x100000001b3ULL;
+			}
+			mix ^= v;
+			mix *= 0xff51afd7ed558ccdULL;
+			mix = (mix << 31) | (mix >> 33);
+		}
+		void add(const char* s) {
+			if (!s) {
+				add((uint64_t)-1);
+				return;
+			}
+			uint64_t len = 0;
+			for (; s[len]; ++len) {
+				fnv ^= (unsigned char)s[len];
+				fnv *= 0x100000001b3ULL;
+			}
+			add(len);
+		}
+	};
+	// Hashes every field of every node that can show up in the generated C.
+	// Nodes are visited in post order and each one records how many children it has,
+	// so two different trees can't produce the same sequence.
+	struct ExpressionHasher : public PostWalker<ExpressionHasher, UnifiedExpressionVisitor<ExpressionHasher>> {
+		StructuralHasher h;
+		SymbolIndex* natives = nullptr;
+		string nativeName;
+		void addNativeName(Name name) {
+			nativeName.clear();
+			natives->getNativeName(name, nativeName);
+			h.add(nativeName.c_str());
+		}
+		void addNativeGlobal(Name name) {
+			nativeName.clear();
+			natives->getNativeGlobal(name, nativeName);
+			h.add(nativeName.c_str());
+		}
+		void visitExpression(Expression* curr) {
+			h.add((uint64_t)curr->_id);
+			h.add((uint64_t)curr->type);
+			switch (curr->_id) {
+				case Expression::BlockId: {
+					Block* b = curr->cast<Block>();
+					h.add(b->name.str);
+					h.add(b->list.size());
+					break;
+				}
+				case Expression::IfId:
+					h.add(curr->cast<If>()->ifFalse != nullptr);
+					break;
+				case Expression::LoopId:
+					h.add(curr->cast<Loop>()->name.str);
+					break;
+				case Expression::BreakId: {
+					Break* br = curr->cast<Break>();
+					h.add(br->name.str);
+					h.add(br->value != nullptr);
+					h.add(br->condition != nullptr);
+					break;
+				}
+				case Expression::SwitchId: {
+					Switch* sw = curr->cast<Switch>();
+					h.add(sw->targets.size());
+					for (auto& target : sw->targets) {
+						h.add(target.str);
+					}
+					h.add(sw->default_.str);
+					h.add(sw->value != nullptr);
+					break;
+				}
+				case Expression::CallId: {
+					Call* call = curr->cast<Call>();
+					h.add(call->target.str);
+					h.add(call->operands.size());
+					if (natives) {
+						addNativeName(call->target);
+					}
+					break;
+				}
+				case Expression::CallIndirectId: {
+					CallIndirect* ci = curr->cast<CallIndirect>();
+					h.add(ci->fullType.str);
+					h.add(ci->operands.size());
+					if (natives) {
+						FunctionType* ft = natives->getFunctionType(ci->fullType);
+						h.add(ft ? (uint64_t)natives->getSignatureId(ft->result, ft->params) : 0);
+					}
+					break;
+				}
+				case Expression::GetLocalId:
+					h.add(curr->cast<GetLocal>()->index);
+					break;
+				case Expression::SetLocalId:
+					h.add(curr->cast<SetLocal>()->index);
+					break;
+				case Expression::GetGlobalId:
+					h.add(curr->cast<GetGlobal>()->name.str);
+					if (natives) {
+						addNativeGlobal(curr->cast<GetGlobal>()->name);
+					}
+					break;
+				case Expression::SetGlobalId:
+					h.add(curr->cast<SetGlobal>()->name.str);
+					if (natives) {
+						addNativeGlobal(curr->cast<SetGlobal>()->name);
+					}
+					break;
+				case Expression::LoadId: {
+					Load* load = curr->cast<Load>();
+					h.add(load->bytes);
+					h.add(load->signed_);
+					h.add(load->offset);
+					h.add(load->align);
+					break;
+				}
+				case Expression::StoreId: {
+					Store* store = curr->cast<Store>();
+					h.add(store->bytes);
+					h.add(store->offset);
+					h.add(store->align);
+					h.add((uint64_t)store->valueType);
+					break;
+				}
+				case Expression::ConstId: {
+					Literal& value = curr->cast<Const>()->value;
+					h.add((uint64_t)value.type);
+					if (value.type == Type::i32 || value.type == Type::f32) {
+						h.add((uint32_t)value.reinterpreti32());
+					} else if (value.type == Type::i64 || value.type == Type::f64) {
+						h.add((uint64_t)value.reinterpreti64());
+					}
+					break;
+				}
+				case Expression::UnaryId:
+					h.add((uint64_t)curr->cast<Unary>()->op);
+					break;
+				case Expression::BinaryId:
+					h.add((uint64_t)curr->cast<Binary>()->op);
+					break;
+				case Expression::ReturnId:
+					h.add(curr->cast<Return>()->value != nullptr);
+					break;
+				case Expression::HostId: {
+					Host* host = curr->cast<Host>();
+					h.add((uint64_t)host->op);
+					h.add(host->nameOperand.str);
+					h.add(host->operands.size());
+					break;
+				}
+				default:
+					// Select, Drop, Nop, Unreachable and atomics have nothing beyond their children
+					break;
+			}
+		}
+	};
+
+}
+
+string FunctionHash::hex() const {
+	char buf[33];
+	snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)high, (unsigned long long)low);
+	return string(buf);
+}
+
+FunctionCache::FunctionCache(string _directory, size_t _maxBytes)
+: hits(0), misses(0), evictions(0), tempCounter(0) {
+	directory = _directory;
+	maxBytes = _maxBytes;
+}
+bool FunctionCache::open() {
+	return util::makeDirectories(directory);
+}
+FunctionHash FunctionCache::hashFunction(Function* fn, const string& tag, SymbolIndex* natives) {
+	ExpressionHasher hasher;
+	hasher.natives = natives;
+	hasher.h.add((uint64_t)formatVersion);
+	hasher.h.add(tag.c_str());
+	// Signature and locals
+	hasher.h.add((uint64_t)fn->result);
+	hasher.h.add(fn->params.size());
+	for (auto type : fn->params) {
+		hasher.h.add((uint64_t)type);
+	}
+	hasher.h.add(fn->vars.size());
+	for (auto type : fn->vars) {
+		hasher.h.add((uint64_t)type);
+	}
+	if (fn->body) {
+		hasher.walk(fn->body);
+	}
+	return FunctionHash{hasher.h.fnv, hasher.h.mix};
+}
+string FunctionCache::entryPath(const FunctionHash& key) {
+	return directory + "/" + key.hex() + ".c";
+}
+bool FunctionCache::lookup(const FunctionHash& key, string& out) {
+	int fd = ::open(entryPath(key).c_str(), O_RDONLY);
+	if (fd < 0) {
+		misses++;
+		return false;
+	}
+	struct stat st;
+	bool ok = fstat(fd, &st) == 0;
+	size_t start = out.size();
+	if (ok) {
+		out.resize(start + st.st_size);
+		size_t done = 0;
+		while (done < (size_t)st.st_size) {
+			ssize_t n = read(fd, &out[start + done], st.st_size - done);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				ok = false;
+				break;
+			}
+			done += n;
+		}
+	}
+	if (ok) {
+		// Mark the entry as recently used
+		futimens(fd, nullptr);
+		hits++;
+	} else {
+		out.resize(start);
+		misses++;
+	}
+	close(fd);
+	return ok;
+}
+void FunctionCache::store(const FunctionHash& key, const char* text, size_t size) {
+	// Written under a unique temporary name and renamed into place, so readers
+	// (including other wasmdec processes) never see a partial entry
+	string path = entryPath(key);
+	string temp = path + ".tmp" + to_string(getpid()) + "." + to_string(tempCounter++);
+	int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return;
+	}
+	size_t done = 0;
+	bool ok = true;
+	while (done < size) {
+		ssize_t n = write(fd, text + done, size - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			ok = false;
+			break;
+		}
+		done += n;
+	}
+	ok = (close(fd) == 0) && ok;
+	if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+		unlink(temp.c_str());
+	}
+}
+void FunctionCache::trim() {
+	struct Entry {
+		string path;
+		size_t size;
+		struct timespec used;
+	};
+	DIR* dir = opendir(directory.c_str());
+	if (!dir) {
+		return;
+	}
+	vector<Entry> entries;
+	size_t total = 0;
+	while (struct dirent* ent = readdir(dir)) {
+		string name = ent->d_name;
+		if (name.size() < 3 || name.compare(name.size() - 2, 2, ".c") != 0) {
+			continue;
+		}
+		string path = directory + "/" + name;
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+		entries.push_back(Entry{path, (size_t)st.st_size, st.st_mtim});
+		total += st.st_size;
+	}
+	closedir(dir);
+	if (total <= maxBytes) {
+		return;
+	}
+	sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		if (a.used.tv_sec != b.used.tv_sec) {
+			return a.used.tv_sec < b.used.tv_sec;
+		}
+		return a.used.tv_nsec < b.used.tv_nsec;
+	});
+	for (auto& entry : entries) {
+		if (total <= maxBytes) {
+			break;
+		}
+		if (unlink(entry.path.c_str()) == 0) {
+			total -= entry.size;
+			evictions++;
+		}
+	}
+}
+size_t FunctionCache::getHits() const {
+	return hits;
+}
+size_t FunctionCache::getMisses() const {
+	return misses;
+}
+size_t FunctionCache::getEvictions() const {
+	return evictions;
+}
+const string& FunctionCache::getDirectory() const {
+	return directory;
+}
@@ -0,0 +1,57 @@
+#ifndef _WASMDEC_FUNCTION_CACHE_H
+#define _WASMDEC_FUNCTION_CACHE_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include "wasm.h"
+#include "../wasm/SymbolIndex.h"
+using namespace std;
+using namespace wasm;
+
+namespace wasmdec {
+	// 128 bit structural hash of a function's signature and body
+	struct FunctionHash {
+		uint64_t high;
+		uint64_t low;
+		string hex() const;
+	};
+	// On-disk cache of decompiled function bodies, addressed by a structural hash of
+	// everything the body's C text depends on.
+	// Each entry is one file in the cache directory. Hits refresh the file's
+	// modification time, and trim() deletes the least recently used entries until the
+	// directory fits the size cap. Lookups and stores may run on several threads.
+	class FunctionCache {
+	public:
+		// Bump whenever the C produced for a function body changes, so old entries stop matching
+		static const int formatVersion = 9;
+
+		FunctionCache(string, size_t);
+		bool open();
+		// Hash of a function; the tag holds every option that changes the generated body.
+		// Compilable output spells callees, globals and signatures with identifiers that
+		// depend on the rest of the module, so pass its symbols to hash those as well.
+		static FunctionHash hashFunction(Function*, const string&, SymbolIndex* natives = nullptr);
+		// Appends the cached body to the output, returns false on a miss
+		bool lookup(const FunctionHash&, string&);
+		void store(const FunctionHash&, const char*, size_t);
+		// Evicts least recently used entries until the cache is within its size cap
+		void trim();
+
+		size_t getHits() const;
+		size_t getMisses() const;
+		size_t getEvictions() const;
+		const string& getDirectory() const;
+	protected:
+		string entryPath(const FunctionHash&);
+
+		string directory;
+		size_t maxBytes;
+		atomic<size_t> hits;
+		atomic<size_t> misses;
+		atomic<size_t> evictions;
+		atomic<size_t> tempCounter;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_FUNCTION_CACHE_H
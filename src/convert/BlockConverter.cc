@@ -5,22 +5,16 @@
 using namespace std;
 using namespace wasm;
 
-string wasmdec::Convert::getBlockBody(Context* ctx, Block* blck) {
-	// Stream all block expressions and components into a string
-	stringstream s;
-	const char* bname = blck->name.str;
-	if (bname != nullptr && strlen(bname)) {
-		s << util::tab(ctx->depth);
-		s << blck->name.str << ":\n";
-	}
-	for (auto& expr : blck->list) {
+bool wasmdec::Convert::getBlockBody(Context* ctx, parsers::Frame& f, Block* blck, string& out) {
+	// Write all block expressions and components into the output
+	if (f.index < blck->list.size()) {
 		ctx->lastExpr = blck;
-		s << Convert::parseExpr(ctx, expr);
+		f.visit(blck->list[f.index++], f.step + 1);
+		return true;
 	}
-	return s.str();
+	return false;
 }
-string wasmdec::Convert::getFuncBody(Context ctx, bool addExtraInfo) {
-	string fnBody;
+void wasmdec::Convert::getFuncBody(Context ctx, bool addExtraInfo, string& fnBody) {
 	fnBody += " {\n";
 	// Convert function locals to intermediate locals
 	vector<Type>* vars = &(ctx.fn->vars);
@@ -34,9 +28,8 @@ string wasmdec::Convert::getFuncBody(Context ctx, bool addExtraInfo) {
 		fnBody += "\t// Parsed WASM function locals:\n";
 		// Convert intermediates to C declorations
 		for (auto& ilocal : locals) {
-			string cdecl = ilocal.getCDecloration();
 			fnBody += "\t";
-			fnBody += cdecl;
+			fnBody += ilocal.getCDecloration();
 			if (addExtraInfo) {
 				// Initialize locals to 0 with extra info enabled
 				fnBody += " = 0";
@@ -44,7 +37,9 @@ string wasmdec::Convert::getFuncBody(Context ctx, bool addExtraInfo) {
 			fnBody += "; ";
 			if (addExtraInfo) {
 				// Local info
-				fnBody += "// Local with index '" + to_string(ilocal.index) + "'";
+				fnBody += "// Local with index '";
+				fnBody += to_string(ilocal.index);
+				fnBody += "'";
 			}
 			fnBody += "\n";
 		}
@@ -56,7 +51,6 @@ string wasmdec::Convert::getFuncBody(Context ctx, bool addExtraInfo) {
 	}
 	// Function bodies are block expressions
 	ctx.depth = -1;
-	fnBody += Convert::parseExpr(&ctx, ctx.fn->body);
+	Convert::parseExpr(&ctx, ctx.fn->body, fnBody);
 	fnBody += "}";
-	return fnBody;
 }
\ No newline at end of file
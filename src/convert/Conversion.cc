@@ -1,151 +1,255 @@
 #include "Conversion.h"
+#include "../native/Native.h"
 
-string wasmdec::Convert::parseExpr(Context* ctx, wasm::Expression* e) {
-	string ret;
-	ret = wasmdec::parsers::expression(ctx, e);
-	return ret;
+void wasmdec::Convert::parseExpr(Context* ctx, wasm::Expression* e, string& out) {
+	parseExpr(ctx, e, out, false);
+}
+void wasmdec::Convert::parseExpr(Context* ctx, wasm::Expression* e, string& out, bool asStatement) {
+	// Parsers are resumed from a stack of frames, one per unfinished expression, instead
+	// of recursing, so deeply nested expressions can't overflow the native stack
+	vector<parsers::Frame> stack;
+	stack.reserve(64);
+	stack.emplace_back(e);
+	stack.back().statement = asStatement;
+	while (stack.size()) {
+		stack.back().next = nullptr;
+		if (ctx->native) {
+			native::expression(ctx, stack.back(), out);
+		} else {
+			wasmdec::parsers::expression(ctx, stack.back(), out);
+		}
+		Expression* child = stack.back().next;
+		if (child) {
+			bool statement = stack.back().nextStatement;
+			stack.emplace_back(child);
+			stack.back().statement = statement;
+		} else {
+			if (ctx->native) {
+				native::finish(ctx, stack.back(), out);
+			}
+			stack.pop_back();
+		}
+	}
 }
 string wasmdec::Convert::getFName(wasm::Name name) {
 	// Convert WASM names to C function names
 	// an 'f' is prepended because webassembly function names can be numbers
 	return "f" + string(name.str);
 }
+void wasmdec::Convert::getFName(wasm::Name name, string& out) {
+	out += 'f';
+	out += name.str;
+}
 string wasmdec::Convert::getLocal(wasm::Index argIdx) {
 	// Convert WASM function locals to C variable names
 	return "local" + to_string((int)argIdx);
 }
+void wasmdec::Convert::getLocal(wasm::Index argIdx, string& out) {
+	out += "local";
+	out += to_string((int)argIdx);
+}
 string wasmdec::Convert::voidCall(wasm::Function* fn) {
 	// Call a void function
 	return getFName(fn->name) + "();";
 }
-string wasmdec::Convert::getBinOperator(string e1, wasm::BinaryOp bop, string e2) { // TODO : Add more binary operations
-	// Convert WASM binary operations to their respective C representation
-	string op;
+wasmdec::OperatorSyntax wasmdec::Convert::getBinOperator(wasm::BinaryOp bop) { // TODO : Add more binary operations
+	// Convert WASM binary operations to their respective C representation. Integer
+	// operands are cast to the fixed width type the operator works on: arithmetic
+	// wraps, so it's done unsigned, and shift counts are taken modulo the width.
 	switch (bop) {
 		case AddInt32:
+			return {"(int32_t)((uint32_t)(", ") + (uint32_t)(", "))", true};
+			break;
 		case AddInt64:
+			return {"(int64_t)((uint64_t)(", ") + (uint64_t)(", "))", true};
+			break;
 		case AddFloat32:
 		case AddFloat64:
-			op = "+";
-			return e1 + " " + op + " " + e2;
+			return {"", " + ", "", true};
 			break;
 		case SubInt32:
+			return {"(int32_t)((uint32_t)(", ") - (uint32_t)(", "))", true};
+			break;
 		case SubInt64:
+			return {"(int64_t)((uint64_t)(", ") - (uint64_t)(", "))", true};
+			break;
 		case SubFloat32:
 		case SubFloat64:
-			op = "-";
-			return e1 + " " + op + " " + e2;
+			return {"", " - ", "", true};
 			break;
 		case XorInt64:
 		case XorInt32:
-			op = "^";
-			return e1 + " " + op + " " + e2;
+			return {"", " ^ ", "", true};
 			break;
 		case OrInt64:
 		case OrInt32:
-			op = "|"; return e1 + " " + op + " " + e2;
+			return {"", " | ", "", true};
 			break;
 		case MulInt32:
+			return {"(int32_t)((uint32_t)(", ") * (uint32_t)(", "))", true};
+			break;
 		case MulInt64:
+			return {"(int64_t)((uint64_t)(", ") * (uint64_t)(", "))", true};
+			break;
 		case MulFloat32:
 		case MulFloat64:
-			op = "*"; return e1 + " " + op + " " + e2;
+			return {"", " * ", "", true};
 			break;
 		case EqInt32:
 		case EqInt64:
 		case EqFloat32:
 		case EqFloat64:
-			op = "=="; return e1 + " " + op + " " + e2;
+			return {"", " == ", "", true};
 			break;
 		case NeInt32:
 		case NeInt64:
 		case NeFloat32:
 		case NeFloat64:
-			op = "!="; return e1 + " " + op + " " + e2;
+			return {"", " != ", "", true};
 			break;
 		case AndInt32:
 		case AndInt64:
-			op = "&"; return e1 + " " + op + " " + e2;
+			return {"", " & ", "", true};
 			break;
-		case LeSInt64:
 		case LeSInt32:
+			return {"(int32_t)(", ") <= (int32_t)(", ")", true};
+			break;
 		case LeUInt32:
+			return {"(uint32_t)(", ") <= (uint32_t)(", ")", true};
+			break;
+		case LeSInt64:
+			return {"(int64_t)(", ") <= (int64_t)(", ")", true};
+			break;
+		case LeUInt64:
+			return {"(uint64_t)(", ") <= (uint64_t)(", ")", true};
+			break;
 		case LeFloat32:
 		case LeFloat64:
-		case LeUInt64:
-			op = "<="; return e1 + " " + op + " " + e2;
+			return {"", " <= ", "", true};
 			break;
-		case LtUInt32:
 		case LtSInt32:
+			return {"(int32_t)(", ") < (int32_t)(", ")", true};
+			break;
+		case LtUInt32:
+			return {"(uint32_t)(", ") < (uint32_t)(", ")", true};
+			break;
 		case LtSInt64:
+			return {"(int64_t)(", ") < (int64_t)(", ")", true};
+			break;
+		case LtUInt64:
+			return {"(uint64_t)(", ") < (uint64_t)(", ")", true};
+			break;
 		case LtFloat32:
 		case LtFloat64:
-			op = "<"; return e1 + " " + op + " " + e2;
+			return {"", " < ", "", true};
 			break;
 		case DivSInt32:
+			return {"(int32_t)(", ") / (int32_t)(", ")", true};
+			break;
 		case DivUInt32:
+			return {"(int32_t)((uint32_t)(", ") / (uint32_t)(", "))", true};
+			break;
 		case DivSInt64:
+			return {"(int64_t)(", ") / (int64_t)(", ")", true};
+			break;
 		case DivUInt64:
+			return {"(int64_t)((uint64_t)(", ") / (uint64_t)(", "))", true};
+			break;
 		case DivFloat32:
 		case DivFloat64:
-			op = "/"; return e1 + " " + op + " " + e2;
+			return {"", " / ", "", true};
+			break;
+		case GtSInt32:
+			return {"(int32_t)(", ") > (int32_t)(", ")", true};
+			break;
+		case GtUInt32:
+			return {"(uint32_t)(", ") > (uint32_t)(", ")", true};
 			break;
 		case GtSInt64:
+			return {"(int64_t)(", ") > (int64_t)(", ")", true};
+			break;
 		case GtUInt64:
+			return {"(uint64_t)(", ") > (uint64_t)(", ")", true};
+			break;
 		case GtFloat64:
 		case GtFloat32:
-		case GtSInt32:
-		case GtUInt32:
-		case LtUInt64:
-			op = ">"; return e1 + " " + op + " " + e2;
+			return {"", " > ", "", true};
 			break;
-		case GeSInt64:
 		case GeSInt32:
-		case GeFloat64:
-		case GeFloat32:
+			return {"(int32_t)(", ") >= (int32_t)(", ")", true};
+			break;
 		case GeUInt32:
+			return {"(uint32_t)(", ") >= (uint32_t)(", ")", true};
+			break;
+		case GeSInt64:
+			return {"(int64_t)(", ") >= (int64_t)(", ")", true};
+			break;
 		case GeUInt64:
-			op = ">="; return e1 + " " + op + " " + e2;
+			return {"(uint64_t)(", ") >= (uint64_t)(", ")", true};
+			break;
+		case GeFloat64:
+		case GeFloat32:
+			return {"", " >= ", "", true};
 			break;
 		case CopySignFloat32:
+			return {"copysignf(", ", ", ")", true};
+			break;
 		case CopySignFloat64:
-			return "copysign(" + e1 + ", " + e2 + ")";
+			return {"copysign(", ", ", ")", true};
 			break;
-		case RemSInt64:
-		case RemUInt64:
 		case RemSInt32:
+			return {"(int32_t)(", ") % (int32_t)(", ")", true};
+			break;
 		case RemUInt32:
-			op = "%"; return e1 + " " + op + " " + e2;
+			return {"(int32_t)((uint32_t)(", ") % (uint32_t)(", "))", true};
+			break;
+		case RemSInt64:
+			return {"(int64_t)(", ") % (int64_t)(", ")", true};
+			break;
+		case RemUInt64:
+			return {"(int64_t)((uint64_t)(", ") % (uint64_t)(", "))", true};
 			break;
-		case RotLInt64:
 		case RotLInt32:
-			return "_rotl(" + e1 + ", " + e2 + ")";
+			return {"wasm_i32_rotl(", ", ", ")", true};
+			break;
+		case RotLInt64:
+			return {"wasm_i64_rotl(", ", ", ")", true};
 			break;
 		case RotRInt32:
+			return {"wasm_i32_rotr(", ", ", ")", true};
+			break;
 		case RotRInt64:
-			return "_rotr(" + e1 + ", " + e2 + ")";
+			return {"wasm_i64_rotr(", ", ", ")", true};
 			break;
 		case ShlInt32:
+			return {"(int32_t)((uint32_t)(", ") << ((", ") & 31))", true};
+			break;
 		case ShlInt64:
-			op = "<<"; return e1 + " " + op + " " + e2;
+			return {"(int64_t)((uint64_t)(", ") << ((", ") & 63))", true};
 			break;
-		case ShrUInt32:
 		case ShrSInt32:
-		case ShrUInt64:
+			return {"(int32_t)(", ") >> ((", ") & 31)", true};
+			break;
+		case ShrUInt32:
+			return {"(int32_t)((uint32_t)(", ") >> ((", ") & 31))", true};
+			break;
 		case ShrSInt64:
-			op = ">>"; return e1 + " " + op + " " + e2;
+			return {"(int64_t)(", ") >> ((", ") & 63)", true};
+			break;
+		case ShrUInt64:
+			return {"(int64_t)((uint64_t)(", ") >> ((", ") & 63))", true};
 			break;
 		case MinFloat32:
 		case MinFloat64:
-			return "MIN(" + e1 + ", " + e2 + ")";
+			return {"MIN(", ", ", ")", true};
 			break;
 		case MaxFloat32:
 		case MaxFloat64:
-			return "MAX(" + e1 + ", " + e2 + ")";
+			return {"MAX(", ", ", ")", true};
 			break;
 	}
-	op = "/* Unsupported binary operator */"; // Operation unimplemented or an unknown enumeration
-	return op;
+	// Operation unimplemented or an unknown enumeration
+	return {"/* Unsupported binary operator */", "", "", false};
 }
 string wasmdec::Convert::resolveType(wasm::Type typ) {
 	// Resolve wasm::Type to a C type
@@ -155,10 +259,10 @@ string wasmdec::Convert::resolveType(wasm::Type typ) {
 			return "void";
 			break;
 		case wasm::Type::i32:
-			return "int";
+			return "int32_t";
 			break;
 		case wasm::Type::i64:
-			return "long";
+			return "int64_t";
 			break;
 		case wasm::Type::f32:
 			return "float";
@@ -221,127 +325,153 @@ string wasmdec::Convert::getDecl(wasm::Function* fn) {
 	ret += ")";
 	return ret;
 }
-string wasmdec::Convert::getDecl(wasm::Function* fn, string preface) {
-	// Get C function decloration from WASM function
-	string ret = resolveType(fn->result); // Return type
-	ret += " "; // Space between ret type and name
-	ret += preface; // function preface for decompiling multiple files
-	ret += getFName(fn->name); // name
-	ret += "("; // Argument list
+void wasmdec::Convert::getDecl(wasm::Function* fn, const string& preface, SymbolIndex& symbols, string& out) {
+	// C declaration of a function of the module, under the name its callers use
+	out += resolveType(fn->result); // Return type
+	out += " "; // Space between ret type and name
+	out += preface; // function preface for decompiling multiple files
+	symbols.getFName(fn->name, out);
+	out += "("; // Argument list
 	for (unsigned int i = 0; i < fn->params.size(); ++i) {
-		ret += resolveType(fn->params.at(i));
-		ret += " ";
-		ret += getLocal(i);
+		out += resolveType(fn->params.at(i));
+		out += " ";
+		getLocal(i, out);
 		if (i != (fn->params.size() - 1)) {
 			// Only append comma if the argument list isn't finished
-			ret += ", ";
+			out += ", ";
 		}
 	}
-	ret += ")";
-	return ret;
+	out += ")";
 }
-string wasmdec::Convert::parseOperandList(Context* ctx, ExpressionList* list) {
-	if (list->size()) {
-		string ret = "(";
-		for (unsigned int i = 0; i < list->size(); ++i) {
-			Expression* operand = list->operator[](i);
-			string soperand = Convert::parseExpr(ctx, operand);
-			ret += soperand;
-			if (i != (list->size() - 1)) {
-				// Only append comment if iterator is at the vector end
-				ret += ", ";
-			}
-		}
-		ret += ")";
-		return ret;
-	} else {
-		// Void operand list, no arguments needed
-		return "()";
+bool wasmdec::Convert::parseOperandList(parsers::Frame& f, ExpressionList* list, string& out) {
+	// Void operand lists are written as "()"
+	if (f.index == 0) {
+		out += "(";
+	} else if (f.index < list->size()) {
+		// Only append comma if the iterator isn't at the vector end
+		out += ", ";
+	}
+	if (f.index < list->size()) {
+		f.visit(list->operator[](f.index++), f.step);
+		return true;
 	}
+	out += ")";
+	return false;
 }
-string wasmdec::Convert::getUnary(string exp, UnaryOp op) {
+wasmdec::OperatorSyntax wasmdec::Convert::getUnary(UnaryOp op) {
 	switch (op) {
+		// Bit counts of the operand's width, from the preamble
 		case ClzInt32:
+			return {"wasm_i32_clz(", "", ")", true};
+			break;
 		case ClzInt64:
-			return "__builtin_clz(" + exp + ")";
+			return {"wasm_i64_clz(", "", ")", true};
 			break;
 		case CtzInt32:
+			return {"wasm_i32_ctz(", "", ")", true};
+			break;
 		case CtzInt64:
-			return "__builtin_ctz(" + exp + ")";
+			return {"wasm_i64_ctz(", "", ")", true};
 			break;
 		case PopcntInt32:
+			return {"wasm_i32_popcnt(", "", ")", true};
+			break;
 		case PopcntInt64:
-			return "__builtin_popcount(" + exp + ")";
+			return {"wasm_i64_popcnt(", "", ")", true};
 			break;
 		case NegFloat32:
 		case NegFloat64:
-			return "-(" + exp + ")";
+			return {"-(", "", ")", true};
 			break;
 		case AbsFloat32:
 		case AbsFloat64:
-			return "abs(" + exp + ")";
+			return {"abs(", "", ")", true};
 			break;
 		case CeilFloat32:
 		case CeilFloat64:
-			return "ceil(" + exp + ")";
+			return {"ceil(", "", ")", true};
 			break;
 		case FloorFloat32:
 		case FloorFloat64:
-			return "floor(" + exp + ")";
+			return {"floor(", "", ")", true};
 			break;
 		case TruncFloat32:
 		case TruncFloat64:
-			return "trunc(" + exp + ")";
+			return {"trunc(", "", ")", true};
 			break;
 		case NearestFloat32:
 		case NearestFloat64:
-			return "fromfp(" + exp + ", FP_INT_TONEAREST) /* Round to nearest integer, ties to even */";
+			return {"fromfp(", "", ", FP_INT_TONEAREST) /* Round to nearest integer, ties to even */", true};
 			break;
 		case SqrtFloat32:
 		case SqrtFloat64:
-			return "sqrt(" + exp + ")";
+			return {"sqrt(", "", ")", true};
 			break;
 		case EqZInt32: // Equals 0
 		case EqZInt64:
-			return exp + " == 0";
+			return {"", "", " == 0", true};
 			break;
 		case ExtendSInt32:
+			return {"(int64_t)(int32_t)(", "", ")", true};
+			break;
 		case ExtendUInt32:
+			return {"(int64_t)(uint32_t)(", "", ")", true};
+			break;
 		case TruncSFloat32ToInt64:
-		case TruncUFloat32ToInt64:
 		case TruncSFloat64ToInt64:
+			return {"(int64_t)(", "", ")", true};
+			break;
+		case TruncUFloat32ToInt64:
 		case TruncUFloat64ToInt64:
-		case ReinterpretFloat64:
-			return "(long)" + exp;
+			return {"(int64_t)(uint64_t)(", "", ")", true};
 			break;
 		case WrapInt64:
 		case TruncSFloat32ToInt32:
-		case TruncUFloat32ToInt32:
 		case TruncSFloat64ToInt32:
+			return {"(int32_t)(", "", ")", true};
+			break;
+		case TruncUFloat32ToInt32:
 		case TruncUFloat64ToInt32:
+			return {"(int32_t)(uint32_t)(", "", ")", true};
+			break;
+		case ReinterpretFloat64:
+			return {"(int64_t)", "", "", true};
+			break;
 		case ReinterpretFloat32:
-			return "(int)" + exp;
+			return {"(int32_t)", "", "", true};
 			break;
 		case ConvertSInt32ToFloat32:
-		case ConvertUInt32ToFloat32:
 		case ConvertSInt64ToFloat32:
-		case ConvertUInt64ToFloat32:
 		case DemoteFloat64:
+			return {"(float)(", "", ")", true};
+			break;
+		case ConvertUInt32ToFloat32:
+			return {"(float)(uint32_t)(", "", ")", true};
+			break;
+		case ConvertUInt64ToFloat32:
+			return {"(float)(uint64_t)(", "", ")", true};
+			break;
 		case ReinterpretInt32:
-			return "(float)" + exp;
+			return {"(float)", "", "", true};
 			break;
 		case ConvertSInt32ToFloat64:
-		case ConvertUInt32ToFloat64:
 		case ConvertSInt64ToFloat64:
-		case ConvertUInt64ToFloat64:
 		case PromoteFloat32:
+			return {"(double)(", "", ")", true};
+			break;
+		case ConvertUInt32ToFloat64:
+			return {"(double)(uint32_t)(", "", ")", true};
+			break;
+		case ConvertUInt64ToFloat64:
+			return {"(double)(uint64_t)(", "", ")", true};
+			break;
 		case ReinterpretInt64:
-			return "(double)" + exp;
+			return {"(double)", "", "", true};
 			break;
 	}
-	return "/* Unsupported unary operator */";
+	return {"/* Unsupported unary operator */", "", "", false};
 }
-string wasmdec::Convert::getHostFunc(HostOp hop) {
+const char* wasmdec::Convert::getHostFunc(HostOp hop) {
 	switch (hop) {
   /*
 		case PageSize:
@@ -11,23 +11,42 @@
 using namespace std;
 
 namespace wasmdec {
+	namespace parsers {
+		struct Frame;
+	}
+	// C text written around the operands of an operator:
+	// prefix, first operand, infix, second operand, suffix
+	struct OperatorSyntax {
+		const char* prefix;
+		const char* infix; // Unused by unary operators
+		const char* suffix;
+		bool supported; // Unsupported operators are written as a comment in place of their operands
+	};
+	// Expressions are converted by appending their C text to an output string owned by
+	// the caller, so every byte of output is written exactly once
 	class Convert {
 	public:
 		static string getFName(wasm::Name);
+		static void getFName(wasm::Name, string&);
 		static string getLocal(wasm::Index);
+		static void getLocal(wasm::Index, string&);
 		static string voidCall(wasm::Function*);
-		static string getBinOperator(string, wasm::BinaryOp, string);
-		static string getUnary(string, wasm::UnaryOp);
-		static string getHostFunc(HostOp);
+		static OperatorSyntax getBinOperator(wasm::BinaryOp);
+		static OperatorSyntax getUnary(wasm::UnaryOp);
+		static const char* getHostFunc(HostOp);
 		static string resolveType(wasm::Type);
 		static string getDecl(wasm::FunctionType*, string);
 		static string getDecl(wasm::FunctionType*, wasm::Name);
 		static string getDecl(wasm::Function*);
-		static string getDecl(wasm::Function*, string);
-		static string parseExpr(Context*, wasm::Expression*);
-		static string getBlockBody(Context*, wasm::Block*);
-		static string getFuncBody(Context, bool);
-		static string parseOperandList(Context*, wasm::ExpressionList*);
+		static void getDecl(wasm::Function*, const string& preface, SymbolIndex&, string&);
+		static void parseExpr(Context*, wasm::Expression*, string&);
+		// Compilable output distinguishes statements from values
+		static void parseExpr(Context*, wasm::Expression*, string&, bool asStatement);
+		// Block and operand list writers, called again by their parser after each
+		// child; they return true while a child is queued on the frame
+		static bool getBlockBody(Context*, parsers::Frame&, wasm::Block*, string&);
+		static void getFuncBody(Context, bool, string&);
+		static bool parseOperandList(parsers::Frame&, wasm::ExpressionList*, string&);
 	};
 } // namespace wasmdec
 
@@ -0,0 +1,198 @@
+#include "BatchDecompiler.h"
+#include <set>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+using namespace wasmdec;
+
+namespace {
+	bool hasExtension(const string& name, const string& ext) {
+		return name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
+	}
+	string withoutExtension(const string& path) {
+		size_t dot = path.rfind('.');
+		size_t slash = path.rfind('/');
+		if (dot == string::npos || (slash != string::npos && dot < slash)) {
+			return path;
+		}
+		return path.substr(0, dot);
+	}
+	// Relative paths of every .wasm and .wast file under dir, in sorted order
+	void findModules(const string& dir, const string& relative, vector<string>& found) {
+		DIR* d = opendir(dir.c_str());
+		if (!d) {
+			return;
+		}
+		vector<string> names;
+		while (struct dirent* ent = readdir(d)) {
+			string name = ent->d_name;
+			if (name != "." && name != "..") {
+				names.push_back(name);
+			}
+		}
+		closedir(d);
+		sort(names.begin(), names.end());
+		for (auto& name : names) {
+			string path = dir + "/" + name;
+			string rel = relative.size() ? relative + "/" + name : name;
+			struct stat st;
+			if (stat(path.c_str(), &st) != 0) {
+				continue;
+			}
+			if (S_ISDIR(st.st_mode)) {
+				findModules(path, rel, found);
+			} else if (S_ISREG(st.st_mode) && (hasExtension(name, ".wasm") || hasExtension(name, ".wast"))) {
+				found.push_back(rel);
+			}
+		}
+	}
+}
+
+BatchDecompiler::BatchDecompiler(DisasmConfig _conf, int _concurrency, size_t _memoryBudget)
+: conf(_conf) {
+	concurrency = _concurrency < 1 ? 1 : _concurrency;
+	memoryBudget = _memoryBudget;
+	nextJob = 0;
+	reserved = 0;
+	succeeded = 0;
+	failed = 0;
+}
+size_t BatchDecompiler::estimateMemory(size_t inputSize) {
+	// The parsed module and its C output both take several times the binary's size;
+	// this errs on the high side so the budget is rarely exceeded
+	return (16 << 20) + inputSize * 32;
+}
+bool BatchDecompiler::addJob(string input, string output) {
+	struct stat st;
+	if (stat(input.c_str(), &st) != 0) {
+		cerr << "wasmdec: can't read " << input << endl;
+		failed++;
+		return false;
+	}
+	jobs.push_back(Job{input, output, (size_t)st.st_size});
+	return true;
+}
+bool BatchDecompiler::addDirectory(string dir, string outdir) {
+	vector<string> modules;
+	findModules(dir, "", modules);
+	size_t added = 0;
+	for (auto& rel : modules) {
+		added += addJob(dir + "/" + rel, outdir + "/" + withoutExtension(rel) + ".c");
+	}
+	return added > 0;
+}
+bool BatchDecompiler::addList(string listFile, string outdir) {
+	ifstream list(listFile);
+	if (!list) {
+		return false;
+	}
+	// Outputs are named after the inputs; repeated names get a number
+	set<string> taken;
+	size_t added = 0;
+	string line;
+	while (getline(list, line)) {
+		if (!line.size() || line[0] == '#') {
+			continue;
+		}
+		size_t slash = line.rfind('/');
+		string base = withoutExtension(slash == string::npos ? line : line.substr(slash + 1));
+		string name = base;
+		for (int n = 2; taken.count(name); ++n) {
+			name = base + "-" + to_string(n);
+		}
+		taken.insert(name);
+		added += addJob(line, outdir + "/" + name + ".c");
+	}
+	return added > 0;
+}
+void BatchDecompiler::run() {
+	vector<thread> workers;
+	int threads = (size_t)concurrency < jobs.size() ? concurrency : (int)jobs.size();
+	for (int i = 1; i < threads; ++i) {
+		workers.emplace_back(&BatchDecompiler::work, this);
+	}
+	work();
+	for (auto& t : workers) {
+		t.join();
+	}
+}
+void BatchDecompiler::work() {
+	for (;;) {
+		size_t index;
+		{
+			lock_guard<mutex> guard(lock);
+			if (nextJob >= jobs.size()) {
+				return;
+			}
+			index = nextJob++;
+		}
+		const Job& job = jobs[index];
+		size_t cost = estimateMemory(job.inputSize);
+		acquire(cost);
+		bool ok = decompileJob(job);
+		release(cost);
+		lock_guard<mutex> guard(lock);
+		if (ok) {
+			succeeded++;
+		} else {
+			failed++;
+		}
+	}
+}
+void BatchDecompiler::acquire(size_t cost) {
+	// A module larger than the whole budget still runs, but only on its own
+	unique_lock<mutex> guard(lock);
+	budgetFreed.wait(guard, [&]() {
+		return !memoryBudget || reserved == 0 || reserved + cost <= memoryBudget;
+	});
+	reserved += cost;
+}
+void BatchDecompiler::release(size_t cost) {
+	{
+		lock_guard<mutex> guard(lock);
+		reserved -= cost;
+	}
+	budgetFreed.notify_all();
+}
+bool BatchDecompiler::decompileJob(const Job& job) {
+	size_t slash = job.output.rfind('/');
+	if (slash != string::npos && !util::makeDirectories(job.output.substr(0, slash))) {
+		cerr << "wasmdec: can't create the output directory for " << job.output << endl;
+		return false;
+	}
+	DisasmConfig jobConf = conf;
+	jobConf.mode = getDisasmModeForFile(job.input);
+	InputFile input;
+	if (!input.open(job.input)) {
+		cerr << "wasmdec: can't read " << job.input << endl;
+		return false;
+	}
+	// Scoped so the module is freed as soon as its output is written
+	Decompiler decompiler(jobConf, input.span());
+	input.close();
+	if (decompiler.failed()) {
+		cerr << "wasmdec: failed to decompile " << job.input << endl;
+		return false;
+	}
+	if (!decompiler.setOutputFile(job.output)) {
+		cerr << "wasmdec: can't write " << job.output << endl;
+		return false;
+	}
+	decompiler.decompile();
+	if (!decompiler.finishOutput() || decompiler.failed()) {
+		cerr << "wasmdec: failed to write " << job.output << endl;
+		return false;
+	}
+	return true;
+}
+size_t BatchDecompiler::getSucceeded() {
+	return succeeded;
+}
+size_t BatchDecompiler::getFailed() {
+	return failed;
+}
+size_t BatchDecompiler::getJobCount() {
+	return jobs.size();
+}
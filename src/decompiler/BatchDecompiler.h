@@ -0,0 +1,53 @@
+#ifndef _WASMDEC_BATCH_DECOMPILER_H
+#define _WASMDEC_BATCH_DECOMPILER_H
+
+#include <mutex>
+#include <condition_variable>
+#include "Decompiler.h"
+using namespace std;
+
+namespace wasmdec {
+	// Decompiles many modules, writing one C file per input.
+	// Several modules are decompiled at once, but a module only starts once its
+	// estimated memory fits in the shared budget, and each module is freed as soon as
+	// its output is written.
+	class BatchDecompiler {
+	public:
+		BatchDecompiler(DisasmConfig, int concurrency, size_t memoryBudget);
+		// Every .wasm and .wast file under a directory; outputs mirror the directory layout.
+		// Inputs that can't be read count as failed jobs, and false means none could be.
+		bool addDirectory(string dir, string outdir);
+		// One input path per line; outputs are named after each input
+		bool addList(string listFile, string outdir);
+		void run();
+		size_t getSucceeded();
+		size_t getFailed();
+		size_t getJobCount();
+		// Rough peak memory to decompile a module, from its input size
+		static size_t estimateMemory(size_t inputSize);
+	protected:
+		struct Job {
+			string input;
+			string output;
+			size_t inputSize;
+		};
+		bool addJob(string input, string output);
+		void work();
+		bool decompileJob(const Job&);
+		void acquire(size_t);
+		void release(size_t);
+
+		DisasmConfig conf;
+		int concurrency;
+		size_t memoryBudget;
+		vector<Job> jobs;
+		size_t nextJob;
+		size_t reserved; // Estimated memory of the modules being decompiled
+		size_t succeeded;
+		size_t failed;
+		mutex lock;
+		condition_variable budgetFreed;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_BATCH_DECOMPILER_H
@@ -1,4 +1,5 @@
 #include "Decompiler.h"
+#include "../native/Native.h"
 
 #ifdef ASM_JS_DECOMP
 
@@ -9,26 +10,55 @@
 #endif
 
 Decompiler::Decompiler(DisasmConfig conf, vector<char>* inbin)
-: binary((*inbin)) {
-	if (conf.includePreamble) {
-		emit.preamble();
-	}
-	functionPreface = conf.fnPreface;
+: Decompiler(conf, ByteSpan(*inbin)) { }
+Decompiler::Decompiler(DisasmConfig conf, vector<char> inbin)
+: Decompiler(conf, ByteSpan(inbin)) { }
+Decompiler::Decompiler(DisasmConfig conf, ByteSpan input) {
 	rawMemory = vector<char>();
 	rawTable = vector<char>();
-	isDebug = conf.debug;
-	emitExtraData = conf.extra;
 	mode = conf.mode;
+	parserFailed = false;
+	dctx = nullptr;
+	cache = nullptr;
+	configure(conf);
+	stats::PhaseTimer parseTimer("parse");
+	runStats.inputBytes = input.size;
 
 	if (mode == DisasmMode::Wasm) {
 		debug("Creating WasmBinaryBuilder\n");
+		// WasmBinaryBuilder only reads from a vector, so this is the one copy of the input.
+		// The module owns everything it needs once parsing is done, so it is released right after.
+		BinaryIndex index;
+		if (filter.isActive() && !pruneUnreachable && index.build(input)) {
+			// Only the selected bodies are worth decoding; the rest become stubs in the copy.
+			// Pruning needs every body to find the calls in it.
+			decoded.resize(index.getFunctionCount());
+			size_t kept = 0;
+			for (size_t i = 0; i < decoded.size(); ++i) {
+				decoded[i] = i < index.getImportedFunctionCount()
+					|| filter.matches(i, index.getName(i), index.getExportNames(i));
+				kept += decoded[i];
+			}
+			debug("Decoding " + to_string(kept - index.getImportedFunctionCount()) + " of "
+				+ to_string(decoded.size() - index.getImportedFunctionCount()) + " function bodies\n");
+			index.stripBodies(decoded, binary);
+		} else {
+			binary.assign(input.data, input.data + input.size);
+		}
 		// Create parser
 		wasm::WasmBinaryBuilder parser(module, binary, conf.debug);
 		debug("Parsing wasm binary...\n");
 		// Attempt to parse binary via Binaryen's AST parser
 		try {
+			stats::TraceSpan span("parse", "WasmBinaryBuilder::read");
 			parser.read();
 			parserFailed = false;
+		} catch (wasm::ParseException& err) {
+			cerr << "wasmdec: FAILED to parse wasm binary: " << endl;
+			err.dump(cerr);
+			cerr << endl;
+			fail();
+			return;
 		} catch (exception& err) {
 			cerr << "wasmdec: FAILED to parse wasm binary: " << endl;
 			cerr << err.what() << endl;
@@ -36,11 +66,18 @@ Decompiler::Decompiler(DisasmConfig conf, vector<char>* inbin)
 			fail();
 			return;
 		}
+		vector<char>().swap(binary);
 	} else if (mode == DisasmMode::Wast) {
 		try {
 			debug("Starting SExpressionParser\n");
-			string binary_s(binary.begin(), binary.end());
-			SExpressionParser parser(const_cast<char*>(binary_s.c_str()));
+			// The text parser needs a terminated string; parse in place when the input has one
+			string binary_s;
+			char* text = const_cast<char*>(input.data);
+			if (!input.nullTerminated) {
+				binary_s.assign(input.data, input.size);
+				text = const_cast<char*>(binary_s.c_str());
+			}
+			SExpressionParser parser(text);
 			Element& _root = *(parser.root);
 			debug("Starting SExpressionWasmBuilder\n");
 			SExpressionWasmBuilder sbuilder(module, *_root[0]);
@@ -60,7 +97,7 @@ Decompiler::Decompiler(DisasmConfig conf, vector<char>* inbin)
 		// preprocess
 		debug("Preprocessing asm.js\n");
 		Asm2WasmPreProcessor a2wp;
-		string binary_s(binary.begin(), binary.end());
+		string binary_s(input.data, input.size);
 		char* begin = a2wp.process(const_cast<char*>(binary_s.c_str()));
 
 		// parse
@@ -86,105 +123,133 @@ Decompiler::Decompiler(DisasmConfig conf, vector<char>* inbin)
 
 	debug("Parsed bin successfully.\n");
 	dctx = new DecompilerCtx();
+	{
+		stats::TraceSpan span("parse", "index symbols");
+		// Index every symbol once so lookups while generating code are constant time
+		dctx->symbols.build(&module);
+		selectFunctions();
+	}
+	runStats.add("parse", parseTimer.elapsed());
 }
-void Decompiler::fail() {
-	debug("Decompiler::fail() called!\n");
-	parserFailed = true;
+Decompiler::~Decompiler() {
+	delete dctx;
+	delete cache;
 }
-Decompiler::Decompiler(DisasmConfig conf, vector<char> inbin)
-: binary(inbin) {
-	if (conf.includePreamble) {
-		emit.preamble();
-	}
+void Decompiler::configure(DisasmConfig conf) {
+	// Everything except the input mode only affects code generation, so a parsed
+	// module can be decompiled again with different options
+	includePreamble = conf.includePreamble;
 	functionPreface = conf.fnPreface;
-	rawMemory = vector<char>();
-	rawTable = vector<char>();
 	isDebug = conf.debug;
 	emitExtraData = conf.extra;
-	mode = conf.mode;
-	if (mode == DisasmMode::Wasm) {
-		debug("Creating WasmBinaryBuilder\n");
-		// Create parser
-		wasm::WasmBinaryBuilder parser(module, binary, conf.debug);
-		debug("Parsing wasm binary...\n");
-		// Attempt to parse binary via Binaryen's AST parser
-		try {
-			parser.read();
-			parserFailed = false;
-		} catch (exception& err) {
-			cerr << "wasmdec: FAILED to parse wasm binary: " << endl;
-			cerr << err.what() << endl;
-			cerr << endl;
-			fail();
-			return;
+	compilable = conf.compilable;
+	fastTraps = conf.fastTraps;
+	jobs = conf.jobs;
+	if (cache && (cache->getDirectory() != conf.cacheDir || cacheSize != conf.cacheSize)) {
+		delete cache;
+		cache = nullptr;
+	}
+	cacheSize = conf.cacheSize;
+	if (!cache && conf.cacheDir.size()) {
+		cache = new FunctionCache(conf.cacheDir, conf.cacheSize);
+		if (!cache->open()) {
+			cerr << "wasmdec: can't use cache directory '" << conf.cacheDir << "', caching disabled" << endl;
+			delete cache;
+			cache = nullptr;
 		}
-	} else if (mode == DisasmMode::Wast) {
-		try {
-			debug("Starting SExpressionParser\n");
-			string binary_s(binary.begin(), binary.end());
-			SExpressionParser parser(const_cast<char*>(binary_s.c_str()));
-			Element& _root = *(parser.root);
-			debug("Starting SExpressionWasmBuilder\n");
-			SExpressionWasmBuilder sbuilder(module, *_root[0]);
-			parserFailed = false;
-		} catch (wasm::ParseException& err) {
-			cerr << "wasmdec: FAILED to parse wast: " << endl;
-			err.dump(cerr);
-			cerr << endl;
-			fail();
-			return;
+	}
+	cacheTag = string(emitExtraData ? "extra" : "") + (compilable ? (fastTraps ? "compilable-fast" : "compilable") : "");
+	filter = FunctionFilter(conf.only, conf.exclude);
+	rootsFromExports = conf.reachableFromExports;
+	rootFilter = FunctionFilter(conf.roots, vector<string>());
+	pruneUnreachable = rootsFromExports || rootFilter.isActive();
+	profileFunctions = conf.profile;
+	if (dctx) {
+		// Reconfiguring a parsed module
+		selectFunctions();
+	}
+}
+void Decompiler::selectFunctions() {
+	selected.clear();
+	reachable.clear();
+	if (!filter.isActive() && !pruneUnreachable) {
+		return;
+	}
+	vector<vector<string>> exportNames(module.functions.size());
+	unordered_map<string, size_t> indices;
+	for (size_t i = 0; i < module.functions.size(); ++i) {
+		indices[module.functions[i]->name.str] = i;
+	}
+	for (auto& expt : module.exports) {
+		auto found = indices.find(expt->value.str);
+		if (expt->kind == ExternalKind::Function && found != indices.end()) {
+			exportNames[found->second].push_back(expt->name.str);
 		}
 	}
-	
-	#ifdef ASM_JS_DECOMP
-
-	else if (mode == DisasmMode::AsmJs) {
-		// preprocess
-		debug("Preprocessing asm.js\n");
-		Asm2WasmPreProcessor a2wp;
-		string binary_s(binary.begin(), binary.end());
-		char* begin = a2wp.process(const_cast<char*>(binary_s.c_str()));
-
-		// parse
-		debug("Initializing parser\n");
-		cashew::Parser<Ref, DotZeroValueBuilder> parser_builder;
-		Ref js = parser_builder.parseToplevel(begin);
-
-		// compile to wasm
-		debug("Compiling to wasm\n");
-		PassOptions popts;
-		popts.debug = isDebug;
-		Asm2WasmBuilder a2w(module,
-							a2wp,
-							isDebug,
-							TrapMode::JS,
-							popts,
-							true, true, false);
-		a2w.processAsm(js);
-		debug("Compilation finished");
+	if (filter.isActive()) {
+		selected.resize(module.functions.size());
+		for (size_t i = 0; i < selected.size(); ++i) {
+			// A body that was never decoded can't be decompiled, whatever the filter says now
+			selected[i] = filter.matches(i, module.functions[i]->name.str, exportNames[i])
+				&& (!decoded.size() || (i < decoded.size() && decoded[i]));
+		}
+	}
+	if (pruneUnreachable) {
+		vector<size_t> roots;
+		for (size_t i = 0; i < module.functions.size(); ++i) {
+			if ((rootsFromExports && exportNames[i].size())
+				|| (rootFilter.isActive() && rootFilter.matches(i, module.functions[i]->name.str, exportNames[i]))) {
+				roots.push_back(i);
+			}
+		}
+		CallGraph graph;
+		graph.build(&module);
+		reachable = graph.reachableFrom(roots);
+		size_t count = 0;
+		for (bool r : reachable) {
+			count += r;
+		}
+		debug(to_string(count) + " of " + to_string(reachable.size()) + " functions are reachable from "
+			+ to_string(roots.size()) + " roots\n");
 	}
-
-	#endif
-
-	debug("Parsed bin successfully.\n");
-	dctx = new DecompilerCtx();
+}
+void Decompiler::fail() {
+	debug("Decompiler::fail() called!\n");
+	parserFailed = true;
 }
 void Decompiler::decompile() {
 	if (parserFailed) {
 		return;
 	}
 	debug("Starting code generation...\n");
+	if (includePreamble) {
+		if (compilable) {
+			emit.runtime();
+		} else {
+			emit.preamble();
+		}
+	}
 	// Process globals
-	if (module.globals.size()) {
+	stats::PhaseTimer globalsTimer("globals");
+	if (compilable) {
+		dctx->symbols.buildNativeNames(&module);
+		dctx->fastTraps = fastTraps;
+		string code;
+		native::globals(&module, dctx, code);
+		native::prototypes(&module, dctx, reachable, code);
+		emit << code;
+	} else if (module.globals.size()) {
 		debug("Processing globals...\n");
 		Context gctx = Context(&module); // Initialize a global context to parse expressions with
 		gctx.isGlobal = true;
 		emit.comment("WASM globals:");
 		for (auto& glb : module.globals) {
+			stats::TraceSpan span("global", glb->name.str);
 			bool isImported = glb->imported();
 			string globalType = Convert::resolveType(glb->type);
 			if (!isImported) {
-				string globalInitializer = Convert::parseExpr(&gctx, glb->init);
+				string globalInitializer;
+				Convert::parseExpr(&gctx, glb->init, globalInitializer);
 				if (!glb->mutable_) { // Non-mutable global is represented by const
 					emit << "const ";
 				}
@@ -206,47 +271,53 @@ void Decompiler::decompile() {
 		emit.comment("No WASM globals.");
 		*/
 	}
-	emit.ln();
+	if (!compilable) {
+		emit.ln();
+	}
+	runStats.add("globals", globalsTimer.elapsed());
 	// Process functions
+	stats::PhaseTimer functionsTimer("functions");
 	if (module.functions.size()) {
 		debug("Processing wasm functions...\n");
 		/*
 		emit.comment("WASM functions:");
 		emit.ln();
 		*/
-		int funcNumber = 0;
-		for (const auto &func : module.functions) {
-			Function* fn = func.get();
-			if (fn->imported()) {
-				debug("Processing function (import) #" + to_string(funcNumber) + "\n");
-				debug(" (name: '" + string(fn->name.str) + "')\n");
-				string signature = Convert::getDecl(fn, functionPreface);
-				emit << "extern "
-					<< signature
-					<< "; /* import */"
-					<< endl;
-			} else {
-				debug("Processing function #" + to_string(funcNumber) + "\n");
-				debug(" (name: '" + string(fn->name.str) + "')\n");
-				funcNumber++;
-				if (emitExtraData) {
-					// Emit information about the function as a comment
-					emit << "/*" << endl
-					<< "\tFunction '" << fn->name << "'" << endl
-					<< "\tLocal variables: " << fn->vars.size() << endl
-					<< "\tParameters: " << fn->params.size() << endl
-					<< "*/" << endl;
+		if (jobs > 1) {
+			// Decompile function bodies concurrently, then stitch them in module order
+			debug("Decompiling functions with " + to_string(jobs) + " threads\n");
+			decompileFunctions();
+		} else {
+			int funcNumber = 0;
+			for (size_t i = 0; i < module.functions.size(); ++i) {
+				Function* fn = module.functions[i].get();
+				if (fn->imported()) {
+					debug("Processing function (import) #" + to_string(funcNumber) + "\n");
+				} else {
+					debug("Processing function #" + to_string(funcNumber) + "\n");
+					funcNumber++;
 				}
-				Context ctx = Context(fn, &module, dctx);
-				ctx.functionLevelExpression = true;
-				emit << Convert::getDecl(fn, functionPreface) << Convert::getFuncBody(ctx, emitExtraData) << endl;
+				debug(" (name: '" + string(fn->name.str) + "')\n");
+				emit << decompileFunction(i);
+				emit.flush();
 			}
 		}
 	} else {
 		emit.comment("No WASM functions.");
 		emit.ln();
 	}
+	for (size_t i = 0; i < module.functions.size(); ++i) {
+		runStats.functions += hasBody(i);
+	}
+	runStats.add("functions", functionsTimer.elapsed());
 	// Process exports
+	stats::PhaseTimer exportsTimer("exports");
+	if (compilable) {
+		string code;
+		native::moduleInit(&module, dctx, reachable, code);
+		native::exports(&module, dctx, reachable, code);
+		emit << code;
+	}
 	if (module.exports.size()) {
 		debug("Processing wasm exports...\n");
 		if (emitExtraData) {
@@ -254,7 +325,9 @@ void Decompiler::decompile() {
 			<< "\tExported WASM functions:" << endl;
 			for (const auto& expt : module.exports) {
 				// Stringify export to comment
-				emit << "\tFunction '" << Convert::getFName(expt->value) << "':" << endl
+				string cName;
+				dctx->symbols.getFName(expt->value, cName);
+				emit << "\tFunction '" << cName << "':" << endl
 					<< "\t\tWASM name: '" << expt->value.str << "'" << endl
 					<< "\t\tExport name: '" << expt->name.str << "'" << endl << endl;
 			}
@@ -265,10 +338,179 @@ void Decompiler::decompile() {
 		emit.comment("No WASM exports.");
 		emit.ln();
 	}
+	runStats.add("exports", exportsTimer.elapsed());
+	if (cache) {
+		debug("Trimming function cache\n");
+		cache->trim();
+	}
 	debug("Code generation complete.\n");
 	vector<char>().swap(binary);
 }
+string Decompiler::decompileFunction(size_t index) {
+	// Produces the complete C text for one function, independent of any other function
+	Function* fn = module.functions[index].get();
+	string code;
+	if (reachable.size() && !reachable[index]) {
+		// Pruned, nothing reachable refers to it
+		return code;
+	}
+	string nativeName;
+	if (compilable) {
+		dctx->symbols.getNativeName(fn->name, nativeName);
+	}
+	if (fn->imported() && compilable) {
+		code += "extern ";
+		native::declaration(fn, nativeName, code);
+		code += "; /* import ";
+		code += fn->module.str;
+		code += ".";
+		code += fn->base.str;
+		code += " */\n";
+	} else if (fn->imported()) {
+		code += "extern ";
+		Convert::getDecl(fn, functionPreface, dctx->symbols, code);
+		code += "; /* import */\n";
+	} else if (!hasBody(index) && compilable) {
+		// Still defined, since other functions may call it
+		code += "static ";
+		native::declaration(fn, nativeName, code);
+		code += " {\n\twasm_trap(\"body not decompiled\");\n}\n";
+	} else if (!hasBody(index)) {
+		// Filtered out, only the signature is kept
+		Convert::getDecl(fn, functionPreface, dctx->symbols, code);
+		code += "; /* body not decompiled */\n";
+	} else {
+		if (emitExtraData) {
+			// Emit information about the function as a comment
+			code += "/*\n\tFunction '";
+			code += fn->name.str;
+			code += "'\n\tLocal variables: ";
+			code += to_string(fn->vars.size());
+			code += "\n\tParameters: ";
+			code += to_string(fn->params.size());
+			code += "\n*/\n";
+		}
+		stats::TraceSpan span("function", fn->name.str);
+		Context ctx = Context(fn, &module, dctx);
+		ctx.functionLevelExpression = true;
+		if (compilable) {
+			code += "static ";
+			native::declaration(fn, nativeName, code);
+		} else {
+			Convert::getDecl(fn, functionPreface, dctx->symbols, code);
+		}
+		// The body is written straight onto the end of the function's text
+		size_t bodyStart = code.size();
+		double start = profileFunctions ? stats::wallSeconds() : 0;
+		bool cached = false;
+		if (cache) {
+			FunctionHash key = FunctionCache::hashFunction(fn, cacheTag, compilable ? &dctx->symbols : nullptr);
+			cached = cache->lookup(key, code);
+			if (!cached) {
+				getFuncBody(ctx, code);
+				cache->store(key, code.data() + bodyStart, code.size() - bodyStart);
+			}
+		} else {
+			getFuncBody(ctx, code);
+		}
+		if (profileFunctions) {
+			profiler.record(stats::FunctionProfile{index, Convert::getFName(fn->name), stats::wallSeconds() - start,
+				util::countExpressions(fn->body), util::maxDepth(fn->body), code.size() - bodyStart, cached});
+		}
+		code += "\n";
+	}
+	return code;
+}
+void Decompiler::getFuncBody(Context& ctx, string& code) {
+	if (compilable) {
+		native::functionBody(&ctx, code);
+	} else {
+		Convert::getFuncBody(ctx, emitExtraData, code);
+	}
+}
+void Decompiler::decompileFunctions() {
+	// Estimate each function's cost from its expression count so the scheduler can
+	// start the largest functions first
+	vector<size_t> costs(module.functions.size());
+	size_t largest = 0;
+	for (size_t i = 0; i < costs.size(); ++i) {
+		Function* fn = module.functions[i].get();
+		costs[i] = hasBody(i) ? util::countExpressions(fn->body) : 1;
+		largest = max(largest, costs[i]);
+	}
+	// Finished functions are held until every function before them is done, then the
+	// whole ready run is emitted in module order and released. The scheduler works
+	// through the module in windows so no more than a window's text is ever held: enough
+	// work to keep every thread busy, or the largest function if that is more.
+	size_t windowCost = max(largest, (size_t)max(jobs, 1) * windowCostPerThread);
+	vector<string> functionCode(costs.size());
+	vector<bool> finished(costs.size(), false);
+	size_t nextToEmit = 0;
+	mutex emitLock;
+	Scheduler scheduler(jobs);
+	scheduler.run(costs, [&](size_t i) {
+		string code = decompileFunction(i);
+		lock_guard<mutex> guard(emitLock);
+		functionCode[i].swap(code);
+		finished[i] = true;
+		while (nextToEmit < finished.size() && finished[nextToEmit]) {
+			emit << functionCode[nextToEmit];
+			string().swap(functionCode[nextToEmit]);
+			nextToEmit++;
+		}
+		emit.flush();
+	}, windowCost);
+	workerStats = scheduler.getWorkerStats();
+	// Report the load balance
+	double wall = scheduler.getWallSeconds();
+	for (size_t i = 0; i < workerStats.size(); ++i) {
+		const WorkerStats& ws = workerStats[i];
+		stringstream line;
+		line << "Worker " << i << ": " << ws.tasks << " functions (" << ws.stolen << " stolen), "
+			<< ws.cost << " expressions, busy " << ws.busySeconds << "s of " << wall << "s ("
+			<< (wall > 0 ? 100.0 * ws.busySeconds / wall : 100.0) << "%)\n";
+		debug(line.str());
+	}
+}
+const vector<WorkerStats>& Decompiler::getWorkerStats() {
+	return workerStats;
+}
+FunctionCache* Decompiler::getCache() {
+	return cache;
+}
+bool Decompiler::setOutputFile(string path) {
+	return emit.openFile(path);
+}
+void Decompiler::setOutputFd(int fd) {
+	emit.attach(fd);
+}
+bool Decompiler::finishOutput() {
+	bool ok = emit.close();
+	runStats.add("write", emit.getWriteTime());
+	runStats.outputBytes += emit.getBytesWritten();
+	return ok;
+}
+bool Decompiler::hasBody(size_t index) {
+	// Whether a function's body is decompiled, rather than left out or cut down to its signature
+	return !module.functions[index]->imported()
+		&& (!selected.size() || selected[index])
+		&& (!reachable.size() || reachable[index]);
+}
+stats::FunctionProfiler& Decompiler::getProfiler() {
+	return profiler;
+}
+stats::RunStats& Decompiler::getStats() {
+	if (cache) {
+		runStats.hasCache = true;
+		runStats.cacheDirectory = cache->getDirectory();
+		runStats.cacheHits = cache->getHits();
+		runStats.cacheMisses = cache->getMisses();
+		runStats.cacheEvictions = cache->getEvictions();
+	}
+	return runStats;
+}
 string Decompiler::getEmittedCode() {
+	// When streaming to a file this is only the code that hasn't been flushed yet
 	debug("Exporting emitted code.\n");
 	return emit.getCode();
 }
@@ -6,9 +6,17 @@
 
 #include "../convert/Conversion.h"
 #include "../Emitter.h"
+#include "../io/InputFile.h"
+#include "../cache/FunctionCache.h"
+#include "../stats/FunctionProfiler.h"
+#include "../stats/Trace.h"
 
 #include "DisasmConfig.h"
 #include "DecompilerCtx.h"
+#include "Scheduler.h"
+#include "FunctionFilter.h"
+#include "../wasm/BinaryIndex.h"
+#include "../wasm/CallGraph.h"
 
 using namespace wasmdec;
 using namespace std;
@@ -21,21 +29,55 @@ namespace wasmdec {
 		Emitter emit;
 		Decompiler(DisasmConfig, vector<char>*);
 		Decompiler(DisasmConfig, vector<char>);
+		Decompiler(DisasmConfig, ByteSpan);
+		~Decompiler();
+		void configure(DisasmConfig);
 		void decompile();
 		string getEmittedCode();
+		bool setOutputFile(string);
+		void setOutputFd(int);
+		bool finishOutput();
 		bool failed();
 		vector<char> dumpMemory();
 		vector<char> dumpTable();
+		const vector<WorkerStats>& getWorkerStats();
+		FunctionCache* getCache();
+		stats::RunStats& getStats();
+		stats::FunctionProfiler& getProfiler();
 		DisasmMode mode;
 		DecompilerCtx* dctx;
 	protected:
 		void fail();
+		string decompileFunction(size_t);
+		void getFuncBody(Context&, string&);
+		void decompileFunctions();
+		void selectFunctions();
+		bool hasBody(size_t);
 		string functionPreface;
 		void debug(string);
 		void debugf(string);
 		bool parserFailed;
 		bool isDebug;
 		bool emitExtraData;
+		bool includePreamble;
+		bool compilable;
+		bool fastTraps;
+		int jobs;
+		static const size_t windowCostPerThread = 1 << 16; // Expressions scheduled per thread at a time
+		vector<WorkerStats> workerStats;
+		stats::RunStats runStats;
+		bool profileFunctions;
+		stats::FunctionProfiler profiler;
+		FunctionCache* cache;
+		size_t cacheSize;
+		string cacheTag; // Options that change function bodies, part of every cache key
+		FunctionFilter filter;
+		vector<bool> decoded; // Functions whose bodies were parsed, empty when all of them were
+		vector<bool> selected; // Functions whose bodies are decompiled, empty for all
+		bool pruneUnreachable; // Leave out functions no root can reach
+		bool rootsFromExports;
+		FunctionFilter rootFilter;
+		vector<bool> reachable; // Functions that are emitted at all, empty for all
 		vector<char> rawTable;
 		vector<char> rawMemory;
 	};
@@ -1,10 +1,16 @@
 #ifndef DECOMPILER_CTX_H_
 #define DECOMPILER_CTX_H_
 
+#include "../wasm/SymbolIndex.h"
+
 namespace wasmdec {
+	// State shared by every function of one module
 	class DecompilerCtx {
 		int stackOverflowAbortId;
+	public:
+		SymbolIndex symbols;
+		bool fastTraps = false; // See DisasmConfig::fastTraps
 	};
 };
 
-#endif // DECOMPILER_CTX_H_
\ No newline at end of file
+#endif // DECOMPILER_CTX_H_
@@ -13,7 +13,17 @@ public:
     bool debug;
     bool extra;
     bool includePreamble;
+    int jobs; // Number of threads used to decompile function bodies
+    string cacheDir; // Directory of the function cache, empty when caching is off
+    size_t cacheSize; // Size cap of the function cache in bytes
     string fnPreface;
+    vector<string> only; // Function patterns to decompile the bodies of, empty for all
+    vector<string> exclude; // Function patterns to leave out, see FunctionFilter
+    bool reachableFromExports; // Only emit functions reachable from the exports
+    vector<string> roots; // Function patterns to also start the reachability search from
+    bool profile; // Record the cost of every function body
+    bool compilable; // Emit C that compiles and runs, against a generated runtime
+    bool fastTraps; // Compilable output leaves out the checks of operations that trap
     DisasmMode mode;
     inline DisasmConfig(bool _debug, bool _extra, DisasmMode _mode) {
         debug = _debug;
@@ -21,7 +31,26 @@ public:
         mode = _mode;
         includePreamble = true;
         fnPreface = "";
+        jobs = 1;
+        cacheDir = "";
+        cacheSize = 256 << 20;
+        reachableFromExports = false;
+        profile = false;
+        compilable = false;
+        fastTraps = false;
     }
 };
 
+inline DisasmMode getDisasmModeForFile(const string& path) {
+    // Convert file extension to disassembler mode
+    string::size_type idx = path.rfind('.');
+    string ext = idx == string::npos ? "" : path.substr(idx + 1);
+    if (ext == "wast") {
+        return DisasmMode::Wast;
+    } else if (ext == "js") {
+        return DisasmMode::AsmJs;
+    }
+    return DisasmMode::Wasm;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "FunctionFilter.h"
+using namespace wasmdec;
+
+FunctionFilter::FunctionFilter() { }
+FunctionFilter::FunctionFilter(const vector<string>& _only, const vector<string>& _exclude) {
+	for (auto& text : _only) {
+		only.push_back(compile(text));
+	}
+	for (auto& text : _exclude) {
+		exclude.push_back(compile(text));
+	}
+}
+FunctionFilter::Pattern FunctionFilter::compile(const string& text) {
+	Pattern p;
+	p.text = text;
+	p.isIndex = text.size() && text.find_first_not_of("0123456789") == string::npos;
+	p.index = 0;
+	if (p.isIndex) {
+		try {
+			p.index = stoull(text);
+		} catch (out_of_range& err) {
+			p.index = (size_t)-1; // Matches nothing
+		}
+	}
+	p.isRegex = false;
+	if (!p.isIndex) {
+		try {
+			p.expression = regex(text);
+			p.isRegex = true;
+		} catch (regex_error& err) {
+			// Still usable as a plain name
+		}
+	}
+	return p;
+}
+bool FunctionFilter::matches(const Pattern& p, size_t index, const string& name, const vector<string>& exportNames) {
+	if (p.isIndex) {
+		return p.index == index;
+	}
+	auto test = [&](const string& s) {
+		return s == p.text || (p.isRegex && regex_match(s, p.expression));
+	};
+	// The C name, as Convert::getFName writes it, is what users see in the output
+	if (name.size() && (test(name) || test("f" + name))) {
+		return true;
+	}
+	for (auto& exportName : exportNames) {
+		if (test(exportName)) {
+			return true;
+		}
+	}
+	return false;
+}
+bool FunctionFilter::isActive() {
+	return only.size() || exclude.size();
+}
+bool FunctionFilter::matches(size_t index, const string& name, const vector<string>& exportNames) {
+	bool selected = !only.size();
+	for (auto& p : only) {
+		if (matches(p, index, name, exportNames)) {
+			selected = true;
+			break;
+		}
+	}
+	if (!selected) {
+		return false;
+	}
+	for (auto& p : exclude) {
+		if (matches(p, index, name, exportNames)) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,37 @@
+#ifndef _WASMDEC_FUNCTION_FILTER_H
+#define _WASMDEC_FUNCTION_FILTER_H
+
+#include <regex>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace wasmdec {
+	// Selects functions by --only and --exclude patterns.
+	// A pattern made of digits is a function index (imports included). Anything else
+	// matches a function whose wasm name, C name or any of its export names equals the
+	// pattern or matches it as a whole as a regular expression.
+	class FunctionFilter {
+	public:
+		FunctionFilter();
+		FunctionFilter(const vector<string>& only, const vector<string>& exclude);
+		// Whether any function can be filtered out
+		bool isActive();
+		bool matches(size_t index, const string& name, const vector<string>& exportNames);
+	protected:
+		struct Pattern {
+			string text;
+			bool isIndex;
+			size_t index;
+			bool isRegex; // False when the text isn't a valid regular expression
+			regex expression;
+		};
+		static Pattern compile(const string&);
+		static bool matches(const Pattern&, size_t, const string&, const vector<string>&);
+
+		vector<Pattern> only;
+		vector<Pattern> exclude;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_FUNCTION_FILTER_H
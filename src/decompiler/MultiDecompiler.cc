@@ -17,39 +17,15 @@ string MultiDecompiler::getEverythingButFileExt(string a) {
 	return r;
 }
 DisasmMode MultiDecompiler::getDisasmMode(string infile) {
-	// Convert file extension to disassembler mode
-	string ext = getFileExt(infile);
-	if (ext == "wasm") {
-		return DisasmMode::Wasm;
-	} else if (ext == "wast") {
-		return DisasmMode::Wast;
-	} else if (ext == "js") {
-		return DisasmMode::AsmJs;
-	} else {
-		return DisasmMode::Wasm;
-	}
-}
-bool MultiDecompiler::readFile(vector<char>* data, string path) {
-	ifstream file(path);
-	if (!file.eof() && !file.fail()) {
-	    file.seekg(0, ios_base::end);
-	    streampos fileSize = file.tellg();
-	    data->resize(fileSize);
-	    file.seekg(0, ios_base::beg);
-	    file.read(&(data->operator[](0)), fileSize);
-		return true;
-	} else {
-		return false;
-	}
+	return getDisasmModeForFile(infile);
 }
-
 MultiDecompiler::MultiDecompiler(vector<string> _infiles, DisasmConfig conf) {
 	infiles = _infiles;
 	failed = false;
 	// Read all the infiles
 	for (unsigned int i = 0; i < infiles.size(); ++i) {
-		vector<char> raw;
-		if (!readFile(&raw, infiles.at(i))) {
+		InputFile raw;
+		if (!raw.open(infiles.at(i))) {
 			failed = true;
 			break;
 		}
@@ -70,11 +46,12 @@ MultiDecompiler::MultiDecompiler(vector<string> _infiles, DisasmConfig conf) {
 			thisConf.includePreamble = false;
 		}
 		thisConf.mode = getDisasmMode(infiles.at(i));
-		// create decompiler
-		Decompiler* d = new Decompiler(thisConf, raw);
+		// create decompiler, freed before the next module is read
+		Decompiler d(thisConf, raw.span());
+		raw.close();
 		// do decompilation
-		d->decompile();
-		if (d->failed()) {
+		d.decompile();
+		if (d.failed()) {
 			failed = true;
 			break;
 		}
@@ -82,7 +59,7 @@ MultiDecompiler::MultiDecompiler(vector<string> _infiles, DisasmConfig conf) {
 			codeStream << endl << endl;
 
 		codeStream << "// Module '" << infiles.at(i) << "':" << endl
-			<< d->getEmittedCode();
+			<< d.getEmittedCode();
 	}
 }
 string MultiDecompiler::getOutput() {
@@ -12,7 +12,6 @@ namespace wasmdec {
 		bool failed;
 	protected:
 		stringstream codeStream;
-		bool readFile(vector<char>*, string);
 		string getFileExt(string);
 		string getEverythingButFileExt(string);
 		DisasmMode getDisasmMode(string);
@@ -0,0 +1,90 @@
+#include "Scheduler.h"
+using namespace wasmdec;
+
+Scheduler::Scheduler(int _numWorkers)
+: queues(_numWorkers < 1 ? 1 : _numWorkers) {
+	numWorkers = queues.size();
+	costs = nullptr;
+	wallSeconds = 0;
+}
+void Scheduler::run(const vector<size_t>& _costs, function<void(size_t)> _task, size_t windowCost) {
+	costs = &_costs;
+	task = _task;
+	stats = vector<WorkerStats>(numWorkers, WorkerStats{0, 0, 0, 0});
+	auto start = chrono::steady_clock::now();
+	size_t begin = 0;
+	while (begin < costs->size()) {
+		size_t end = begin + 1;
+		size_t cost = costs->at(begin);
+		while (end < costs->size() && cost < windowCost && costs->at(end) <= windowCost - cost) {
+			cost += costs->at(end++);
+		}
+		runWindow(begin, end);
+		begin = end;
+	}
+	wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+void Scheduler::runWindow(size_t begin, size_t end) {
+	// Order the window's tasks by cost, largest first, and deal them out round robin so
+	// each worker starts on one of the largest tasks
+	vector<size_t> order(end - begin);
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = begin + i;
+	}
+	stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return costs->at(a) > costs->at(b);
+	});
+	for (size_t i = 0; i < order.size(); ++i) {
+		queues[i % numWorkers].tasks.push_back(order[i]);
+	}
+	vector<thread> workers;
+	for (int i = 1; i < numWorkers && i < (int)order.size(); ++i) {
+		workers.emplace_back(&Scheduler::work, this, i);
+	}
+	work(0); // The calling thread is worker 0
+	for (auto& t : workers) {
+		t.join();
+	}
+}
+void Scheduler::work(int id) {
+	WorkerStats& ws = stats[id];
+	size_t index;
+	while (take(id, index) || steal(id, index)) {
+		auto start = chrono::steady_clock::now();
+		task(index);
+		ws.busySeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		ws.tasks++;
+		ws.cost += costs->at(index);
+	}
+}
+bool Scheduler::take(int id, size_t& index) {
+	// Own queue: largest remaining task
+	WorkQueue& q = queues[id];
+	lock_guard<mutex> guard(q.lock);
+	if (q.tasks.empty()) {
+		return false;
+	}
+	index = q.tasks.front();
+	q.tasks.pop_front();
+	return true;
+}
+bool Scheduler::steal(int id, size_t& index) {
+	// Other queues: smallest remaining task, so the victim keeps its large ones
+	for (int i = 1; i < numWorkers; ++i) {
+		WorkQueue& q = queues[(id + i) % numWorkers];
+		lock_guard<mutex> guard(q.lock);
+		if (!q.tasks.empty()) {
+			index = q.tasks.back();
+			q.tasks.pop_back();
+			stats[id].stolen++;
+			return true;
+		}
+	}
+	return false;
+}
+const vector<WorkerStats>& Scheduler::getWorkerStats() {
+	return stats;
+}
+double Scheduler::getWallSeconds() {
+	return wallSeconds;
+}
@@ -0,0 +1,55 @@
+#ifndef _WASMDEC_SCHEDULER_H
+#define _WASMDEC_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+namespace wasmdec {
+	// Load balance information for one worker thread
+	struct WorkerStats {
+		size_t tasks; // Tasks run by this worker, including stolen ones
+		size_t stolen; // Tasks taken from another worker's queue
+		size_t cost; // Sum of the estimated cost of every task run
+		double busySeconds; // Time spent running tasks
+	};
+	// Work stealing task scheduler.
+	// Tasks are split into windows of consecutive indices whose cost fits a budget, and
+	// a window only starts once the one before it is done. Within a window, tasks are
+	// ordered by estimated cost, largest first, and dealt round robin into one queue per
+	// worker. Workers run their own queue from the largest task down and steal the
+	// smallest remaining task from another worker once their queue is empty.
+	class Scheduler {
+	public:
+		Scheduler(int);
+		// A window always holds at least one task, however large
+		void run(const vector<size_t>&, function<void(size_t)>, size_t windowCost = SIZE_MAX);
+		const vector<WorkerStats>& getWorkerStats();
+		double getWallSeconds();
+	protected:
+		struct WorkQueue {
+			mutex lock;
+			deque<size_t> tasks;
+		};
+		void runWindow(size_t, size_t);
+		void work(int);
+		bool take(int, size_t&);
+		bool steal(int, size_t&);
+
+		int numWorkers;
+		vector<WorkQueue> queues;
+		vector<WorkerStats> stats;
+		const vector<size_t>* costs;
+		function<void(size_t)> task;
+		double wallSeconds;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_SCHEDULER_H
@@ -0,0 +1,88 @@
+#include "InputFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+using namespace wasmdec;
+
+InputFile::InputFile() {
+	mapping = nullptr;
+	mappedSize = 0;
+	dataSize = 0;
+	nullTerminated = false;
+}
+InputFile::~InputFile() {
+	close();
+}
+bool InputFile::open(string path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		// Private, writable mapping: pages are shared with the page cache until
+		// something writes to them, and writes never reach the file.
+		size_t size = (size_t)st.st_size;
+		void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (m != MAP_FAILED) {
+			mapping = m;
+			mappedSize = size;
+			dataSize = size;
+			// The kernel zero fills the rest of the last page, so unless the file ends
+			// exactly on a page boundary there is a readable zero byte after it
+			long pageSize = sysconf(_SC_PAGESIZE);
+			nullTerminated = pageSize > 0 && (size % (size_t)pageSize) != 0;
+			::close(fd);
+			return true;
+		}
+	}
+	bool ok = readBuffered(fd);
+	::close(fd);
+	return ok;
+}
+bool InputFile::readBuffered(int fd) {
+	const size_t chunk = 1 << 16;
+	size_t used = 0;
+	for (;;) {
+		buffer.resize(used + chunk);
+		ssize_t n = read(fd, &buffer[used], chunk);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			buffer.clear();
+			return false;
+		}
+		if (n == 0) {
+			break;
+		}
+		used += (size_t)n;
+	}
+	buffer.resize(used + 1);
+	buffer[used] = '\0';
+	dataSize = used;
+	nullTerminated = true;
+	return true;
+}
+void InputFile::close() {
+	if (mapping) {
+		munmap(mapping, mappedSize);
+		mapping = nullptr;
+		mappedSize = 0;
+	}
+	vector<char>().swap(buffer);
+	dataSize = 0;
+	nullTerminated = false;
+}
+ByteSpan InputFile::span() {
+	if (mapping) {
+		return ByteSpan((const char*)mapping, dataSize, nullTerminated);
+	}
+	return ByteSpan(buffer.size() ? buffer.data() : "", dataSize, nullTerminated);
+}
+bool InputFile::isMapped() {
+	return mapping != nullptr;
+}
@@ -0,0 +1,52 @@
+#ifndef _WASMDEC_INPUT_FILE_H
+#define _WASMDEC_INPUT_FILE_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+using namespace std;
+
+namespace wasmdec {
+	// Non-owning view of input bytes
+	struct ByteSpan {
+		const char* data;
+		size_t size;
+		// Whether a zero byte is readable directly after the data, so text
+		// parsers can use it in place
+		bool nullTerminated;
+		ByteSpan(const char* _data, size_t _size, bool _nullTerminated) {
+			data = _data;
+			size = _size;
+			nullTerminated = _nullTerminated;
+		}
+		ByteSpan(const vector<char>& v) {
+			data = v.data();
+			size = v.size();
+			nullTerminated = false;
+		}
+	};
+	// Read-only input file.
+	// Regular files are memory mapped, so the bytes are never copied onto the heap.
+	// Pipes and other unmappable inputs fall back to a buffered read.
+	class InputFile {
+	public:
+		InputFile();
+		~InputFile();
+		bool open(string);
+		void close();
+		ByteSpan span();
+		bool isMapped();
+	protected:
+		InputFile(const InputFile&) = delete;
+		InputFile& operator=(const InputFile&) = delete;
+		bool readBuffered(int);
+
+		void* mapping;
+		size_t mappedSize;
+		size_t dataSize;
+		bool nullTerminated;
+		vector<char> buffer;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_INPUT_FILE_H
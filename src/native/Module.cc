@@ -0,0 +1,205 @@
+#include "Native.h"
+#include <unordered_set>
+using namespace wasmdec;
+
+namespace {
+	// Constant expressions of the module (global initializers, segment offsets) are
+	// written with a context of their own
+	void constantExpression(Module* m, DecompilerCtx* dctx, Expression* ex, string& out) {
+		Context ctx(m);
+		ctx.dctx = dctx;
+		ctx.hasDecompilerCtx = true;
+		native::FunctionState state;
+		ctx.native = &state;
+		Convert::parseExpr(&ctx, ex, out, false);
+	}
+	// Data segments are C strings; bytes that aren't printable are written as octal
+	// escapes, which unlike hex ones can't run into the next character
+	void dataLiteral(const vector<char>& data, string& out) {
+		const size_t lineLength = 64;
+		out += "\"";
+		for (size_t i = 0; i < data.size(); ++i) {
+			if (i && i % lineLength == 0) {
+				out += "\"\n\t\"";
+			}
+			unsigned char c = data[i];
+			if (c >= ' ' && c < 127 && c != '"' && c != '\\' && c != '?') {
+				out += (char)c;
+			} else {
+				out += '\\';
+				out += (char)('0' + (c >> 6));
+				out += (char)('0' + ((c >> 3) & 7));
+				out += (char)('0' + (c & 7));
+			}
+		}
+		out += "\"";
+	}
+}
+
+void native::globals(Module* m, DecompilerCtx* dctx, string& out) {
+	// Initializers that aren't constants in C, like imported globals, are run by wasm_init()
+	if (!m->globals.size()) {
+		return;
+	}
+	out += "/* Globals */\n";
+	for (auto& glb : m->globals) {
+		if (glb->imported()) {
+			out += "extern ";
+			out += type(glb->type);
+			out += " ";
+			dctx->symbols.getNativeGlobal(glb->name, out);
+			out += "; /* import ";
+			out += glb->module.str;
+			out += ".";
+			out += glb->base.str;
+			out += " */\n";
+			continue;
+		}
+		out += "static ";
+		out += type(glb->type);
+		out += " ";
+		dctx->symbols.getNativeGlobal(glb->name, out);
+		out += " = ";
+		if (glb->init->_id == Expression::ConstId) {
+			literal(glb->init->cast<Const>()->value, out);
+		} else {
+			out += "0";
+		}
+		out += ";\n";
+	}
+	out += "\n";
+}
+void native::prototypes(Module* m, DecompilerCtx* dctx, const vector<bool>& emitted, string& out) {
+	// Functions can call each other in any order
+	bool any = false;
+	for (size_t i = 0; i < m->functions.size(); ++i) {
+		Function* fn = m->functions[i].get();
+		if (fn->imported() || (emitted.size() && !emitted[i])) {
+			continue;
+		}
+		if (!any) {
+			out += "/* Functions */\n";
+			any = true;
+		}
+		string name;
+		dctx->symbols.getNativeName(fn->name, name);
+		out += "static ";
+		declaration(fn, name, out);
+		out += ";\n";
+	}
+	if (any) {
+		out += "\n";
+	}
+}
+void native::moduleInit(Module* m, DecompilerCtx* dctx, const vector<bool>& emitted, string& out) {
+	for (size_t i = 0; i < m->memory.segments.size(); ++i) {
+		auto& segment = m->memory.segments[i];
+		if (!segment.data.size()) {
+			continue;
+		}
+		out += "static const char wasm_data_";
+		out += to_string(i);
+		out += "[] =\n\t";
+		dataLiteral(segment.data, out);
+		out += ";\n";
+	}
+	out += "/* Sets up the memory, table and globals, then runs the start function */\n";
+	out += "void wasm_init(void) {\n";
+	uint32_t initial = m->memory.exists ? (uint32_t)m->memory.initial : 0;
+	uint32_t maximum = m->memory.exists ? min((uint32_t)m->memory.max, (uint32_t)65536) : 0;
+	out += "\twasm_memory_init(" + to_string(initial) + ", " + to_string(maximum) + ");\n";
+	for (size_t i = 0; i < m->memory.segments.size(); ++i) {
+		auto& segment = m->memory.segments[i];
+		if (!segment.data.size()) {
+			continue;
+		}
+		out += "\twasm_memory_copy(";
+		constantExpression(m, dctx, segment.offset, out);
+		out += ", wasm_data_" + to_string(i) + ", " + to_string(segment.data.size()) + ");\n";
+	}
+	uint32_t tableSize = m->table.exists ? (uint32_t)m->table.initial : 0;
+	out += "\twasm_table_init(" + to_string(tableSize) + ");\n";
+	// Pruned functions have no definition; nothing emitted can reach them through the
+	// table with a matching signature, so their entries only need to trap
+	unordered_set<const char*> pruned; // Names are interned, so keyed by pointer
+	for (size_t i = 0; i < emitted.size() && i < m->functions.size(); ++i) {
+		if (!emitted[i] && !m->functions[i]->imported()) {
+			pruned.insert(m->functions[i]->name.str);
+		}
+	}
+	for (auto& segment : m->table.segments) {
+		string base;
+		bool constant = segment.offset->_id == Expression::ConstId;
+		if (!constant) {
+			constantExpression(m, dctx, segment.offset, base);
+		}
+		for (size_t i = 0; i < segment.data.size(); ++i) {
+			out += "\twasm_table_set(";
+			if (constant) {
+				out += to_string((uint32_t)segment.offset->cast<Const>()->value.geti32() + i);
+			} else {
+				out += "(uint32_t)(" + base + ") + " + to_string(i);
+			}
+			out += ", (wasm_funcptr_t)";
+			if (pruned.count(segment.data[i].str)) {
+				out += "wasm_pruned_function";
+			} else {
+				dctx->symbols.getNativeName(segment.data[i], out);
+			}
+			Function* fn = dctx->symbols.getFunction(segment.data[i]);
+			out += ", " + to_string(fn ? dctx->symbols.getSignatureId(fn->result, fn->params) : 0) + ");\n";
+		}
+	}
+	for (auto& glb : m->globals) {
+		if (!glb->imported() && glb->init->_id != Expression::ConstId) {
+			out += "\t";
+			dctx->symbols.getNativeGlobal(glb->name, out);
+			out += " = ";
+			constantExpression(m, dctx, glb->init, out);
+			out += ";\n";
+		}
+	}
+	if (m->start.is()) {
+		out += "\t";
+		dctx->symbols.getNativeName(m->start, out);
+		out += "();\n";
+	}
+	out += "}\n";
+}
+void native::exports(Module* m, DecompilerCtx* dctx, const vector<bool>& emitted, string& out) {
+	// Every exported function gets an external wrapper named after the export
+	unordered_map<Function*, size_t> indices;
+	for (size_t i = 0; i < m->functions.size(); ++i) {
+		indices[m->functions[i].get()] = i;
+	}
+	unordered_set<string> taken;
+	for (auto& expt : m->exports) {
+		Function* fn = expt->kind == ExternalKind::Function ? dctx->symbols.getFunction(expt->value) : nullptr;
+		if (!fn || (emitted.size() && !emitted[indices[fn]])) {
+			continue;
+		}
+		string base = "wasm_export_";
+		identifier(expt->name.str, base);
+		string name = base;
+		for (size_t n = 1; !taken.insert(name).second; ++n) {
+			name = base + "_" + to_string(n);
+		}
+		out += "/* Export '";
+		out += expt->name.str;
+		out += "' */\n";
+		declaration(fn, name, out);
+		out += " {\n\t";
+		if (isConcrete(fn->result)) {
+			out += "return ";
+		}
+		dctx->symbols.getNativeName(fn->name, out);
+		out += "(";
+		for (Index i = 0; i < fn->getNumParams(); ++i) {
+			if (i) {
+				out += ", ";
+			}
+			Convert::getLocal(i, out);
+		}
+		out += ");\n}\n";
+	}
+}
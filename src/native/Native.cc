@@ -0,0 +1,665 @@
+#include "Native.h"
+#include "wasm-traversal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+using namespace wasmdec;
+using namespace wasmdec::parsers;
+
+namespace {
+	bool hasEffects(Expression* ex) {
+		switch (ex->_id) {
+			case Expression::CallId:
+			case Expression::CallIndirectId:
+			case Expression::SetLocalId:
+			case Expression::SetGlobalId:
+			case Expression::StoreId:
+			case Expression::HostId:
+			case Expression::BreakId:
+			case Expression::SwitchId:
+			case Expression::ReturnId:
+			case Expression::UnreachableId:
+			case Expression::AtomicRMWId:
+			case Expression::AtomicCmpxchgId:
+			case Expression::AtomicWaitId:
+			case Expression::AtomicWakeId:
+				return true;
+			default:
+				return false;
+		}
+	}
+	// Finds the nodes with effects and the names branches target, with tasks around
+	// every node as in util::maxDepth
+	struct EffectFinder : public PostWalker<EffectFinder, UnifiedExpressionVisitor<EffectFinder>> {
+		native::FunctionState* state;
+		vector<bool> childEffects; // Whether a child of each node being walked has effects
+		// Loops being walked, innermost last, with what counted loops are found from
+		struct LoopInfo {
+			Expression* loop;
+			bool hasLoop; // Loops aren't counted unless they are innermost
+			unordered_map<Index, size_t> writes; // Number of sets of each local
+			vector<Expression*> accesses; // Loads and stores
+		};
+		vector<LoopInfo> loops;
+		static void doEnter(EffectFinder* self, Expression** currp) {
+			self->childEffects.push_back(false);
+			if ((*currp)->_id == Expression::LoopId) {
+				if (self->loops.size()) {
+					self->loops.back().hasLoop = true;
+				}
+				self->loops.push_back(LoopInfo{*currp, false, {}, {}});
+			}
+		}
+		static void doLeave(EffectFinder* self, Expression** currp) {
+			if ((*currp)->_id == Expression::LoopId) {
+				self->loops.pop_back();
+			}
+			bool effects = self->childEffects.back() || hasEffects(*currp);
+			self->childEffects.pop_back();
+			if (effects) {
+				self->state->effects.insert(*currp);
+				if (self->childEffects.size()) {
+					self->childEffects.back() = true;
+				}
+			}
+		}
+		static void scan(EffectFinder* self, Expression** currp) {
+			self->pushTask(doLeave, currp);
+			PostWalker<EffectFinder, UnifiedExpressionVisitor<EffectFinder>>::scan(self, currp);
+			self->pushTask(doEnter, currp);
+		}
+		unordered_map<Expression*, Expression*> endingLoops; // Loop each statement block ends with
+		// get_local of a local the loop doesn't write, or a constant
+		bool isInvariant(LoopInfo& info, Expression* ex) {
+			if (ex->_id == Expression::ConstId) {
+				return ex->type == i32;
+			}
+			return ex->_id == Expression::GetLocalId && !info.writes.count(ex->cast<GetLocal>()->index);
+		}
+		bool isSameInvariant(Expression* a, Expression* b) {
+			if (!a || !b || a->_id != b->_id) {
+				return a == b;
+			}
+			if (a->is<GetLocal>()) {
+				return a->cast<GetLocal>()->index == b->cast<GetLocal>()->index;
+			}
+			return a->cast<Const>()->value.geti32() == b->cast<Const>()->value.geti32();
+		}
+		// local + step or step + local, with a positive constant step
+		bool isIncrement(Expression* ex, Index local, int32_t& step) {
+			Binary* add = ex->dynCast<Binary>();
+			if (!add || add->op != AddInt32) {
+				return false;
+			}
+			Expression* other = add->right;
+			if (!add->left->is<GetLocal>()) {
+				other = add->left;
+				if (!add->right->is<GetLocal>() || add->right->cast<GetLocal>()->index != local) {
+					return false;
+				}
+			} else if (add->left->cast<GetLocal>()->index != local) {
+				return false;
+			}
+			Const* c = other->dynCast<Const>();
+			if (!c || c->value.geti32() <= 0) {
+				return false;
+			}
+			step = c->value.geti32();
+			return true;
+		}
+		// The counter that a loop ending in "br_if $loop (cond)" compares, when cond is a
+		// tee_local of its increment, or a get_local right after a set_local of it
+		bool findCounter(LoopInfo& info, Block* body, Expression* ex, native::CountedLoop& counted) {
+			size_t size = body->list.size();
+			if (SetLocal* tee = ex->dynCast<SetLocal>()) {
+				counted.end = size - 1;
+				counted.counter = tee->index;
+				return isIncrement(tee->value, tee->index, counted.step);
+			}
+			GetLocal* get = ex->dynCast<GetLocal>();
+			if (!get || size < 3) {
+				return false;
+			}
+			SetLocal* set = body->list[size - 2]->dynCast<SetLocal>();
+			counted.end = size - 2;
+			counted.counter = get->index;
+			return set && set->index == get->index && isIncrement(set->value, set->index, counted.step);
+		}
+		// Addresses that are base + (counter << shift)
+		bool isIndexed(LoopInfo& info, Expression* ptr, Index counter, Expression*& base, unsigned& shift) {
+			base = nullptr;
+			shift = 0;
+			Binary* add = ptr->dynCast<Binary>();
+			if (add && add->op == AddInt32) {
+				if (isInvariant(info, add->left)) {
+					base = add->left;
+					ptr = add->right;
+				} else if (isInvariant(info, add->right)) {
+					base = add->right;
+					ptr = add->left;
+				} else {
+					return false;
+				}
+			}
+			Binary* shl = ptr->dynCast<Binary>();
+			if (shl && shl->op == ShlInt32 && shl->right->is<Const>()) {
+				int32_t amount = shl->right->cast<Const>()->value.geti32();
+				if (amount < 1 || amount > 3) {
+					return false;
+				}
+				shift = amount;
+				ptr = shl->left;
+			}
+			return ptr->is<GetLocal>() && ptr->cast<GetLocal>()->index == counter;
+		}
+		void countLoop(LoopInfo& info) {
+			Loop* lp = info.loop->cast<Loop>();
+			Block* body = lp->body->dynCast<Block>();
+			if (info.hasLoop || !lp->name.is() || native::isConcrete(lp->type) || state->targets[lp->name.str] != 1
+				|| !body || native::isConcrete(body->type) || (body->name.is() && state->targets[body->name.str])
+				|| body->list.size() < 2) {
+				return;
+			}
+			Break* back = body->list.back()->dynCast<Break>();
+			Binary* cond = back && back->name == lp->name && !back->value && back->condition
+				? back->condition->dynCast<Binary>() : nullptr;
+			if (!cond) {
+				return;
+			}
+			native::CountedLoop counted;
+			switch (cond->op) {
+				case LtSInt32:
+				case LtUInt32:
+					counted.bound = cond->right;
+					if (!findCounter(info, body, cond->left, counted)) {
+						return;
+					}
+					break;
+				case GtSInt32:
+				case GtUInt32:
+					counted.bound = cond->left;
+					if (!findCounter(info, body, cond->right, counted)) {
+						return;
+					}
+					break;
+				case NeInt32:
+					// Only a step of one is sure to reach the bound
+					counted.bound = cond->right;
+					if (!findCounter(info, body, cond->left, counted)) {
+						counted.bound = cond->left;
+						if (!findCounter(info, body, cond->right, counted)) {
+							return;
+						}
+					}
+					if (counted.step != 1) {
+						return;
+					}
+					break;
+				default:
+					return;
+			}
+			if (info.writes[counted.counter] != 1 || !isInvariant(info, counted.bound)
+				|| (counted.bound->is<GetLocal>() && counted.bound->cast<GetLocal>()->index == counted.counter)) {
+				return;
+			}
+			for (Expression* access : info.accesses) {
+				Load* ld = access->dynCast<Load>();
+				Store* st = access->dynCast<Store>();
+				if ((ld && ld->isAtomic) || (st && st->isAtomic)) {
+					continue;
+				}
+				Expression* base;
+				unsigned shift;
+				if (!isIndexed(info, ld ? ld->ptr : st->ptr, counted.counter, base, shift)) {
+					continue;
+				}
+				state->wideAccesses[access] = native::WideAccess{lp, base, shift};
+				if (!base && !shift) {
+					continue;
+				}
+				// Every distinct base is checked once before the loop
+				bool known = false;
+				for (auto& b : counted.bases) {
+					known = known || (b.second == shift && isSameInvariant(b.first, base));
+				}
+				if (!known) {
+					counted.bases.push_back(make_pair(base, shift));
+				}
+			}
+			state->counted[lp] = counted;
+		}
+		void visitExpression(Expression* curr) {
+			if (loops.size()) {
+				if (curr->_id == Expression::SetLocalId) {
+					loops.back().writes[curr->cast<SetLocal>()->index]++;
+				} else if (curr->_id == Expression::LoadId || curr->_id == Expression::StoreId) {
+					loops.back().accesses.push_back(curr);
+				} else if (curr->_id == Expression::LoopId) {
+					countLoop(loops.back());
+				}
+			}
+			if (curr->_id == Expression::BreakId) {
+				state->targets[curr->cast<Break>()->name.str]++;
+			} else if (curr->_id == Expression::SwitchId) {
+				Switch* sw = curr->cast<Switch>();
+				for (Index i = 0; i < sw->targets.size(); ++i) {
+					state->targets[sw->targets[i].str]++;
+				}
+				state->targets[sw->default_.str]++;
+			} else if (curr->_id == Expression::BlockId) {
+				// Children are visited first, so blocks that end with a block ending with a
+				// loop are found too
+				Block* blck = curr->cast<Block>();
+				if (!blck->list.size() || native::isConcrete(blck->type)) {
+					return;
+				}
+				Expression* last = blck->list.back();
+				Expression* loop = nullptr;
+				if (last->_id == Expression::LoopId && !native::isConcrete(last->type)) {
+					loop = last;
+				} else if (last->_id == Expression::BlockId && endingLoops.count(last)) {
+					loop = endingLoops[last];
+				}
+				if (loop) {
+					endingLoops[curr] = loop;
+					if (blck->name.is()) {
+						state->loopExits[loop].push_back(blck->name);
+					}
+				}
+			}
+		}
+	};
+	// Kinds of expression that are always written as C values
+	bool isValueKind(Expression* ex) {
+		switch (ex->_id) {
+			case Expression::ConstId:
+			case Expression::GetLocalId:
+			case Expression::GetGlobalId:
+			case Expression::LoadId:
+			case Expression::UnaryId:
+			case Expression::BinaryId:
+			case Expression::SelectId:
+			case Expression::CallId:
+			case Expression::CallIndirectId:
+			case Expression::HostId:
+			case Expression::AtomicRMWId:
+			case Expression::AtomicCmpxchgId:
+			case Expression::AtomicWaitId:
+			case Expression::AtomicWakeId:
+				return true;
+			case Expression::SetLocalId:
+				return ex->cast<SetLocal>()->isTee();
+			default:
+				return false;
+		}
+	}
+	const char* cKeywords[] = { "auto", "break", "case", "char", "const", "continue", "default", "do",
+		"double", "else", "enum", "extern", "float", "for", "goto", "if", "inline", "int", "long",
+		"register", "restrict", "return", "short", "signed", "sizeof", "static", "struct", "switch",
+		"typedef", "union", "unsigned", "void", "volatile", "while" };
+}
+
+void native::FunctionState::analyze(Expression* body) {
+	EffectFinder finder;
+	finder.state = this;
+	finder.walk(body);
+}
+void native::expression(Context* ctx, Frame& f, string& out) {
+	if (f.step == 0) {
+		if (!f.statement && f.ex->type == wasm::unreachable) {
+			// Code that never completes where a value is expected
+			out += "({\n";
+			ctx->depth++;
+			f.statement = true;
+			f.wrapped = true;
+		}
+		if (f.statement) {
+			bool isBody = ctx->fn && f.ex == ctx->fn->body;
+			if (isConcrete(f.ex->type) && !isBody) {
+				// A value nothing uses
+				f.statement = false;
+				f.terminate = true;
+			} else {
+				f.terminate = isValueKind(f.ex);
+			}
+			if (f.terminate) {
+				util::tab(ctx->depth, out);
+			}
+		}
+	}
+	switch (f.ex->_id) {
+		case Expression::BlockId:
+			native::block(ctx, f, out);
+			break;
+		case Expression::IfId:
+			native::_if(ctx, f, out);
+			break;
+		case Expression::LoopId:
+			native::loop(ctx, f, out);
+			break;
+		case Expression::BreakId:
+			native::_break(ctx, f, out);
+			break;
+		case Expression::SwitchId:
+			native::_switch(ctx, f, out);
+			break;
+		case Expression::CallId:
+			native::call(ctx, f, out);
+			break;
+		case Expression::CallIndirectId:
+			native::call_indirect(ctx, f, out);
+			break;
+		case Expression::GetLocalId:
+			native::get_local(ctx, f, out);
+			break;
+		case Expression::SetLocalId:
+			native::set_local(ctx, f, out);
+			break;
+		case Expression::GetGlobalId:
+			native::get_global(ctx, f, out);
+			break;
+		case Expression::SetGlobalId:
+			native::set_global(ctx, f, out);
+			break;
+		case Expression::LoadId:
+			native::load(ctx, f, out);
+			break;
+		case Expression::StoreId:
+			native::store(ctx, f, out);
+			break;
+		case Expression::ConstId:
+			native::_const(ctx, f, out);
+			break;
+		case Expression::UnaryId:
+			native::unary(ctx, f, out);
+			break;
+		case Expression::BinaryId:
+			native::binary(ctx, f, out);
+			break;
+		case Expression::SelectId:
+			native::select(ctx, f, out);
+			break;
+		case Expression::DropId:
+			native::drop(ctx, f, out);
+			break;
+		case Expression::ReturnId:
+			native::_return(ctx, f, out);
+			break;
+		case Expression::HostId:
+			native::host(ctx, f, out);
+			break;
+		case Expression::NopId:
+			break;
+		case Expression::UnreachableId:
+			native::unreachable(ctx, f, out);
+			break;
+		default:
+			native::unsupported(ctx, f, out);
+			break;
+	}
+}
+void native::finish(Context* ctx, Frame& f, string& out) {
+	if (f.terminate) {
+		out += ";\n";
+	}
+	if (f.wrapped) {
+		// The value is never used, any will do
+		util::tab(ctx->depth, out);
+		out += "0;\n";
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "})";
+	}
+}
+void native::declaration(Function* fn, const string& name, string& out) {
+	out += type(fn->result);
+	out += " ";
+	out += name;
+	out += "(";
+	for (Index i = 0; i < fn->getNumParams(); ++i) {
+		if (i) {
+			out += ", ";
+		}
+		out += type(fn->params[i]);
+		out += " ";
+		Convert::getLocal(i, out);
+	}
+	if (!fn->getNumParams()) {
+		out += "void";
+	}
+	out += ")";
+}
+void native::functionBody(Context* ctx, string& out) {
+	Function* fn = ctx->fn;
+	out += " {\n";
+	// Locals start at zero in wasm
+	for (Index i = fn->getNumParams(); i < fn->getNumLocals(); ++i) {
+		out += "\t";
+		out += type(fn->getLocalType(i));
+		out += " ";
+		Convert::getLocal(i, out);
+		out += " = 0;\n";
+	}
+	FunctionState state;
+	state.analyze(fn->body);
+	ctx->native = &state;
+	ctx->depth = 1;
+	size_t bodyStart = out.size();
+	if (fn->body->_id != Expression::BlockId && isConcrete(fn->result) && isConcrete(fn->body->type)) {
+		out += "\treturn ";
+		Convert::parseExpr(ctx, fn->body, out, false);
+		out += ";\n";
+	} else {
+		Convert::parseExpr(ctx, fn->body, out, true);
+	}
+	// Labels are defined before it's known whether break and continue reach them
+	removeUnusedLabels(ctx, out, bodyStart);
+	ctx->native = nullptr;
+	out += "}";
+}
+bool native::needsTemporaries(Context* ctx, const vector<Expression*>& operands) {
+	size_t nonConstant = 0;
+	bool effects = false;
+	for (auto* op : operands) {
+		nonConstant += op->_id != Expression::ConstId;
+		effects = effects || ctx->native->effects.count(op);
+	}
+	return effects && nonConstant > 1;
+}
+bool native::hoist(Context* ctx, Frame& f, const vector<Expression*>& operands, string& out) {
+	if (f.index == 0) {
+		f.temp = ctx->native->temps;
+		ctx->native->temps += operands.size();
+		out += "({ ";
+	} else {
+		out += "; ";
+	}
+	if (f.index < operands.size()) {
+		Expression* op = operands[f.index];
+		out += type(isConcrete(op->type) ? op->type : i32);
+		out += " ";
+		out += temporary(f, f.index);
+		out += " = ";
+		f.index++;
+		f.visit(op, f.step);
+		return true;
+	}
+	return false;
+}
+string native::temporary(Frame& f, size_t i) {
+	return "wasm_t" + to_string(f.temp + i);
+}
+const char* native::type(Type t) {
+	switch (t) {
+		case i32:
+			return "int32_t";
+		case i64:
+			return "int64_t";
+		case f32:
+			return "float";
+		case f64:
+			return "double";
+		default:
+			return "void";
+	}
+}
+bool native::isConcrete(Type t) {
+	return t == i32 || t == i64 || t == f32 || t == f64;
+}
+void native::literal(Literal value, string& out) {
+	char text[64];
+	switch (value.type) {
+		case i32: {
+			int32_t v = value.geti32();
+			out += v == INT32_MIN ? "(-2147483647 - 1)" : to_string(v);
+			break;
+		}
+		case i64: {
+			int64_t v = value.geti64();
+			if (v == INT64_MIN) {
+				out += "(-INT64_C(9223372036854775807) - 1)";
+			} else {
+				out += "INT64_C(";
+				out += to_string(v);
+				out += ")";
+			}
+			break;
+		}
+		case f32:
+		case f64: {
+			// Hex floats are exact. Infinities and NaNs, which keep their payload, use
+			// builtins that are still constant expressions for global initializers.
+			bool isF32 = value.type == f32;
+			double v = isF32 ? value.getf32() : value.getf64();
+			if (std::isfinite(v)) {
+				snprintf(text, sizeof(text), isF32 ? "%af" : "%a", v);
+				out += text;
+				break;
+			}
+			uint64_t bits = isF32 ? (uint32_t)value.reinterpreti32() : (uint64_t)value.reinterpreti64();
+			uint64_t payload = bits & (isF32 ? 0x7fffffULL : 0xfffffffffffffULL);
+			uint64_t quiet = isF32 ? 0x400000ULL : 0x8000000000000ULL;
+			bool negative = bits >> (isF32 ? 31 : 63);
+			out += negative ? "(-" : "(";
+			if (!payload) {
+				out += isF32 ? "__builtin_inff()" : "__builtin_inf()";
+			} else {
+				snprintf(text, sizeof(text), "%s%s(\"0x%llx\")", payload & quiet ? "__builtin_nan" : "__builtin_nans",
+					isF32 ? "f" : "", (unsigned long long)(payload & ~quiet));
+				out += text;
+			}
+			out += ")";
+			break;
+		}
+		default:
+			out += "0";
+			break;
+	}
+}
+void native::identifier(const char* s, string& out) {
+	for (; *s; ++s) {
+		char c = *s;
+		bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+		out += valid ? c : '_';
+	}
+}
+bool native::isKeyword(const string& s) {
+	for (const char* keyword : cKeywords) {
+		if (s == keyword) {
+			return true;
+		}
+	}
+	return false;
+}
+native::Label& native::pushLabel(Context* ctx, Name name, Type t, bool isFunction) {
+	FunctionState* state = ctx->native;
+	string base;
+	identifier(name.str, base);
+	string cName = base;
+	for (size_t n = 1; state->labelNames.count(cName); ++n) {
+		// Labels may be shadowed in wasm, not in C
+		cName = base + "_" + to_string(n);
+	}
+	state->labelNames.insert(cName);
+	state->labels.push_back(Label{name, cName, t, isFunction});
+	return state->labels.back();
+}
+native::Label* native::findLabel(Context* ctx, Name name) {
+	auto& labels = ctx->native->labels;
+	for (size_t i = labels.size(); i > 0; --i) {
+		if (labels[i - 1].name == name) {
+			return &labels[i - 1];
+		}
+	}
+	return nullptr;
+}
+bool native::isTargeted(Context* ctx, Name name) {
+	auto it = ctx->native->targets.find(name.str);
+	return it != ctx->native->targets.end() && it->second > 0;
+}
+void native::jump(Context* ctx, Label* label, const string& value, string& out) {
+	FunctionState* state = ctx->native;
+	if (!label) {
+		out += "wasm_trap(\"branch to an unknown label\");";
+		return;
+	} else if (label->isFunction) {
+		out += value.size() && isConcrete(label->type) ? "return " + value + ";" : string("return;");
+		return;
+	} else if (value.size() && isConcrete(label->type)) {
+		out += "{ ";
+		out += label->valueName();
+		out += " = ";
+		out += value;
+		out += "; goto ";
+		out += label->cName;
+		out += "; }";
+		state->gotoLabels.insert(label->cName);
+		return;
+	}
+	if (state->constructs.size()) {
+		for (auto& exit : state->constructs.back().exits) {
+			if (exit == label->name) {
+				out += "break;";
+				return;
+			}
+		}
+		// continue skips over switches, to the innermost loop
+		for (size_t i = state->constructs.size(); i > 0; --i) {
+			Construct& construct = state->constructs[i - 1];
+			if (!construct.isSwitch) {
+				if (construct.loop.is() && construct.loop == label->name) {
+					out += "continue;";
+					return;
+				}
+				break;
+			}
+		}
+	}
+	out += "goto ";
+	out += label->cName;
+	out += ";";
+	state->gotoLabels.insert(label->cName);
+}
+void native::removeUnusedLabels(Context* ctx, string& out, size_t start) {
+	// Labels are defined on lines of their own, as "name: ;"
+	FunctionState* state = ctx->native;
+	size_t read = start, write = start;
+	while (read < out.size()) {
+		size_t eol = out.find('\n', read);
+		eol = eol == string::npos ? out.size() : eol + 1;
+		size_t text = out.find_first_not_of('\t', read);
+		bool unused = false;
+		if (text < eol && eol - text > 4 && out.compare(eol - 4, 4, ": ;\n") == 0) {
+			string name = out.substr(text, eol - 4 - text);
+			unused = state->labelNames.count(name) && !state->gotoLabels.count(name);
+		}
+		if (!unused) {
+			if (write != read) {
+				copy(out.begin() + read, out.begin() + eol, out.begin() + write);
+			}
+			write += eol - read;
+		}
+		read = eol;
+	}
+	out.resize(write);
+}
@@ -0,0 +1,148 @@
+#ifndef _WASMDEC_NATIVE_H
+#define _WASMDEC_NATIVE_H
+
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include "../parsers/parser.h"
+using namespace std;
+
+namespace wasmdec {
+	// The compilable backend. Unlike the parsers, which aim for readable C, every
+	// expression is written with its exact wasm semantics against the runtime that
+	// Emitter::runtime() writes, so the output can be built and run natively.
+	namespace native {
+		// A block or loop that branches can target
+		struct Label {
+			Name name;
+			string cName;
+			Type type; // Type of the value branches to it carry, none for loops
+			bool isFunction; // The body of the function; branching to it returns
+			// Variable that branches store their value in
+			string valueName() const {
+				return "wasm_value_" + cName;
+			}
+		};
+		// A C loop or switch being written, which break and continue refer to
+		struct Construct {
+			bool isSwitch;
+			Name loop; // Label that continue branches to, none for switches and do-while
+			vector<Name> exits; // Labels that break branches to: those whose end is the construct's end
+		};
+		// An innermost loop that runs a counter from its value on entry up to a bound,
+		// as "do { body; i += step; } while (i < bound)" compiles to wasm. It is written
+		// as a C for loop over the counter when a check before it shows the counter and
+		// the addresses it indexes can't wrap, and as the general loop otherwise.
+		struct CountedLoop {
+			Index counter;
+			int32_t step;
+			Expression* bound; // A constant or a local the loop doesn't write
+			Index end; // Statements of the body before the increment
+			// Loop invariant bases of the accesses at base + (counter << shift), null
+			// when the counter is the whole address
+			vector<pair<Expression*, unsigned>> bases;
+		};
+		// A load or store whose address is base + (counter << shift) in a counted loop.
+		// There it is accessed at base + offset + (counter << shift) in 64 bits, which
+		// compilers see as affine in the counter, so they can vectorize the loop.
+		struct WideAccess {
+			Expression* loop;
+			Expression* base;
+			unsigned shift;
+		};
+		// State of the function being written
+		struct FunctionState {
+			vector<Label> labels; // Enclosing labels, innermost last
+			unordered_set<string> labelNames; // C labels used so far in the function
+			unordered_set<string> gotoLabels; // C labels that some goto refers to
+			vector<Construct> constructs; // Enclosing C loops and switches, innermost last
+			unordered_map<const char*, size_t> targets; // Number of branches to each name
+			// Names of the blocks that end right after each loop, so branching to them
+			// leaves the loop
+			unordered_map<Expression*, vector<Name>> loopExits;
+			// Nodes that branch or write state, themselves or in a child. Operands of a node
+			// are hoisted into temporaries when one of them is in here, since C leaves the
+			// order of evaluation of operands unspecified.
+			unordered_set<Expression*> effects;
+			unordered_map<Expression*, CountedLoop> counted; // Keyed by the loop
+			unordered_map<Expression*, WideAccess> wideAccesses;
+			Expression* counting = nullptr; // Counted loop whose for statement is being written
+			size_t temps = 0; // Temporaries declared so far
+			void analyze(Expression*);
+		};
+
+		// Dispatches a frame, as parsers::expression does
+		void expression(Context*, parsers::Frame&, string&);
+		// Called once a frame is done, to close what expression() opened around it
+		void finish(Context*, parsers::Frame&, string&);
+		// Declaration of a function under the given C name
+		void declaration(Function*, const string& name, string&);
+		// Locals and body of the function of the context, starting with " {"
+		void functionBody(Context*, string&);
+		// Module level code around the functions: globals, prototypes of the defined
+		// functions, then wasm_init() and a wrapper for every exported function.
+		// Prototypes are only written for the functions that are emitted, all of them
+		// when the vector is empty; table entries of functions that aren't emitted get a
+		// stub that traps.
+		void globals(Module*, DecompilerCtx*, string&);
+		void prototypes(Module*, DecompilerCtx*, const vector<bool>& emitted, string&);
+		void moduleInit(Module*, DecompilerCtx*, const vector<bool>& emitted, string&);
+		void exports(Module*, DecompilerCtx*, const vector<bool>& emitted, string&);
+
+		void block(Context*, parsers::Frame&, string&);
+		void loop(Context*, parsers::Frame&, string&);
+		void _if(Context*, parsers::Frame&, string&);
+		void _break(Context*, parsers::Frame&, string&);
+		void _switch(Context*, parsers::Frame&, string&);
+		void _return(Context*, parsers::Frame&, string&);
+		void drop(Context*, parsers::Frame&, string&);
+		void unreachable(Context*, parsers::Frame&, string&);
+		void call(Context*, parsers::Frame&, string&);
+		void call_indirect(Context*, parsers::Frame&, string&);
+		void get_local(Context*, parsers::Frame&, string&);
+		void set_local(Context*, parsers::Frame&, string&);
+		void get_global(Context*, parsers::Frame&, string&);
+		void set_global(Context*, parsers::Frame&, string&);
+		void load(Context*, parsers::Frame&, string&);
+		void store(Context*, parsers::Frame&, string&);
+		void _const(Context*, parsers::Frame&, string&);
+		void unary(Context*, parsers::Frame&, string&);
+		void binary(Context*, parsers::Frame&, string&);
+		void select(Context*, parsers::Frame&, string&);
+		void host(Context*, parsers::Frame&, string&);
+		void unsupported(Context*, parsers::Frame&, string&);
+
+		// Operators of the strict trap mode call checked runtime helpers, those of the
+		// fast one are plain C, see DisasmConfig::fastTraps
+		OperatorSyntax getBinOperator(BinaryOp, bool fast);
+		OperatorSyntax getUnary(UnaryOp, bool fast);
+		// Operands are evaluated into temporaries "wasm_tN" first when some of them have
+		// effects and more than one isn't a constant. Call it at the resume step from the
+		// first call on; it returns true while an operand is queued, then the parser
+		// writes its expression over temporary(f, i) and closes it with " })".
+		bool needsTemporaries(Context*, const vector<Expression*>&);
+		bool hoist(Context*, parsers::Frame&, const vector<Expression*>&, string&);
+		string temporary(parsers::Frame&, size_t);
+
+		const char* type(Type);
+		bool isConcrete(Type);
+		void literal(Literal, string&);
+		// Writes a get_local or a constant, as the bounds and bases of counted loops are
+		void invariant(Expression*, string&);
+		// Appends s with every character C doesn't allow in identifiers replaced by '_'
+		void identifier(const char* s, string&);
+		bool isKeyword(const string&);
+		// Label helpers
+		Label& pushLabel(Context*, Name, Type, bool isFunction);
+		Label* findLabel(Context*, Name);
+		bool isTargeted(Context*, Name);
+		// Jumps to a label, passing the given C value to it when it isn't empty. Jumps
+		// are break or continue when the innermost C loop or switch allows, else goto.
+		void jump(Context*, Label*, const string& value, string&);
+		// Removes the definitions of the labels of the function that no goto refers to,
+		// from the given output position on
+		void removeUnusedLabels(Context*, string&, size_t start);
+	}
+}
+
+#endif // _WASMDEC_NATIVE_H
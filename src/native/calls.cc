@@ -0,0 +1,118 @@
+#include "Native.h"
+using namespace wasmdec;
+using namespace wasmdec::parsers;
+
+namespace {
+	vector<Expression*> operandsOf(ExpressionList& list) {
+		vector<Expression*> operands;
+		operands.reserve(list.size() + 1);
+		for (Index i = 0; i < list.size(); ++i) {
+			operands.push_back(list[i]);
+		}
+		return operands;
+	}
+	// Writes the operands in place, separated by commas; true while one is queued
+	bool operandList(Frame& f, ExpressionList& list, string& out) {
+		if (f.index < list.size()) {
+			if (f.index) {
+				out += ", ";
+			}
+			f.visit(list[f.index++], f.step);
+			return true;
+		}
+		out += ")";
+		return false;
+	}
+	void functionPointer(FunctionType* ft, string& out) {
+		out += "(";
+		out += native::type(ft->result);
+		out += " (*)(";
+		for (size_t i = 0; i < ft->params.size(); ++i) {
+			if (i) {
+				out += ", ";
+			}
+			out += native::type(ft->params[i]);
+		}
+		if (ft->params.empty()) {
+			out += "void";
+		}
+		out += "))";
+	}
+	string signature(Context* ctx, FunctionType* ft) {
+		return to_string(ctx->dctx->symbols.getSignatureId(ft->result, ft->params));
+	}
+}
+
+void native::call(Context* ctx, Frame& f, string& out) {
+	Call* cl = f.ex->cast<Call>();
+	if (f.step == 0) {
+		f.step = 1;
+		if (needsTemporaries(ctx, operandsOf(cl->operands))) {
+			f.hoisted = true;
+		} else {
+			ctx->dctx->symbols.getNativeName(cl->target, out);
+			out += "(";
+		}
+	}
+	if (!f.hoisted) {
+		operandList(f, cl->operands, out);
+		return;
+	}
+	if (hoist(ctx, f, operandsOf(cl->operands), out)) {
+		return;
+	}
+	ctx->dctx->symbols.getNativeName(cl->target, out);
+	out += "(";
+	for (size_t i = 0; i < cl->operands.size(); ++i) {
+		out += i ? ", " : "";
+		out += temporary(f, i);
+	}
+	out += "); })";
+}
+void native::call_indirect(Context* ctx, Frame& f, string& out) {
+	// The table holds untyped function pointers, cast to the call's signature once
+	// wasm_table_get has checked the entry has it. wasm evaluates the operands before
+	// the index.
+	CallIndirect* ci = f.ex->cast<CallIndirect>();
+	FunctionType* ft = ctx->dctx->symbols.getFunctionType(ci->fullType);
+	if (!ft) {
+		out += "wasm_unsupported()";
+		return;
+	}
+	if (f.step == 0) {
+		vector<Expression*> operands = operandsOf(ci->operands);
+		operands.push_back(ci->target);
+		if (needsTemporaries(ctx, operands)) {
+			f.hoisted = true;
+			f.step = 1;
+		} else {
+			out += "(";
+			functionPointer(ft, out);
+			out += "wasm_table_get(";
+			return f.visit(ci->target, 1);
+		}
+	}
+	if (f.hoisted) {
+		vector<Expression*> operands = operandsOf(ci->operands);
+		operands.push_back(ci->target);
+		if (hoist(ctx, f, operands, out)) {
+			return;
+		}
+		out += "(";
+		functionPointer(ft, out);
+		out += "wasm_table_get(";
+		out += temporary(f, ci->operands.size());
+		out += ", " + signature(ctx, ft) + "))(";
+		for (size_t i = 0; i < ci->operands.size(); ++i) {
+			out += i ? ", " : "";
+			out += temporary(f, i);
+		}
+		out += "); })";
+		return;
+	}
+	if (f.step == 1) {
+		out += ", " + signature(ctx, ft) + "))(";
+		f.step = 2;
+	}
+	operandList(f, ci->operands, out);
+}
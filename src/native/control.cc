@@ -0,0 +1,681 @@
+#include "Native.h"
+using namespace wasmdec;
+using namespace wasmdec::parsers;
+
+namespace {
+	bool isStatementBlock(Expression* ex) {
+		Block* blck = ex->dynCast<Block>();
+		return blck && blck->name.is() && !native::isConcrete(blck->type);
+	}
+	// Blocks nested as the first statement of each other, the innermost ending with a
+	// br_table to them, are how switch statements compile to wasm: the code after
+	// each block is the case the br_table branches to it for. The chain is outermost first.
+	bool switchChain(Context* ctx, Frame& f, Block* outer, vector<Block*>& chain) {
+		if (!f.statement || !isStatementBlock(outer) || (ctx->fn && outer == ctx->fn->body)) {
+			return false;
+		}
+		Block* blck = outer;
+		while (blck->list.size() && !blck->list.back()->is<Switch>()) {
+			chain.push_back(blck);
+			if (!isStatementBlock(blck->list[0])) {
+				return false;
+			}
+			blck = blck->list[0]->cast<Block>();
+		}
+		chain.push_back(blck);
+		if (chain.size() < 2 || !blck->list.size()) {
+			return false;
+		}
+		Switch* sw = blck->list.back()->cast<Switch>();
+		if (sw->value) {
+			return false;
+		}
+		auto inChain = [&](Name name) {
+			for (Block* b : chain) {
+				if (b->name == name) {
+					return true;
+				}
+			}
+			return false;
+		};
+		for (Index i = 0; i < sw->targets.size(); ++i) {
+			if (!inChain(sw->targets[i])) {
+				return false;
+			}
+		}
+		return inChain(sw->default_);
+	}
+	// Case labels of the code after the given block
+	void caseLabels(Context* ctx, Switch* sw, Name target, string& out) {
+		for (Index i = 0; i < sw->targets.size(); ++i) {
+			if (sw->targets[i] == target && target != sw->default_) {
+				util::tab(ctx->depth, out);
+				out += "case " + to_string(i) + ":\n";
+			}
+		}
+		if (sw->default_ == target) {
+			util::tab(ctx->depth, out);
+			out += "default:\n";
+		}
+	}
+	void switchBlock(Context* ctx, Frame& f, vector<Block*>& chain, string& out) {
+		// f.temp is the block whose case is being written, f.index the statement
+		enum { Prefix = 1, Cases, Section };
+		Block* outer = chain.front();
+		Block* inner = chain.back();
+		Switch* sw = inner->list.back()->cast<Switch>();
+		if (f.step == 0) {
+			for (Block* blck : chain) {
+				native::pushLabel(ctx, blck->name, none, false);
+			}
+			f.step = Prefix;
+		}
+		if (f.step == Prefix) {
+			if (f.index + 1 < inner->list.size()) {
+				return f.visitStatement(inner->list[f.index++], Prefix);
+			}
+			util::tab(ctx->depth, out);
+			out += "switch ((uint32_t)(";
+			return f.visit(sw->condition, Cases);
+		}
+		if (f.step == Cases) {
+			// Breaking out of the switch leaves the outermost block. Cases are written
+			// one level deeper than the switch, until it ends.
+			out += ")) {\n";
+			ctx->native->constructs.push_back(native::Construct{true, Name(), vector<Name>{outer->name}});
+			if (sw->default_ != outer->name) {
+				// Entries to the outermost block leave the switch rather than falling
+				// into the default case
+				bool any = false;
+				for (Index i = 0; i < sw->targets.size(); ++i) {
+					if (sw->targets[i] == outer->name) {
+						util::tab(ctx->depth, out);
+						out += "case " + to_string(i) + ":\n";
+						any = true;
+					}
+				}
+				if (any) {
+					util::tab(ctx->depth + 1, out);
+					out += "break;\n";
+				}
+			}
+			f.temp = chain.size() - 1;
+			f.index = 1;
+			caseLabels(ctx, sw, chain[f.temp]->name, out);
+			ctx->depth++;
+			util::tab(ctx->depth, out);
+			out += native::findLabel(ctx, chain[f.temp]->name)->cName + ": ;\n";
+			f.step = Section;
+		}
+		while (true) {
+			Block* section = chain[f.temp - 1];
+			if (f.index < section->list.size()) {
+				return f.visitStatement(section->list[f.index++], Section);
+			}
+			if (f.temp == 1) {
+				break;
+			}
+			f.temp--;
+			f.index = 1;
+			ctx->depth--;
+			caseLabels(ctx, sw, chain[f.temp]->name, out);
+			ctx->depth++;
+			util::tab(ctx->depth, out);
+			out += native::findLabel(ctx, chain[f.temp]->name)->cName + ": ;\n";
+		}
+		if (outer->list.size() < 2 || outer->list.back()->type != wasm::unreachable) {
+			// The last case needs a statement, since its label may be removed and
+			// statements like nop write nothing
+			util::tab(ctx->depth, out);
+			out += "break;\n";
+		}
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "}\n";
+		ctx->native->constructs.pop_back();
+		util::tab(ctx->depth, out);
+		out += native::findLabel(ctx, outer->name)->cName + ": ;\n";
+		for (size_t i = 0; i < chain.size(); ++i) {
+			ctx->native->labels.pop_back();
+		}
+	}
+}
+
+void native::block(Context* ctx, Frame& f, string& out) {
+	// Statement blocks are written flat, value blocks as GNU statement expressions.
+	// A targeted block is followed by its label; when branches to it carry a value,
+	// they store it in a variable that the block ends with.
+	Block* blck = f.ex->cast<Block>();
+	vector<Block*> chain;
+	if (switchChain(ctx, f, blck, chain)) {
+		return switchBlock(ctx, f, chain, out);
+	}
+	bool isFunction = ctx->fn && f.ex == ctx->fn->body;
+	bool hasLabel = blck->name.is();
+	bool targeted = hasLabel && !isFunction && isTargeted(ctx, blck->name);
+	bool hasValueName = targeted && !f.statement && isConcrete(blck->type);
+	size_t count = blck->list.size();
+	// The last child is returned from the function, or is the value of the block
+	bool lastIsValue = count && isConcrete(blck->list.back()->type)
+		&& (isFunction ? isConcrete(ctx->fn->result) : !f.statement);
+	if (f.step == 0) {
+		if (hasLabel) {
+			pushLabel(ctx, blck->name, isFunction ? ctx->fn->result : blck->type, isFunction);
+		}
+		if (!f.statement) {
+			out += "({\n";
+			ctx->depth++;
+		}
+		if (hasValueName) {
+			util::tab(ctx->depth, out);
+			out += type(blck->type);
+			out += " ";
+			out += findLabel(ctx, blck->name)->valueName();
+			out += ";\n";
+		}
+		f.step = 1;
+	}
+	if (f.step == 2) {
+		// After the value of the block
+		out += ";\n";
+	} else if (f.index < count) {
+		Expression* child = blck->list[f.index++];
+		if (f.index < count || !lastIsValue) {
+			return f.visitStatement(child, 1);
+		}
+		util::tab(ctx->depth, out);
+		if (isFunction) {
+			out += "return ";
+		} else if (hasValueName) {
+			out += findLabel(ctx, blck->name)->valueName();
+			out += " = ";
+		}
+		return f.visit(child, 2);
+	}
+	if (hasLabel) {
+		if (targeted) {
+			Label* label = findLabel(ctx, blck->name);
+			util::tab(ctx->depth, out);
+			out += label->cName;
+			out += ": ;\n";
+			if (hasValueName) {
+				util::tab(ctx->depth, out);
+				out += label->valueName();
+				out += ";\n";
+			}
+		}
+		ctx->native->labels.pop_back();
+	}
+	if (!f.statement) {
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "})";
+	}
+}
+namespace {
+	// C statements a loop is written as, see loopShape
+	enum LoopKind {
+		GotoLoop, // A label at the start that branches go back to
+		ForLoop, // for (;;) { body }, when the body ends branching back
+		WhileLoop, // while (!(exit condition)) { body }
+		DoWhileLoop, // do { body } while (condition)
+		UntilLoop, // for (;;) { body if (!(condition)) break; }
+		OnceLoop // for (;;) { body break; }, when the body ends falling out
+	};
+	struct LoopShape {
+		LoopKind kind;
+		Index first, end; // Statements of the body written inside the loop
+		Expression* condition;
+		// A counted loop, written as a for statement over its counter when the check
+		// before it holds, and in this shape otherwise
+		bool counted;
+	};
+	// The statements of a loop's body, which is often an unnamed block
+	bool isFlatBody(Context* ctx, Loop* lp) {
+		Block* body = lp->body->dynCast<Block>();
+		return body && !native::isConcrete(body->type) && (!body->name.is() || !native::isTargeted(ctx, body->name));
+	}
+	Index loopSize(Context* ctx, Loop* lp) {
+		return isFlatBody(ctx, lp) ? lp->body->cast<Block>()->list.size() : 1;
+	}
+	Expression* loopStatement(Context* ctx, Loop* lp, Index i) {
+		return isFlatBody(ctx, lp) ? lp->body->cast<Block>()->list[i] : lp->body;
+	}
+	Break* branchTo(Expression* ex, Name name) {
+		Break* br = ex->dynCast<Break>();
+		return br && br->name == name && !br->value ? br : nullptr;
+	}
+	bool isExit(Context* ctx, Loop* lp, Name name) {
+		auto it = ctx->native->loopExits.find(lp);
+		if (it == ctx->native->loopExits.end()) {
+			return false;
+		}
+		for (auto& exit : it->second) {
+			if (exit == name) {
+				return true;
+			}
+		}
+		return false;
+	}
+	// Loops that end by branching back become for (;;), with a while condition when
+	// they start by branching out; conditional branches back at the end become
+	// do-while. Conditions only move into the loop statement when they have no effects,
+	// since they may then be evaluated where break and continue mean something else.
+	LoopShape loopShape(Context* ctx, Frame& f, Loop* lp) {
+		Index size = loopSize(ctx, lp);
+		if (!f.statement || native::isConcrete(lp->type) || !lp->name.is() || !native::isTargeted(ctx, lp->name) || !size) {
+			return {GotoLoop, 0, size, nullptr, false};
+		}
+		Break* back = branchTo(loopStatement(ctx, lp, size - 1), lp->name);
+		if (!back) {
+			return {OnceLoop, 0, size, nullptr, false};
+		}
+		if (!back->condition) {
+			Break* out = size > 1 ? loopStatement(ctx, lp, 0)->dynCast<Break>() : nullptr;
+			if (out && out->condition && !out->value && isExit(ctx, lp, out->name) && !ctx->native->effects.count(out->condition)) {
+				return {WhileLoop, 1, size - 1, out->condition, false};
+			}
+			return {ForLoop, 0, size - 1, nullptr, false};
+		}
+		bool counted = ctx->native->counted.count(lp) > 0;
+		if (ctx->native->targets[lp->name.str] == 1 && !ctx->native->effects.count(back->condition)) {
+			return {DoWhileLoop, 0, size - 1, back->condition, counted};
+		}
+		return {UntilLoop, 0, size - 1, back->condition, counted};
+	}
+	// A counted loop runs as "for (; i < bound; i += step)" when the counter starts
+	// between zero and the bound and neither it nor any address it indexes can pass
+	// 32 bits: then i is never negative and its signed additions don't overflow, and
+	// the loop runs exactly as the wasm one would.
+	void countedLoop(Context* ctx, const native::CountedLoop& counted, string& out) {
+		string counter, bound;
+		Convert::getLocal(counted.counter, counter);
+		native::invariant(counted.bound, bound);
+		util::tab(ctx->depth, out);
+		out += "if (WASM_COUNTED_LOOPS && " + counter + " >= 0 && " + counter + " < " + bound;
+		if (counted.step > 1) {
+			out += " && " + bound + " <= " + to_string(INT32_MAX - (counted.step - 1));
+		}
+		for (auto& base : counted.bases) {
+			out += " && ";
+			if (base.first) {
+				out += "(uint64_t)(uint32_t)";
+				native::invariant(base.first, out);
+				out += " + ";
+			}
+			if (base.second) {
+				out += "((uint64_t)" + bound + " << " + to_string(base.second) + ")";
+			} else {
+				out += "(uint64_t)" + bound;
+			}
+			out += " <= 4294967296u";
+		}
+		out += ") {\n";
+		ctx->depth++;
+		util::tab(ctx->depth, out);
+		out += "for (; " + counter + " < " + bound + "; " + counter + " += " + to_string(counted.step) + ") {\n";
+		ctx->depth++;
+	}
+}
+
+void native::loop(Context* ctx, Frame& f, string& out) {
+	// Branches to a loop go back to its start. Targeted loops in statement position
+	// become C loops that these branches continue, and that branches to the blocks
+	// ending right after them break out of.
+	Loop* lp = f.ex->cast<Loop>();
+	bool hasLabel = lp->name.is();
+	LoopShape shape = loopShape(ctx, f, lp);
+	if (shape.kind == GotoLoop) {
+		if (f.step == 0) {
+			if (!f.statement) {
+				out += "({\n";
+				ctx->depth++;
+			}
+			if (hasLabel) {
+				Label& label = pushLabel(ctx, lp->name, none, false);
+				if (isTargeted(ctx, lp->name)) {
+					util::tab(ctx->depth, out);
+					out += label.cName;
+					out += ": ;\n";
+				}
+			}
+			if (f.statement) {
+				return f.visitStatement(lp->body, 1);
+			}
+			util::tab(ctx->depth, out);
+			return f.visit(lp->body, 1);
+		}
+		if (hasLabel) {
+			ctx->native->labels.pop_back();
+		}
+		if (!f.statement) {
+			out += ";\n";
+			ctx->depth--;
+			util::tab(ctx->depth, out);
+			out += "})";
+		}
+		return;
+	}
+	// Steps of a C loop
+	enum { Head = 1, Body, Condition, End, Counted };
+	if (f.step == 0) {
+		// The label is kept for branches from inner loops and switches, which goto it
+		Label& label = pushLabel(ctx, lp->name, none, false);
+		auto exits = ctx->native->loopExits.find(lp);
+		ctx->native->constructs.push_back(Construct{false, shape.kind == DoWhileLoop ? Name() : lp->name,
+			exits == ctx->native->loopExits.end() ? vector<Name>() : exits->second});
+		util::tab(ctx->depth, out);
+		out += label.cName;
+		out += ": ;\n";
+		if (shape.counted) {
+			// The body is written twice: in the for statement, then in the loop's own
+			// shape for when the check fails
+			countedLoop(ctx, ctx->native->counted[lp], out);
+			ctx->native->counting = lp;
+			f.step = Counted;
+		}
+	}
+	if (f.step == Counted) {
+		if (f.index < ctx->native->counted[lp].end) {
+			Expression* child = loopStatement(ctx, lp, f.index++);
+			return f.visitStatement(child, Counted);
+		}
+		ctx->native->counting = nullptr;
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "}\n";
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "} else {\n";
+		ctx->depth++;
+	}
+	if (f.step == 0 || f.step == Counted) {
+		util::tab(ctx->depth, out);
+		f.index = shape.first;
+		if (shape.kind == WhileLoop) {
+			out += "while (!(";
+			return f.visit(shape.condition, Head);
+		}
+		out += shape.kind == DoWhileLoop ? "do {\n" : "for (;;) {\n";
+		ctx->depth++;
+		f.step = Body;
+	} else if (f.step == Head) {
+		out += ")) {\n";
+		ctx->depth++;
+		f.step = Body;
+	}
+	if (f.step == Body) {
+		if (f.index < shape.end) {
+			Expression* child = loopStatement(ctx, lp, f.index++);
+			return f.visitStatement(child, Body);
+		}
+		if (shape.kind == UntilLoop) {
+			util::tab(ctx->depth, out);
+			out += "if (!(";
+			return f.visit(shape.condition, Condition);
+		}
+		if (shape.kind == OnceLoop && loopStatement(ctx, lp, shape.end - 1)->type != wasm::unreachable) {
+			util::tab(ctx->depth, out);
+			out += "break;\n";
+		}
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		if (shape.kind == DoWhileLoop) {
+			out += "} while (";
+			return f.visit(shape.condition, End);
+		}
+		out += "}\n";
+	} else if (f.step == Condition) {
+		out += ")) break;\n";
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "}\n";
+	} else {
+		out += ");\n";
+	}
+	if (shape.counted) {
+		ctx->depth--;
+		util::tab(ctx->depth, out);
+		out += "}\n";
+	}
+	ctx->native->constructs.pop_back();
+	ctx->native->labels.pop_back();
+}
+void native::_if(Context* ctx, Frame& f, string& out) {
+	If* ifs = f.ex->cast<If>();
+	if (!f.statement) {
+		// An if with a value is a conditional expression
+		switch (f.step) {
+			case 0:
+				out += "((";
+				return f.visit(ifs->condition, 1);
+			case 1:
+				out += ") ? (";
+				return f.visit(ifs->ifTrue, 2);
+			case 2:
+				out += ") : (";
+				return f.visit(ifs->ifFalse, 3);
+			default:
+				out += "))";
+				return;
+		}
+	}
+	switch (f.step) {
+		case 0:
+			util::tab(ctx->depth, out);
+			out += "if (";
+			return f.visit(ifs->condition, 1);
+		case 1:
+			out += ") {\n";
+			ctx->depth++;
+			return f.visitStatement(ifs->ifTrue, 2);
+		case 2:
+			ctx->depth--;
+			util::tab(ctx->depth, out);
+			out += "}";
+			if (ifs->ifFalse) {
+				out += " else {\n";
+				ctx->depth++;
+				return f.visitStatement(ifs->ifFalse, 3);
+			}
+			out += "\n";
+			return;
+		default:
+			ctx->depth--;
+			util::tab(ctx->depth, out);
+			out += "}\n";
+			return;
+	}
+}
+void native::_break(Context* ctx, Frame& f, string& out) {
+	Break* br = f.ex->cast<Break>();
+	Label* label = findLabel(ctx, br->name);
+	if (!f.statement) {
+		// br_if with a value, which is also the value of the expression when it doesn't branch
+		switch (f.step) {
+			case 0:
+				f.temp = ctx->native->temps++;
+				out += "({ ";
+				out += type(br->type);
+				out += " ";
+				out += temporary(f, 0);
+				out += " = ";
+				return f.visit(br->value, 1);
+			case 1:
+				out += "; if (";
+				return f.visit(br->condition, 2);
+			default:
+				out += ") ";
+				jump(ctx, label, temporary(f, 0), out);
+				out += " ";
+				out += temporary(f, 0);
+				out += "; })";
+				return;
+		}
+	}
+	switch (f.step) {
+		case 0:
+			util::tab(ctx->depth, out);
+			if (br->value && br->condition) {
+				// The value is evaluated before the condition
+				f.temp = ctx->native->temps++;
+				out += "{ ";
+				out += type(isConcrete(br->value->type) ? br->value->type : i32);
+				out += " ";
+				out += temporary(f, 0);
+				out += " = ";
+				return f.visit(br->value, 3);
+			} else if (br->value) {
+				if (label && label->isFunction) {
+					out += "return ";
+				} else if (label && isConcrete(label->type)) {
+					out += label->valueName();
+					out += " = ";
+				} else {
+					out += "(void)";
+				}
+				return f.visit(br->value, 1);
+			} else if (br->condition) {
+				out += "if (";
+				return f.visit(br->condition, 2);
+			}
+			jump(ctx, label, "", out);
+			out += "\n";
+			return;
+		case 1:
+			// After the value of an unconditional branch
+			out += ";\n";
+			if (!label || !label->isFunction) {
+				util::tab(ctx->depth, out);
+				jump(ctx, label, "", out);
+				out += "\n";
+			}
+			return;
+		case 2:
+			out += ") ";
+			jump(ctx, label, "", out);
+			out += "\n";
+			return;
+		case 3:
+			out += "; if (";
+			return f.visit(br->condition, 4);
+		default:
+			out += ") ";
+			jump(ctx, label, temporary(f, 0), out);
+			out += " }\n";
+			return;
+	}
+}
+void native::_switch(Context* ctx, Frame& f, string& out) {
+	// br_table is a switch whose cases all branch
+	Switch* sw = f.ex->cast<Switch>();
+	switch (f.step) {
+		case 0:
+			util::tab(ctx->depth, out);
+			if (sw->value) {
+				// The value is evaluated before the index
+				f.temp = ctx->native->temps++;
+				out += "{\n";
+				ctx->depth++;
+				util::tab(ctx->depth, out);
+				out += type(isConcrete(sw->value->type) ? sw->value->type : i32);
+				out += " ";
+				out += temporary(f, 0);
+				out += " = ";
+				return f.visit(sw->value, 1);
+			}
+			out += "switch ((uint32_t)(";
+			return f.visit(sw->condition, 2);
+		case 1:
+			out += ";\n";
+			util::tab(ctx->depth, out);
+			out += "switch ((uint32_t)(";
+			return f.visit(sw->condition, 2);
+		default: {
+			// Cases branching to the same label share their jump. Inside the switch,
+			// break would leave it rather than a loop, so only continue is used.
+			out += ")) {\n";
+			string value = sw->value ? temporary(f, 0) : "";
+			ctx->native->constructs.push_back(Construct{true, Name(), vector<Name>()});
+			for (Index i = 0; i < sw->targets.size(); ++i) {
+				Name target = sw->targets[i];
+				bool first = target != sw->default_;
+				for (Index j = 0; j < i && first; ++j) {
+					first = sw->targets[j] != target;
+				}
+				if (!first) {
+					continue;
+				}
+				for (Index j = i; j < sw->targets.size(); ++j) {
+					if (sw->targets[j] == target) {
+						util::tab(ctx->depth, out);
+						out += "case ";
+						out += to_string(j);
+						out += ":\n";
+					}
+				}
+				util::tab(ctx->depth + 1, out);
+				jump(ctx, findLabel(ctx, target), value, out);
+				out += "\n";
+			}
+			util::tab(ctx->depth, out);
+			out += "default:\n";
+			util::tab(ctx->depth + 1, out);
+			jump(ctx, findLabel(ctx, sw->default_), value, out);
+			out += "\n";
+			ctx->native->constructs.pop_back();
+			util::tab(ctx->depth, out);
+			out += "}\n";
+			if (sw->value) {
+				ctx->depth--;
+				util::tab(ctx->depth, out);
+				out += "}\n";
+			}
+			return;
+		}
+	}
+}
+void native::_return(Context* ctx, Frame& f, string& out) {
+	Return* ret = f.ex->cast<Return>();
+	switch (f.step) {
+		case 0:
+			if (!ret->value) {
+				util::tab(ctx->depth, out);
+				out += "return;\n";
+				return;
+			}
+			if (ctx->fn && isConcrete(ctx->fn->result)) {
+				util::tab(ctx->depth, out);
+				out += "return ";
+				return f.visit(ret->value, 1);
+			}
+			// A value that never completes, from a function without a result
+			return f.visitStatement(ret->value, 2);
+		case 1:
+			out += ";\n";
+			return;
+		default:
+			util::tab(ctx->depth, out);
+			out += "return;\n";
+			return;
+	}
+}
+void native::drop(Context* ctx, Frame& f, string& out) {
+	Drop* drp = f.ex->cast<Drop>();
+	if (!isConcrete(drp->value->type)) {
+		if (f.step == 0) {
+			f.visitStatement(drp->value, 1);
+		}
+		return;
+	}
+	if (f.step == 0) {
+		util::tab(ctx->depth, out);
+		out += "(void)(";
+		return f.visit(drp->value, 1);
+	}
+	out += ");\n";
+}
+void native::unreachable(Context* ctx, Frame& f, string& out) {
+	util::tab(ctx->depth, out);
+	out += "wasm_trap(\"unreachable\");\n";
+}
@@ -0,0 +1,135 @@
+#include "Native.h"
+using namespace wasmdec;
+using namespace wasmdec::parsers;
+
+namespace {
+	const char* wasmType(Type t) {
+		switch (t) {
+			case i64:
+				return "i64";
+			case f32:
+				return "f32";
+			case f64:
+				return "f64";
+			default:
+				return "i32";
+		}
+	}
+	unsigned bitWidth(Type t) {
+		return t == i64 || t == f64 ? 64 : 32;
+	}
+	// Runtime helper of an access, named after its instruction: wasm_i64_load16_u
+	void accessor(Type t, unsigned bytes, const char* access, bool isSigned, bool isLoad, string& out) {
+		out += "wasm_";
+		out += wasmType(t);
+		out += access;
+		if (bytes * 8 < bitWidth(t)) {
+			out += to_string(bytes * 8);
+			if (isLoad) {
+				out += isSigned ? "_s" : "_u";
+			}
+		}
+	}
+	void offset(Address address, string& out) {
+		uint32_t value = address;
+		out += to_string(value);
+		if (value > INT32_MAX) {
+			out += "u";
+		}
+	}
+	// The wide access an address is written as, when the counted loop it is in is
+	// being written as a for statement
+	const native::WideAccess* wideAccess(Context* ctx, Expression* ex) {
+		auto it = ctx->native->wideAccesses.find(ex);
+		if (it == ctx->native->wideAccesses.end() || it->second.loop != ctx->native->counting) {
+			return nullptr;
+		}
+		return &it->second;
+	}
+	// Base and offset arguments of a wide access: the counter, which is never negative
+	// in the loop, is added to the offset in 64 bits
+	void wideAddress(Context* ctx, const native::WideAccess& wide, Address address, string& out) {
+		if (wide.base) {
+			native::invariant(wide.base, out);
+		} else {
+			out += "0";
+		}
+		out += ", ";
+		if (wide.shift) {
+			out += "(";
+		}
+		out += "(uint64_t)";
+		Convert::getLocal(ctx->native->counted[wide.loop].counter, out);
+		if (wide.shift) {
+			out += " << ";
+			out += to_string(wide.shift);
+			out += ")";
+		}
+		if (address) {
+			out += " + ";
+			offset(address, out);
+		}
+	}
+}
+
+void native::load(Context* ctx, Frame& f, string& out) {
+	// Helpers copy exactly the accessed bytes from wasm_memory + ptr + offset, with the
+	// sum done in 64 bits as wasm does
+	Load* ld = f.ex->cast<Load>();
+	if (f.step == 0) {
+		accessor(ld->type == wasm::unreachable ? i32 : ld->type, ld->bytes, "_load", ld->signed_, true, out);
+		out += "(";
+		if (const WideAccess* wide = wideAccess(ctx, ld)) {
+			wideAddress(ctx, *wide, ld->offset, out);
+			out += ")";
+			return;
+		}
+		return f.visit(ld->ptr, 1);
+	}
+	out += ", ";
+	offset(ld->offset, out);
+	out += ")";
+}
+void native::store(Context* ctx, Frame& f, string& out) {
+	Store* st = f.ex->cast<Store>();
+	if (f.step == 0) {
+		util::tab(ctx->depth, out);
+		if (needsTemporaries(ctx, {st->ptr, st->value})) {
+			f.hoisted = true;
+			f.step = 1;
+		} else {
+			accessor(st->valueType, st->bytes, "_store", false, false, out);
+			out += "(";
+			if (const WideAccess* wide = wideAccess(ctx, st)) {
+				wideAddress(ctx, *wide, st->offset, out);
+				out += ", ";
+				return f.visit(st->value, 2);
+			}
+			return f.visit(st->ptr, 1);
+		}
+	}
+	if (f.hoisted) {
+		if (hoist(ctx, f, {st->ptr, st->value}, out)) {
+			return;
+		}
+		accessor(st->valueType, st->bytes, "_store", false, false, out);
+		out += "(";
+		out += temporary(f, 0);
+		out += ", ";
+		offset(st->offset, out);
+		out += ", ";
+		out += temporary(f, 1);
+		out += "); });\n";
+		return;
+	}
+	switch (f.step) {
+		case 1:
+			out += ", ";
+			offset(st->offset, out);
+			out += ", ";
+			return f.visit(st->value, 2);
+		default:
+			out += ");\n";
+			return;
+	}
+}
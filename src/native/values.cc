@@ -0,0 +1,323 @@
+#include "Native.h"
+using namespace wasmdec;
+using namespace wasmdec::parsers;
+
+namespace {
+	// Operands are evaluated for their effects before trapping
+	const OperatorSyntax unsupportedBinary = {"((void)(", "), (void)(", "), wasm_unsupported())", false};
+	const OperatorSyntax unsupportedUnary = {"((void)(", "", "), wasm_unsupported())", false};
+}
+
+void native::get_local(Context* ctx, Frame& f, string& out) {
+	Convert::getLocal(f.ex->cast<GetLocal>()->index, out);
+}
+void native::set_local(Context* ctx, Frame& f, string& out) {
+	SetLocal* sl = f.ex->cast<SetLocal>();
+	if (f.step == 0) {
+		if (sl->isTee()) {
+			out += "(";
+		} else {
+			util::tab(ctx->depth, out);
+		}
+		Convert::getLocal(sl->index, out);
+		out += " = ";
+		return f.visit(sl->value, 1);
+	}
+	out += sl->isTee() ? ")" : ";\n";
+}
+void native::get_global(Context* ctx, Frame& f, string& out) {
+	ctx->dctx->symbols.getNativeGlobal(f.ex->cast<GetGlobal>()->name, out);
+}
+void native::set_global(Context* ctx, Frame& f, string& out) {
+	SetGlobal* sg = f.ex->cast<SetGlobal>();
+	if (f.step == 0) {
+		util::tab(ctx->depth, out);
+		ctx->dctx->symbols.getNativeGlobal(sg->name, out);
+		out += " = ";
+		return f.visit(sg->value, 1);
+	}
+	out += ";\n";
+}
+void native::_const(Context* ctx, Frame& f, string& out) {
+	literal(f.ex->cast<Const>()->value, out);
+}
+void native::invariant(Expression* ex, string& out) {
+	if (GetLocal* get = ex->dynCast<GetLocal>()) {
+		Convert::getLocal(get->index, out);
+	} else {
+		literal(ex->cast<Const>()->value, out);
+	}
+}
+void native::unary(Context* ctx, Frame& f, string& out) {
+	Unary* un = f.ex->cast<Unary>();
+	OperatorSyntax op = getUnary(un->op, ctx->dctx->fastTraps);
+	if (f.step == 0) {
+		out += op.prefix;
+		return f.visit(un->value, 1);
+	}
+	out += op.suffix;
+}
+void native::binary(Context* ctx, Frame& f, string& out) {
+	Binary* bin = f.ex->cast<Binary>();
+	OperatorSyntax op = getBinOperator(bin->op, ctx->dctx->fastTraps);
+	if (f.step == 0 && needsTemporaries(ctx, {bin->left, bin->right})) {
+		f.hoisted = true;
+		f.step = 1;
+	}
+	if (f.hoisted) {
+		if (hoist(ctx, f, {bin->left, bin->right}, out)) {
+			return;
+		}
+		out += op.prefix;
+		out += temporary(f, 0);
+		out += op.infix;
+		out += temporary(f, 1);
+		out += op.suffix;
+		out += "; })";
+		return;
+	}
+	switch (f.step) {
+		case 0:
+			out += op.prefix;
+			return f.visit(bin->left, 1);
+		case 1:
+			out += op.infix;
+			return f.visit(bin->right, 2);
+		default:
+			out += op.suffix;
+			return;
+	}
+}
+void native::select(Context* ctx, Frame& f, string& out) {
+	// wasm evaluates both values, then the condition
+	Select* sel = f.ex->cast<Select>();
+	if (f.step == 0 && needsTemporaries(ctx, {sel->ifTrue, sel->ifFalse, sel->condition})) {
+		f.hoisted = true;
+		f.step = 1;
+	}
+	if (f.hoisted) {
+		if (hoist(ctx, f, {sel->ifTrue, sel->ifFalse, sel->condition}, out)) {
+			return;
+		}
+		out += "(";
+		out += temporary(f, 2);
+		out += " ? ";
+		out += temporary(f, 0);
+		out += " : ";
+		out += temporary(f, 1);
+		out += "); })";
+		return;
+	}
+	switch (f.step) {
+		case 0:
+			out += "((";
+			return f.visit(sel->condition, 1);
+		case 1:
+			out += ") ? (";
+			return f.visit(sel->ifTrue, 2);
+		case 2:
+			out += ") : (";
+			return f.visit(sel->ifFalse, 3);
+		default:
+			out += "))";
+			return;
+	}
+}
+void native::host(Context* ctx, Frame& f, string& out) {
+	Host* hst = f.ex->cast<Host>();
+	if (hst->op == CurrentMemory) {
+		out += "wasm_current_memory()";
+		return;
+	}
+	if (hst->op != GrowMemory || hst->operands.size() != 1) {
+		out += "wasm_unsupported()";
+		return;
+	}
+	if (f.step == 0) {
+		out += "wasm_grow_memory(";
+		return f.visit(hst->operands[0], 1);
+	}
+	out += ")";
+}
+void native::unsupported(Context* ctx, Frame& f, string& out) {
+	// Atomics and anything newer: the module can't run here, but still compiles
+	out += "wasm_unsupported()";
+}
+OperatorSyntax native::getBinOperator(BinaryOp op, bool fast) {
+	// Integer arithmetic wraps, so it's done on unsigned types; shift counts are
+	// taken modulo the width, as wasm does. Divisions trap through runtime helpers
+	// unless trap checks are left out.
+	if (!fast) {
+		switch (op) {
+			case DivSInt32: return {"wasm_i32_div_s(", ", ", ")", true};
+			case DivUInt32: return {"wasm_i32_div_u(", ", ", ")", true};
+			case RemSInt32: return {"wasm_i32_rem_s(", ", ", ")", true};
+			case RemUInt32: return {"wasm_i32_rem_u(", ", ", ")", true};
+			case DivSInt64: return {"wasm_i64_div_s(", ", ", ")", true};
+			case DivUInt64: return {"wasm_i64_div_u(", ", ", ")", true};
+			case RemSInt64: return {"wasm_i64_rem_s(", ", ", ")", true};
+			case RemUInt64: return {"wasm_i64_rem_u(", ", ", ")", true};
+			default:
+				break;
+		}
+	}
+	switch (op) {
+		case AddInt32: return {"(int32_t)((uint32_t)(", ") + (uint32_t)(", "))", true};
+		case SubInt32: return {"(int32_t)((uint32_t)(", ") - (uint32_t)(", "))", true};
+		case MulInt32: return {"(int32_t)((uint32_t)(", ") * (uint32_t)(", "))", true};
+		case DivSInt32: return {"((", ") / (", "))", true};
+		case DivUInt32: return {"(int32_t)((uint32_t)(", ") / (uint32_t)(", "))", true};
+		case RemSInt32: return {"((", ") % (", "))", true};
+		case RemUInt32: return {"(int32_t)((uint32_t)(", ") % (uint32_t)(", "))", true};
+		case AndInt32: return {"((", ") & (", "))", true};
+		case OrInt32: return {"((", ") | (", "))", true};
+		case XorInt32: return {"((", ") ^ (", "))", true};
+		case ShlInt32: return {"(int32_t)((uint32_t)(", ") << ((", ") & 31))", true};
+		case ShrSInt32: return {"((", ") >> ((", ") & 31))", true};
+		case ShrUInt32: return {"(int32_t)((uint32_t)(", ") >> ((", ") & 31))", true};
+		case RotLInt32: return {"wasm_i32_rotl(", ", ", ")", true};
+		case RotRInt32: return {"wasm_i32_rotr(", ", ", ")", true};
+		case EqInt32: return {"((", ") == (", "))", true};
+		case NeInt32: return {"((", ") != (", "))", true};
+		case LtSInt32: return {"((", ") < (", "))", true};
+		case LtUInt32: return {"((uint32_t)(", ") < (uint32_t)(", "))", true};
+		case LeSInt32: return {"((", ") <= (", "))", true};
+		case LeUInt32: return {"((uint32_t)(", ") <= (uint32_t)(", "))", true};
+		case GtSInt32: return {"((", ") > (", "))", true};
+		case GtUInt32: return {"((uint32_t)(", ") > (uint32_t)(", "))", true};
+		case GeSInt32: return {"((", ") >= (", "))", true};
+		case GeUInt32: return {"((uint32_t)(", ") >= (uint32_t)(", "))", true};
+
+		case AddInt64: return {"(int64_t)((uint64_t)(", ") + (uint64_t)(", "))", true};
+		case SubInt64: return {"(int64_t)((uint64_t)(", ") - (uint64_t)(", "))", true};
+		case MulInt64: return {"(int64_t)((uint64_t)(", ") * (uint64_t)(", "))", true};
+		case DivSInt64: return {"((", ") / (", "))", true};
+		case DivUInt64: return {"(int64_t)((uint64_t)(", ") / (uint64_t)(", "))", true};
+		case RemSInt64: return {"((", ") % (", "))", true};
+		case RemUInt64: return {"(int64_t)((uint64_t)(", ") % (uint64_t)(", "))", true};
+		case AndInt64: return {"((", ") & (", "))", true};
+		case OrInt64: return {"((", ") | (", "))", true};
+		case XorInt64: return {"((", ") ^ (", "))", true};
+		case ShlInt64: return {"(int64_t)((uint64_t)(", ") << ((", ") & 63))", true};
+		case ShrSInt64: return {"((", ") >> ((", ") & 63))", true};
+		case ShrUInt64: return {"(int64_t)((uint64_t)(", ") >> ((", ") & 63))", true};
+		case RotLInt64: return {"wasm_i64_rotl(", ", ", ")", true};
+		case RotRInt64: return {"wasm_i64_rotr(", ", ", ")", true};
+		case EqInt64: return {"((", ") == (", "))", true};
+		case NeInt64: return {"((", ") != (", "))", true};
+		case LtSInt64: return {"((", ") < (", "))", true};
+		case LtUInt64: return {"((uint64_t)(", ") < (uint64_t)(", "))", true};
+		case LeSInt64: return {"((", ") <= (", "))", true};
+		case LeUInt64: return {"((uint64_t)(", ") <= (uint64_t)(", "))", true};
+		case GtSInt64: return {"((", ") > (", "))", true};
+		case GtUInt64: return {"((uint64_t)(", ") > (uint64_t)(", "))", true};
+		case GeSInt64: return {"((", ") >= (", "))", true};
+		case GeUInt64: return {"((uint64_t)(", ") >= (uint64_t)(", "))", true};
+
+		case AddFloat32:
+		case AddFloat64: return {"((", ") + (", "))", true};
+		case SubFloat32:
+		case SubFloat64: return {"((", ") - (", "))", true};
+		case MulFloat32:
+		case MulFloat64: return {"((", ") * (", "))", true};
+		case DivFloat32:
+		case DivFloat64: return {"((", ") / (", "))", true};
+		case CopySignFloat32: return {"copysignf(", ", ", ")", true};
+		case CopySignFloat64: return {"copysign(", ", ", ")", true};
+		case MinFloat32: return {"wasm_f32_min(", ", ", ")", true};
+		case MinFloat64: return {"wasm_f64_min(", ", ", ")", true};
+		case MaxFloat32: return {"wasm_f32_max(", ", ", ")", true};
+		case MaxFloat64: return {"wasm_f64_max(", ", ", ")", true};
+		case EqFloat32:
+		case EqFloat64: return {"((", ") == (", "))", true};
+		case NeFloat32:
+		case NeFloat64: return {"((", ") != (", "))", true};
+		case LtFloat32:
+		case LtFloat64: return {"((", ") < (", "))", true};
+		case LeFloat32:
+		case LeFloat64: return {"((", ") <= (", "))", true};
+		case GtFloat32:
+		case GtFloat64: return {"((", ") > (", "))", true};
+		case GeFloat32:
+		case GeFloat64: return {"((", ") >= (", "))", true};
+		default:
+			return unsupportedBinary;
+	}
+}
+OperatorSyntax native::getUnary(UnaryOp op, bool fast) {
+	// Conversions of floats out of the integer's range trap, as with divisions
+	if (!fast) {
+		switch (op) {
+			case TruncSFloat32ToInt32: return {"wasm_i32_trunc_s_f32(", "", ")", true};
+			case TruncUFloat32ToInt32: return {"wasm_i32_trunc_u_f32(", "", ")", true};
+			case TruncSFloat64ToInt32: return {"wasm_i32_trunc_s_f64(", "", ")", true};
+			case TruncUFloat64ToInt32: return {"wasm_i32_trunc_u_f64(", "", ")", true};
+			case TruncSFloat32ToInt64: return {"wasm_i64_trunc_s_f32(", "", ")", true};
+			case TruncUFloat32ToInt64: return {"wasm_i64_trunc_u_f32(", "", ")", true};
+			case TruncSFloat64ToInt64: return {"wasm_i64_trunc_s_f64(", "", ")", true};
+			case TruncUFloat64ToInt64: return {"wasm_i64_trunc_u_f64(", "", ")", true};
+			default:
+				break;
+		}
+	}
+	switch (op) {
+		case ClzInt32: return {"wasm_i32_clz(", "", ")", true};
+		case CtzInt32: return {"wasm_i32_ctz(", "", ")", true};
+		case PopcntInt32: return {"wasm_i32_popcnt(", "", ")", true};
+		case ClzInt64: return {"wasm_i64_clz(", "", ")", true};
+		case CtzInt64: return {"wasm_i64_ctz(", "", ")", true};
+		case PopcntInt64: return {"wasm_i64_popcnt(", "", ")", true};
+		case EqZInt32:
+		case EqZInt64: return {"((", "", ") == 0)", true};
+
+		case NegFloat32:
+		case NegFloat64: return {"(-(", "", "))", true};
+		case AbsFloat32: return {"fabsf(", "", ")", true};
+		case AbsFloat64: return {"fabs(", "", ")", true};
+		case CeilFloat32: return {"ceilf(", "", ")", true};
+		case CeilFloat64: return {"ceil(", "", ")", true};
+		case FloorFloat32: return {"floorf(", "", ")", true};
+		case FloorFloat64: return {"floor(", "", ")", true};
+		case TruncFloat32: return {"truncf(", "", ")", true};
+		case TruncFloat64: return {"trunc(", "", ")", true};
+		case NearestFloat32: return {"nearbyintf(", "", ")", true};
+		case NearestFloat64: return {"nearbyint(", "", ")", true};
+		case SqrtFloat32: return {"sqrtf(", "", ")", true};
+		case SqrtFloat64: return {"sqrt(", "", ")", true};
+
+		case ExtendSInt32: return {"((int64_t)(", "", "))", true};
+		case ExtendUInt32: return {"((int64_t)(uint32_t)(", "", "))", true};
+		case WrapInt64: return {"((int32_t)(", "", "))", true};
+		case ExtendS8Int32: return {"((int32_t)(int8_t)(", "", "))", true};
+		case ExtendS16Int32: return {"((int32_t)(int16_t)(", "", "))", true};
+		case ExtendS8Int64: return {"((int64_t)(int8_t)(", "", "))", true};
+		case ExtendS16Int64: return {"((int64_t)(int16_t)(", "", "))", true};
+		case ExtendS32Int64: return {"((int64_t)(int32_t)(", "", "))", true};
+
+		case TruncSFloat32ToInt32:
+		case TruncSFloat64ToInt32: return {"((int32_t)(", "", "))", true};
+		case TruncUFloat32ToInt32:
+		case TruncUFloat64ToInt32: return {"((int32_t)(uint32_t)(", "", "))", true};
+		case TruncSFloat32ToInt64:
+		case TruncSFloat64ToInt64: return {"((int64_t)(", "", "))", true};
+		case TruncUFloat32ToInt64:
+		case TruncUFloat64ToInt64: return {"((int64_t)(uint64_t)(", "", "))", true};
+		case ReinterpretFloat32: return {"wasm_i32_reinterpret_f32(", "", ")", true};
+		case ReinterpretFloat64: return {"wasm_i64_reinterpret_f64(", "", ")", true};
+
+		case ConvertSInt32ToFloat32:
+		case ConvertSInt64ToFloat32:
+		case DemoteFloat64: return {"((float)(", "", "))", true};
+		case ConvertUInt32ToFloat32: return {"((float)(uint32_t)(", "", "))", true};
+		case ConvertUInt64ToFloat32: return {"((float)(uint64_t)(", "", "))", true};
+		case ConvertSInt32ToFloat64:
+		case ConvertSInt64ToFloat64:
+		case PromoteFloat32: return {"((double)(", "", "))", true};
+		case ConvertUInt32ToFloat64: return {"((double)(uint32_t)(", "", "))", true};
+		case ConvertUInt64ToFloat64: return {"((double)(uint64_t)(", "", "))", true};
+		case ReinterpretInt32: return {"wasm_f32_reinterpret_i32(", "", ")", true};
+		case ReinterpretInt64: return {"wasm_f64_reinterpret_i64(", "", ")", true};
+		default:
+			return unsupportedUnary;
+	}
+}
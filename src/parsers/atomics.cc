@@ -1,6 +1,6 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::atomics(Context* ctx, Expression* ex) {
-	return "/* Atomic operation unsupported */\n";
-}
\ No newline at end of file
+void wasmdec::parsers::atomics(Context* ctx, Frame& f, string& out) {
+	out += "/* Atomic operation unsupported */\n";
+}
@@ -1,16 +1,27 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::binary(Context* ctx, Expression* ex) {
-	string ret;
+void wasmdec::parsers::binary(Context* ctx, Frame& f, string& out) {
 	// Binary operations, including conditionals and arithmetic
-	Binary* spex = ex->cast<Binary>();
-	ctx->lastExpr = ex;
-	ctx->functionLevelExpression = false;
-	string e1 = Convert::parseExpr(ctx, spex->left);
-	ctx->lastExpr = ex;
-	ctx->functionLevelExpression = false;
-	string e2 = Convert::parseExpr(ctx, spex->right);
-	ret += Convert::getBinOperator(e1, spex->op, e2);
-	return ret;
-}
\ No newline at end of file
+	Binary* spex = f.ex->cast<Binary>();
+	OperatorSyntax op = Convert::getBinOperator(spex->op);
+	switch (f.step) {
+		case 0:
+			f.start = out.size();
+			out += op.prefix;
+			ctx->lastExpr = f.ex;
+			ctx->functionLevelExpression = false;
+			return f.visit(spex->left, 1);
+		case 1:
+			out += op.infix;
+			ctx->lastExpr = f.ex;
+			ctx->functionLevelExpression = false;
+			return f.visit(spex->right, 2);
+	}
+	out += op.suffix;
+	if (!op.supported) {
+		// Operands are still parsed so the context ends up the same, but only the comment is kept
+		out.resize(f.start);
+		out += op.prefix;
+	}
+}
@@ -1,11 +1,21 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::block(Context* ctx, Expression* ex) {
-	string ret;
-	Block* blck = ex->cast<Block>();
-	ctx->depth++;
-	ret += Convert::getBlockBody(ctx, blck);
+void wasmdec::parsers::block(Context* ctx, Frame& f, string& out) {
+	Block* blck = f.ex->cast<Block>();
+	if (f.step == 0) {
+		ctx->depth++;
+		ctx->scopes.push_back(blck);
+	}
+	if (Convert::getBlockBody(ctx, f, blck, out)) {
+		return;
+	}
+	ctx->scopes.pop_back();
+	// Branches to a block go to its end
+	if (blck->name.str && ctx->gotoLabels.count(blck->name.str)) {
+		util::tab(ctx->depth, out);
+		out += blck->name.str;
+		out += ": ;\n";
+	}
 	ctx->depth--;
-	return ret;
-}
\ No newline at end of file
+}
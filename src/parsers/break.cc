@@ -1,25 +1,87 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::_break(Context* ctx, Expression* ex) {
-	string ret;
-	Break* br = ex->cast<Break>();
-    ret += util::tab(ctx->depth);
-    if (br->condition) {
-        // Conditional breaking
-        ctx->lastExpr = ex;
-        ctx->functionLevelExpression = false;
-        ret += "if (" + Convert::parseExpr(ctx, br->condition) + ") break;";
-    } else {
+namespace {
+	Loop* innermostLoop(Context* ctx, size_t& index) {
+		for (size_t i = ctx->scopes.size(); i-- > 0;) {
+			if (ctx->scopes[i]->_id == Expression::LoopId) {
+				index = i;
+				return ctx->scopes[i]->cast<Loop>();
+			}
+		}
+		return nullptr;
+	}
+	// Whether leaving the loop at scopes[loop] ends up at the end of the block at
+	// scopes[target]: the loop is the last statement of that block, or of blocks that are
+	bool exitsTo(Context* ctx, size_t target, size_t loop) {
+		for (size_t i = target; i < loop; ++i) {
+			Block* blck = ctx->scopes[i]->dynCast<Block>();
+			if (!blck || !blck->list.size() || blck->list.back() != ctx->scopes[i + 1]) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+void wasmdec::parsers::jump(Context* ctx, Name target, bool inSwitch, string& out) {
+	size_t loopIndex = 0;
+	Loop* loop = innermostLoop(ctx, loopIndex);
+	if (loop && loop->name == target) {
+		out += "continue;";
+		return;
+	}
+	for (size_t i = ctx->scopes.size(); i-- > 0;) {
+		Expression* scope = ctx->scopes[i];
+		Block* blck = scope->dynCast<Block>();
+		if (blck && blck->name == target) {
+			// Inside a switch, break would only leave the switch
+			if (loop && i < loopIndex && !inSwitch && exitsTo(ctx, i, loopIndex)) {
+				out += "break;";
+				return;
+			}
+			break;
+		}
+		Loop* lp = scope->dynCast<Loop>();
+		if (lp && lp->name == target) {
+			break;
+		}
+	}
+	// Blocks define their label at their end and loops at their start
+	ctx->gotoLabels.insert(target.str);
+	out += "goto ";
+	out += target.str;
+	out += ";";
+}
+void wasmdec::parsers::_break(Context* ctx, Frame& f, string& out) {
+	Break* br = f.ex->cast<Break>();
+    if (f.step == 0) {
+        util::tab(ctx->depth, out);
+        if (br->condition) {
+            // Conditional breaking
+            ctx->lastExpr = f.ex;
+            ctx->functionLevelExpression = false;
+            out += "if (";
+            return f.visit(br->condition, 1);
+        }
         // Literal breaking
-        ret += "break;";
+        jump(ctx, br->name, false, out);
+        out += "\n";
+    } else if (f.step == 1) {
+        out += ") ";
+        jump(ctx, br->name, false, out);
+        out += "\n";
+    } else {
+        // The value has been parsed
+        out.resize(f.start);
+        return;
     }
     if (br->value) {
-        ctx->lastExpr = ex;
-        ctx->functionLevelExpression = false;
-        string val = Convert::parseExpr(ctx, br->value);
         // TODO : parse break values
-        // cout << "Break val: " << val << endl;
+        // The value isn't written yet, it is only parsed for its effect on the context
+        f.start = out.size();
+        ctx->lastExpr = f.ex;
+        ctx->functionLevelExpression = false;
+        return f.visit(br->value, 2);
     }
-    return ret;
-}
\ No newline at end of file
+}
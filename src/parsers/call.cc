@@ -1,15 +1,23 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::call(Context* ctx, Expression* ex) {
-	string ret;
-	Call* fnCall = ex->cast<Call>();
-    if (ctx->depth < 1) {
-        ret += util::tab(1);
-    } else {
-        ret += util::tab(ctx->depth);
+void wasmdec::parsers::call(Context* ctx, Frame& f, string& out) {
+	Call* fnCall = f.ex->cast<Call>();
+    if (f.step == 0) {
+        if (ctx->depth < 1) {
+            util::tab(1, out);
+        } else {
+            util::tab(ctx->depth, out);
+        }
+        if (ctx->hasDecompilerCtx) {
+            ctx->dctx->symbols.getFName(fnCall->target, out);
+        } else {
+            Convert::getFName(fnCall->target, out);
+        }
+        f.step = 1;
     }
-    ret += Convert::getFName(fnCall->target) + Convert::parseOperandList(ctx, &(fnCall->operands));
-    ret += ";\n";
-	return ret;
-}
\ No newline at end of file
+    if (Convert::parseOperandList(f, &(fnCall->operands), out)) {
+        return;
+    }
+    out += ";\n";
+}
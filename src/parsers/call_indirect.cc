@@ -1,17 +1,21 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::call_indirect(Context* ctx, Expression* ex) {
-	string ret;
-	
-    CallIndirect* ci = ex->cast<CallIndirect>();
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string _icall = Convert::parseExpr(ctx, ci->target);
-    ret += "// Indirect call:\n";
-    ret += "(" + _icall + ")";
-    ret += Convert::parseOperandList(ctx, &(ci->operands));
-    ret += "; \n";
-
-	return ret;
-}
\ No newline at end of file
+void wasmdec::parsers::call_indirect(Context* ctx, Frame& f, string& out) {
+    CallIndirect* ci = f.ex->cast<CallIndirect>();
+    if (f.step == 0) {
+        out += "// Indirect call:\n";
+        out += "(";
+        ctx->lastExpr = f.ex;
+        ctx->functionLevelExpression = false;
+        return f.visit(ci->target, 1);
+    }
+    if (f.step == 1) {
+        out += ")";
+        f.step = 2;
+    }
+    if (Convert::parseOperandList(f, &(ci->operands), out)) {
+        return;
+    }
+    out += "; \n";
+}
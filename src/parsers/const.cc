@@ -1,8 +1,8 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::_const(Context* ctx, Expression* ex) {
+void wasmdec::parsers::_const(Context* ctx, Frame& f, string& out) {
 	// Resolve constant's literal value to a syntactically valid C literal
-	Literal* val = &(ex->cast<Const>()->value);
-	return util::getLiteralValue(val);
-}
\ No newline at end of file
+	Literal* val = &(f.ex->cast<Const>()->value);
+	out += util::getLiteralValue(val);
+}
@@ -1,17 +1,15 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::drop(Context* ctx, Expression* ex) {
-	string ret;
-	
-    Drop* dex = ex->cast<Drop>();
-    ret += util::tab(1);
-    ret += "/* Drop routine */\n";
-    ctx->functionLevelExpression = false;
-    ctx->lastExpr = ex;
-    ret += Convert::parseExpr(ctx, dex->value);
-    ret += util::tab(1);
-    ret += "/* End of drop routine */\n";
-
-	return ret;
-}
\ No newline at end of file
+void wasmdec::parsers::drop(Context* ctx, Frame& f, string& out) {
+    Drop* dex = f.ex->cast<Drop>();
+    if (f.step == 0) {
+        util::tab(1, out);
+        out += "/* Drop routine */\n";
+        ctx->functionLevelExpression = false;
+        ctx->lastExpr = f.ex;
+        return f.visit(dex->value, 1);
+    }
+    util::tab(1, out);
+    out += "/* End of drop routine */\n";
+}
@@ -1,10 +1,7 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::get_global(Context* ctx, Expression* ex) {
-    string ret;
+void wasmdec::parsers::get_global(Context* ctx, Frame& f, string& out) {
 	// Global variable lookup
-    ret += ex->cast<GetGlobal>()->name.str;
-    // ret += "\n";
-    return ret;
-}
\ No newline at end of file
+    out += f.ex->cast<GetGlobal>()->name.str;
+}
@@ -1,7 +1,7 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::get_local(Context* ctx, Expression* ex) {
-	GetLocal* spex = ex->cast<GetLocal>();
-	return Convert::getLocal(spex->index);
-}
\ No newline at end of file
+void wasmdec::parsers::get_local(Context* ctx, Frame& f, string& out) {
+	GetLocal* spex = f.ex->cast<GetLocal>();
+	Convert::getLocal(spex->index, out);
+}
@@ -1,11 +1,12 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::host(Context* ctx, Expression* ex) {
-	string ret;
-	Host* hexp = ex->cast<Host>();
-    string hoperands = Convert::parseOperandList(ctx, &(hexp->operands));
-    string hfunc = Convert::getHostFunc(hexp->op);
-    ret += "/* Host call */\n" + hfunc + hoperands;
-	return ret;
-}
\ No newline at end of file
+void wasmdec::parsers::host(Context* ctx, Frame& f, string& out) {
+	Host* hexp = f.ex->cast<Host>();
+    if (f.step == 0) {
+        out += "/* Host call */\n";
+        out += Convert::getHostFunc(hexp->op);
+        f.step = 1;
+    }
+    Convert::parseOperandList(f, &(hexp->operands), out);
+}
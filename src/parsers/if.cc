@@ -1,32 +1,39 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::_if(Context* ctx, Expression* ex) {
-	string ret;
-	If* ife = ex->cast<If>();
-	ctx->lastExpr = ex;
-	ctx->isIfCondition = true;
-	ctx->functionLevelExpression = false;
-	string cond = Convert::parseExpr(ctx, ife->condition);
-	ctx->isIfCondition = false;
-	ctx->lastExpr = ex;
-	ctx->functionLevelExpression = false;
-	string trueBlock = Convert::parseExpr(ctx, ife->ifTrue);
-	ret += util::tab(ctx->depth);
-	ret += "if (" + cond + ") {\n";
-	ret += trueBlock;
-	ret += "\n" + util::tab(ctx->depth) + "} ";
-	if (ife->ifFalse) {
-		// Insert else block
-		ctx->lastExpr = ex;
-		ctx->functionLevelExpression = false;
-		string falseBlock = Convert::parseExpr(ctx, ife->ifFalse);
-		ret += "else {\n";
-		ret += util::tab(ctx->depth) + falseBlock + "\n";
-		ret += util::tab(ctx->depth) + "}";
-	} else {
-		// No else statement
-		ret += "// <No else block>\n";
+void wasmdec::parsers::_if(Context* ctx, Frame& f, string& out) {
+	If* ife = f.ex->cast<If>();
+	switch (f.step) {
+		case 0:
+			util::tab(ctx->depth, out);
+			out += "if (";
+			ctx->lastExpr = f.ex;
+			ctx->isIfCondition = true;
+			ctx->functionLevelExpression = false;
+			return f.visit(ife->condition, 1);
+		case 1:
+			ctx->isIfCondition = false;
+			out += ") {\n";
+			ctx->lastExpr = f.ex;
+			ctx->functionLevelExpression = false;
+			return f.visit(ife->ifTrue, 2);
+		case 2:
+			out += "\n";
+			util::tab(ctx->depth, out);
+			out += "} ";
+			if (ife->ifFalse) {
+				// Insert else block
+				out += "else {\n";
+				util::tab(ctx->depth, out);
+				ctx->lastExpr = f.ex;
+				ctx->functionLevelExpression = false;
+				return f.visit(ife->ifFalse, 3);
+			}
+			// No else statement
+			out += "// <No else block>\n";
+			return;
 	}
-	return ret;
-}
\ No newline at end of file
+	out += "\n";
+	util::tab(ctx->depth, out);
+	out += "}";
+}
@@ -1,16 +1,15 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::load(Context* ctx, Expression* ex) {
-	string ret;
+void wasmdec::parsers::load(Context* ctx, Frame& f, string& out) {
 	// Memory loading
-    Load* lxp = ex->cast<Load>();
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string var = Convert::parseExpr(ctx, lxp->ptr);
-    ret += util::tab(ctx->depth);
-    ret += "*(void*)(";
-    ret += var;
-    ret += ")";
-	return ret;
-}
\ No newline at end of file
+    Load* lxp = f.ex->cast<Load>();
+    if (f.step == 0) {
+        util::tab(ctx->depth, out);
+        out += "*(void*)(";
+        ctx->lastExpr = f.ex;
+        ctx->functionLevelExpression = false;
+        return f.visit(lxp->ptr, 1);
+    }
+    out += ")";
+}
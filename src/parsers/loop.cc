@@ -1,33 +1,54 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::loop(Context* ctx, Expression* ex) {
-    string ret;
-	Loop* lex = ex->cast<Loop>();
-    ret += util::tab(ctx->depth);
-    ret += "while (1) {";
-    if (lex->name.str) {
-            ret += " // Loop name: '";
-            ret += lex->name.str;
-            ret += "'";
+namespace {
+	// Whether the loop body ends in a branch, so it never runs off its end
+	bool endsInBranch(Expression* body) {
+		while (body->_id == Expression::BlockId && body->cast<Block>()->list.size()) {
+			body = body->cast<Block>()->list.back();
+		}
+		switch (body->_id) {
+			case Expression::BreakId:
+				return !body->cast<Break>()->condition;
+			case Expression::SwitchId:
+			case Expression::ReturnId:
+			case Expression::UnreachableId:
+				return true;
+			default:
+				return false;
+		}
+	}
+}
+
+void wasmdec::parsers::loop(Context* ctx, Frame& f, string& out) {
+	Loop* lex = f.ex->cast<Loop>();
+    if (f.step == 0) {
+        // Branches to a loop go to its start; the label is only written once a goto
+        // is known to need it
+        f.start = out.size();
+        util::tab(ctx->depth, out);
+        out += "while (1) {\n";
+        ctx->scopes.push_back(lex);
+        ctx->depth -= 1;
+        ctx->lastExpr = f.ex;
+        ctx->functionLevelExpression = false;
+        return f.visit(lex->body, 1);
     }
-    ret += "\n";
-    ctx->depth -= 1;
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    ret += Convert::parseExpr(ctx, lex->body);
-    ret += "\n";
-    if (ctx->depth < 1) {
-        ret += util::tab(1);
-    } else {
-        ret += util::tab(ctx->depth);
+    ctx->depth += 1;
+    ctx->scopes.pop_back();
+    // A wasm loop only repeats by branching back, and is left by running off its end
+    int depth = ctx->depth < 1 ? 1 : ctx->depth;
+    if (!endsInBranch(lex->body)) {
+        util::tab(depth, out);
+        out += "break;\n";
     }
-    ret += "} " ;
-    if (lex->name.str) {
-            ret += "// End of loop '";
-            ret += lex->name.str;
-            ret += "'";
+    util::tab(depth, out);
+    out += "}\n";
+    if (lex->name.str && ctx->gotoLabels.count(lex->name.str)) {
+        string label;
+        util::tab(depth, label);
+        label += lex->name.str;
+        label += ":\n";
+        out.insert(f.start, label);
     }
-    ret += "\n";
-    return ret;
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::nop(Context* ctx, Expression* ex) {
-	return util::tab(ctx->depth) + "// <Nop expression>\n"; // Nop expressions do nothing
-}
\ No newline at end of file
+void wasmdec::parsers::nop(Context* ctx, Frame& f, string& out) {
+	util::tab(ctx->depth, out);
+	out += "// <Nop expression>\n"; // Nop expressions do nothing
+}
@@ -1,57 +1,81 @@
 #include "parser.h"
 using namespace std;
 
-std::string wasmdec::parsers::expression(Context* ctx, Expression* ex) {
-	if (ex->is<Block>()) {
-		return wasmdec::parsers::block(ctx, ex);
-	} else if (ex->is<Binary>()) {
-		return wasmdec::parsers::binary(ctx, ex);
-	} else if (ex->is<GetLocal>()) {
-        return wasmdec::parsers::get_local(ctx, ex);
-	} else if (ex->is<CallIndirect>()) {
-		return wasmdec::parsers::call_indirect(ctx, ex);
-	} else if (ex->is<SetLocal>()) {
-		return wasmdec::parsers::set_local(ctx, ex);
-	} else if (ex->is<Load>()) {
-		return wasmdec::parsers::load(ctx, ex);
-	} else if (ex->is<Store>()) {
-		return wasmdec::parsers::store(ctx, ex);
-	} else if (ex->is<Unary>()) {
-		return wasmdec::parsers::unary(ctx, ex);
-	} else if (ex->is<AtomicRMW>()) {
-		return wasmdec::parsers::atomics(ctx, ex);
-	} else if (ex->is<AtomicCmpxchg>()) {
-		return wasmdec::parsers::atomics(ctx, ex);
-	} else if (ex->is<Select>()) {
-		return wasmdec::parsers::select(ctx, ex);
-	} else if (ex->is<Drop>()) {
-		return wasmdec::parsers::drop(ctx, ex);
-	} else if (ex->is<Host>()) {
-		return wasmdec::parsers::host(ctx, ex);
-	} else if (ex->is<Unreachable>()) {
-		return wasmdec::parsers::unreachable(ctx, ex);
-	} else if (ex->is<SetGlobal>()) {
-		return wasmdec::parsers::set_global(ctx, ex);
-	} else if (ex->is<GetGlobal>()) {
-		return wasmdec::parsers::get_global(ctx, ex);
-	} else if (ex->is<Loop>()) {
-		return wasmdec::parsers::loop(ctx, ex);
-	} else if (ex->is<Switch>()) {
-		return wasmdec::parsers::_switch(ctx, ex);
-	} else if (ex->is<Call>()) {
-		return wasmdec::parsers::call(ctx, ex);
-	} else if (ex->is<If>()) {
-		return wasmdec::parsers::_if(ctx, ex);
-	} else if (ex->is<Nop>()) {
-		return wasmdec::parsers::nop(ctx, ex);
-	} else if (ex->is<If>()) {
-		return wasmdec::parsers::_if(ctx, ex);
-	} else if (ex->is<Const>()) {
-		return wasmdec::parsers::_const(ctx, ex);
-	} else if (ex->is<Return>()) {
-		return wasmdec::parsers::_return(ctx, ex);
-	} else if (ex->is<Break>()) {
-		return wasmdec::parsers::_break(ctx, ex);
+void wasmdec::parsers::expression(Context* ctx, Frame& f, string& out) {
+	// Dispatch on the expression id so every kind of node costs the same jump
+	switch (f.ex->_id) {
+		case Expression::BlockId:
+			wasmdec::parsers::block(ctx, f, out);
+			break;
+		case Expression::IfId:
+			wasmdec::parsers::_if(ctx, f, out);
+			break;
+		case Expression::LoopId:
+			wasmdec::parsers::loop(ctx, f, out);
+			break;
+		case Expression::BreakId:
+			wasmdec::parsers::_break(ctx, f, out);
+			break;
+		case Expression::SwitchId:
+			wasmdec::parsers::_switch(ctx, f, out);
+			break;
+		case Expression::CallId:
+			wasmdec::parsers::call(ctx, f, out);
+			break;
+		case Expression::CallIndirectId:
+			wasmdec::parsers::call_indirect(ctx, f, out);
+			break;
+		case Expression::GetLocalId:
+			wasmdec::parsers::get_local(ctx, f, out);
+			break;
+		case Expression::SetLocalId:
+			wasmdec::parsers::set_local(ctx, f, out);
+			break;
+		case Expression::GetGlobalId:
+			wasmdec::parsers::get_global(ctx, f, out);
+			break;
+		case Expression::SetGlobalId:
+			wasmdec::parsers::set_global(ctx, f, out);
+			break;
+		case Expression::LoadId:
+			wasmdec::parsers::load(ctx, f, out);
+			break;
+		case Expression::StoreId:
+			wasmdec::parsers::store(ctx, f, out);
+			break;
+		case Expression::ConstId:
+			wasmdec::parsers::_const(ctx, f, out);
+			break;
+		case Expression::UnaryId:
+			wasmdec::parsers::unary(ctx, f, out);
+			break;
+		case Expression::BinaryId:
+			wasmdec::parsers::binary(ctx, f, out);
+			break;
+		case Expression::SelectId:
+			wasmdec::parsers::select(ctx, f, out);
+			break;
+		case Expression::DropId:
+			wasmdec::parsers::drop(ctx, f, out);
+			break;
+		case Expression::ReturnId:
+			wasmdec::parsers::_return(ctx, f, out);
+			break;
+		case Expression::HostId:
+			wasmdec::parsers::host(ctx, f, out);
+			break;
+		case Expression::NopId:
+			wasmdec::parsers::nop(ctx, f, out);
+			break;
+		case Expression::UnreachableId:
+			wasmdec::parsers::unreachable(ctx, f, out);
+			break;
+		case Expression::AtomicRMWId:
+		case Expression::AtomicCmpxchgId:
+			wasmdec::parsers::atomics(ctx, f, out);
+			break;
+		default:
+			out += "/* UNKNOWN EXPRESSION */";
+			break;
 	}
-	return "/* UNKNOWN EXPRESSION */";
-}
\ No newline at end of file
+}
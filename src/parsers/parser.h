@@ -5,32 +5,67 @@
 using namespace std;
 
 namespace wasmdec {
+    // Each parser appends the C text of one expression to the output string
     namespace parsers {
-        std::string block(Context*, Expression*);
-        std::string binary(Context*, Expression*);
-        std::string get_local(Context*, Expression*);
-        std::string _return(Context*, Expression*);
-        std::string _if(Context*, Expression*);
-        std::string _const(Context*, Expression*);
-        std::string nop(Context*, Expression*);
-        std::string get_global(Context*, Expression*);
-        std::string set_global(Context*, Expression*);
-        std::string _break(Context*, Expression*);
-        std::string call(Context*, Expression*);
-        std::string call_import(Context*, Expression*);
-        std::string loop(Context*, Expression*);
-        std::string _switch(Context*, Expression*);
-        std::string call_indirect(Context*, Expression*);
-        std::string set_local(Context*, Expression*);
-        std::string load(Context*, Expression*);
-        std::string store(Context*, Expression*);
-        std::string unary(Context*, Expression*);
-        std::string select(Context*, Expression*);
-        std::string drop(Context*, Expression*);
-        std::string host(Context*, Expression*);
-        std::string unreachable(Context*, Expression*);
-        std::string atomics(Context*, Expression*);
-        std::string expression(Context*, Expression*);
+        // An expression being written. Parsers don't recurse into their children: they
+        // queue one with visit() and return, and are called again with the same frame
+        // at the given step once the child has been written. Nesting depth is then only
+        // limited by memory, not by the thread's stack.
+        struct Frame {
+            Expression* ex;
+            Expression* next = nullptr; // Child to write before the parser resumes
+            unsigned step = 0; // Where the parser resumes, 0 on the first call
+            Index index = 0; // Position in a list of children
+            size_t start = 0; // Output position kept across children
+            int depth = 0; // Context depth kept across children
+            bool isInline = false;
+            bool isInPolyAssignment = false;
+            // Used by the compilable backend, see native::expression
+            bool statement = false; // Written as a statement rather than as a value
+            bool nextStatement = false; // The queued child is written as a statement
+            bool wrapped = false; // Unreachable code in value position, wrapped in ({ })
+            bool terminate = false; // A value written as a statement, ended with ";"
+            bool hoisted = false; // Operands are evaluated into temporaries first
+            size_t temp = 0; // First of the temporaries
+            Frame(Expression* _ex) : ex(_ex) { }
+            void visit(Expression* child, unsigned resume) {
+                next = child;
+                step = resume;
+                nextStatement = false;
+            }
+            void visitStatement(Expression* child, unsigned resume) {
+                visit(child, resume);
+                nextStatement = true;
+            }
+        };
+        void block(Context*, Frame&, string&);
+        void binary(Context*, Frame&, string&);
+        void get_local(Context*, Frame&, string&);
+        void _return(Context*, Frame&, string&);
+        void _if(Context*, Frame&, string&);
+        void _const(Context*, Frame&, string&);
+        void nop(Context*, Frame&, string&);
+        void get_global(Context*, Frame&, string&);
+        void set_global(Context*, Frame&, string&);
+        void _break(Context*, Frame&, string&);
+        void call(Context*, Frame&, string&);
+        void call_import(Context*, Frame&, string&);
+        void loop(Context*, Frame&, string&);
+        void _switch(Context*, Frame&, string&);
+        void call_indirect(Context*, Frame&, string&);
+        void set_local(Context*, Frame&, string&);
+        void load(Context*, Frame&, string&);
+        void store(Context*, Frame&, string&);
+        void unary(Context*, Frame&, string&);
+        void select(Context*, Frame&, string&);
+        void drop(Context*, Frame&, string&);
+        void host(Context*, Frame&, string&);
+        void unreachable(Context*, Frame&, string&);
+        void atomics(Context*, Frame&, string&);
+        void expression(Context*, Frame&, string&);
+        // Statement that branches to an enclosing block or loop: continue or break when C
+        // gets there on its own, a goto otherwise
+        void jump(Context*, wasm::Name target, bool inSwitch, string&);
     }
 }
 
@@ -1,22 +1,23 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::_return(Context* ctx, Expression* ex) {
-	string ret;
-	Return* spex = ex->cast<Return>();
+void wasmdec::parsers::_return(Context* ctx, Frame& f, string& out) {
+	Return* spex = f.ex->cast<Return>();
+	if (f.step == 1) {
+		out += ";\n";
+		return;
+	}
 	if (ctx->depth < 1) {
-		ret += util::tab(1);
+		util::tab(1, out);
 	} else {
-		ret += util::tab(ctx->depth);
+		util::tab(ctx->depth, out);
 	}
 	if (spex->value) {
 		// Insert expression as function return value
-		ret += "return ";
-		ctx->lastExpr = ex;
+		out += "return ";
+		ctx->lastExpr = f.ex;
 		ctx->functionLevelExpression = false;
-		ret += Convert::parseExpr(ctx, spex->value) + ";\n";
-	} else {
-		ret += "return;\n"; // For void functions
+		return f.visit(spex->value, 1);
 	}
-	return ret;
-}
\ No newline at end of file
+	out += "return;\n"; // For void functions
+}
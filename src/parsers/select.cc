@@ -1,19 +1,25 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::select(Context* ctx, Expression* ex) {
-	string ret;
+void wasmdec::parsers::select(Context* ctx, Frame& f, string& out) {
 	// Select is the WASM equivalent of C's ternary operator.
-    Select* slex = ex->cast<Select>();
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string cond = Convert::parseExpr(ctx, slex->condition);
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string ifTrue = Convert::parseExpr(ctx, slex->ifTrue);
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string ifFalse = Convert::parseExpr(ctx, slex->ifFalse);
-    ret += "(" + cond + ") ? (" + ifTrue + ") : (" + ifFalse + ");\n";
-	return ret;
-}
\ No newline at end of file
+    Select* slex = f.ex->cast<Select>();
+    switch (f.step) {
+        case 0:
+            out += "(";
+            ctx->lastExpr = f.ex;
+            ctx->functionLevelExpression = false;
+            return f.visit(slex->condition, 1);
+        case 1:
+            out += ") ? (";
+            ctx->lastExpr = f.ex;
+            ctx->functionLevelExpression = false;
+            return f.visit(slex->ifTrue, 2);
+        case 2:
+            out += ") : (";
+            ctx->lastExpr = f.ex;
+            ctx->functionLevelExpression = false;
+            return f.visit(slex->ifFalse, 3);
+    }
+    out += ");\n";
+}
@@ -1,30 +1,33 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::set_global(Context* ctx, Expression* ex) {
-    string ret;
+void wasmdec::parsers::set_global(Context* ctx, Frame& f, string& out) {
     // Set global variable
-    SetGlobal* gex = ex->cast<SetGlobal>();
-    bool isInline = false;
-    bool isInPolyAssignment = false;
+    SetGlobal* gex = f.ex->cast<SetGlobal>();
+    if (f.step == 1) {
+        if (!f.isInline && !f.isInPolyAssignment && !ctx->isIfCondition) {
+            out += ";\n";
+        }
+        return;
+    }
+    f.isInline = false;
+    f.isInPolyAssignment = false;
     if (ctx->lastExpr && !ctx->functionLevelExpression) {
         if (ctx->isIfCondition) {
-            isInline = true;
+            f.isInline = true;
         }
         if (ctx->lastExpr != nullptr) {
-            isInPolyAssignment = (ctx->lastExpr->is<Store>()
+            f.isInPolyAssignment = (ctx->lastExpr->is<Store>()
                                 || ctx->lastExpr->is<SetLocal>()
                                 || ctx->lastExpr->is<SetGlobal>());
         }
     }
 
-    ret += util::tab(ctx->depth) + gex->name.str + " = ";
+    util::tab(ctx->depth, out);
+    out += gex->name.str;
+    out += " = ";
     // The value is an expression
     ctx->functionLevelExpression = false;
-    ctx->lastExpr = ex;
-    ret += Convert::parseExpr(ctx, gex->value);
-    if (!isInline && !isInPolyAssignment && !ctx->isIfCondition) {
-        ret += ";\n";
-    }
-    return ret;
-}
\ No newline at end of file
+    ctx->lastExpr = f.ex;
+    f.visit(gex->value, 1);
+}
@@ -1,11 +1,19 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::set_local(Context* ctx, Expression* ex) {
-	string ret;
-	
+void wasmdec::parsers::set_local(Context* ctx, Frame& f, string& out) {
     // Resolve variable's C name
-    SetLocal* sl = ex->cast<SetLocal>();
+    SetLocal* sl = f.ex->cast<SetLocal>();
+    // Whether the value is itself an assignment
+    bool valueIsAssignment = (sl->value->is<SetLocal>()
+                            || sl->value->is<SetGlobal>()
+                            || sl->value->is<Store>());
+    if (f.step == 1) {
+        if (!f.isInline && !valueIsAssignment) {
+            out += ";\n";
+        }
+        return;
+    }
     bool isInline = false;
     bool isInPolyAssignment = false;
     if (ctx->lastExpr && !ctx->functionLevelExpression) {
@@ -25,21 +33,14 @@ string wasmdec::parsers::set_local(Context* ctx, Expression* ex) {
     ctx->lastSetLocal = idx;
     if (!isInline) {
         if (!isInPolyAssignment) {
-            ret += util::tab(ctx->depth);
+            util::tab(ctx->depth, out);
         }
     }
-    ret += Convert::getLocal((Index)idx);
-    ret += " = ";
+    Convert::getLocal((Index)idx, out);
+    out += " = ";
     // Resolve the value to be set
-    bool valueIsAssignment = (sl->value->is<SetLocal>()
-                            || sl->value->is<SetGlobal>()
-                            || sl->value->is<Store>());
-    ctx->lastExpr = ex;
+    f.isInline = isInline;
+    ctx->lastExpr = f.ex;
     ctx->functionLevelExpression = false;
-    ret += Convert::parseExpr(ctx, sl->value);
-    if (!isInline && !valueIsAssignment) {
-        ret += ";\n";
-    }
-
-	return ret;
-}
\ No newline at end of file
+    f.visit(sl->value, 1);
+}
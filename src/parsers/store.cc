@@ -1,15 +1,24 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::store(Context* ctx, Expression* ex) {
-	string ret;
-	Store* sxp = ex->cast<Store>();
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string _offset = Convert::parseExpr(ctx, sxp->ptr);
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string val = Convert::parseExpr(ctx, sxp->value);
+void wasmdec::parsers::store(Context* ctx, Frame& f, string& out) {
+	Store* sxp = f.ex->cast<Store>();
+    switch (f.step) {
+        case 0:
+            // Indentation depends on the context left behind by the operands, so it is
+            // inserted in front of the store once they have been written
+            f.start = out.size();
+            f.depth = ctx->depth;
+            out += "*((void*)(";
+            ctx->lastExpr = f.ex;
+            ctx->functionLevelExpression = false;
+            return f.visit(sxp->ptr, 1);
+        case 1:
+            out += ") = ";
+            ctx->lastExpr = f.ex;
+            ctx->functionLevelExpression = false;
+            return f.visit(sxp->value, 2);
+    }
 
     bool valueIsAssignment = (sxp->value->is<SetLocal>()
                             || sxp->value->is<SetGlobal>()
@@ -29,17 +38,12 @@ string wasmdec::parsers::store(Context* ctx, Expression* ex) {
     
     if (!isInline) {
         if (!isInPolyAssignment) {
-            ret += util::tab(ctx->depth);
+            out.insert(f.start, f.depth < 1 ? 1 : f.depth, '\t');
         }
     }
-    ret += "*((void*)(";
-    ret += _offset;
-    ret += ") = ";
-    ret += val;
     if (!isInline) {
         if (!valueIsAssignment) {
-            ret += "; \n";;
+            out += "; \n";
         }
     }
-	return ret;
-}
\ No newline at end of file
+}
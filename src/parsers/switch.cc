@@ -1,58 +1,51 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::_switch(Context* ctx, Expression* ex) {
-	string ret;
+void wasmdec::parsers::_switch(Context* ctx, Frame& f, string& out) {
     /*
         how wasm switches work:
 
-        switch (<topmost stack variable>) {
-            case <index of body expression>:
-                goto <body expression>
+        switch (<condition>) {
+            case <index in the table>:
+                <branch to the entry's label>
             default:
-                <default value>
+                <branch to the default label>
         }
     */
-    // cout << "switch!\n" << endl;
-    Switch* sw = ex->cast<Switch>();
-    // start of switch routine
-    ret += util::tab(ctx->depth);
-    ret += "switch (";
-    ret += Convert::getLocal(ctx->lastSetLocal);
-    ret += ") {\n";
+    Switch* sw = f.ex->cast<Switch>();
+    if (f.step == 0) {
+        // start of switch routine
+        util::tab(ctx->depth, out);
+        out += "switch (";
+        ctx->lastExpr = f.ex;
+        ctx->functionLevelExpression = false;
+        return f.visit(sw->condition, 1);
+    }
+    out += ") {\n";
     ctx->depth++;
-    
-    // routine body
+
+    // routine body; entries that go where the default goes are left to it
     for (unsigned int i = 0; i < sw->targets.size(); ++i) {
-        string sname = string(sw->targets[i].str);
-        ret += util::tab(ctx->depth);
-        ret += "case ";
-        ret += to_string(i + 1);
-        ret += ":\n";
-        ctx->depth++;
-        ret += util::tab(ctx->depth);
-        ret += "goto ";
-        ret += sname;
-        ret += ";";
-        ctx->depth--;
-        ret += "\n";
+        if (sw->targets[i] == sw->default_) {
+            continue;
+        }
+        util::tab(ctx->depth, out);
+        out += "case ";
+        out += to_string(i);
+        out += ":\n";
+        util::tab(ctx->depth + 1, out);
+        jump(ctx, sw->targets[i], true, out);
+        out += "\n";
     }
     // default
-    const char* defaultName = sw->default_.str;
-    if (defaultName != nullptr && strlen(defaultName)) {
-        ret += util::tab(ctx->depth);
-        ret += "default:\n";
-        ctx->depth++;
-        ret += util::tab(ctx->depth);
-        ret += "goto ";
-        ret += defaultName;
-        ret += ";\n";
-        ctx->depth--;
-    }
-    
+    util::tab(ctx->depth, out);
+    out += "default:\n";
+    util::tab(ctx->depth + 1, out);
+    jump(ctx, sw->default_, true, out);
+    out += "\n";
+
     // end of switch routine
     ctx->depth--;
-    ret += util::tab(ctx->depth);
-    ret += "}\n";
-    return ret;
-}
\ No newline at end of file
+    util::tab(ctx->depth, out);
+    out += "}\n";
+}
@@ -1,12 +1,20 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::unary(Context* ctx, Expression* ex) {
-	string ret;
-	Unary* uex = ex->cast<Unary>();
-    ctx->lastExpr = ex;
-    ctx->functionLevelExpression = false;
-    string unaryEx = Convert::parseExpr(ctx, uex->value);
-    ret += Convert::getUnary(unaryEx, uex->op);
-	return ret;
-}
\ No newline at end of file
+void wasmdec::parsers::unary(Context* ctx, Frame& f, string& out) {
+	Unary* uex = f.ex->cast<Unary>();
+    OperatorSyntax op = Convert::getUnary(uex->op);
+    if (f.step == 0) {
+        f.start = out.size();
+        out += op.prefix;
+        ctx->lastExpr = f.ex;
+        ctx->functionLevelExpression = false;
+        return f.visit(uex->value, 1);
+    }
+    out += op.suffix;
+    if (!op.supported) {
+        // The operand is still parsed so the context ends up the same, but only the comment is kept
+        out.resize(f.start);
+        out += op.prefix;
+    }
+}
@@ -1,6 +1,6 @@
 #include "parser.h"
 using namespace wasmdec;
 
-string wasmdec::parsers::unreachable(Context* ctx, Expression* ex) {
-	return "/* Unreachable */";
-}
\ No newline at end of file
+void wasmdec::parsers::unreachable(Context* ctx, Frame& f, string& out) {
+	out += "/* Unreachable */";
+}
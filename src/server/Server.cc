@@ -0,0 +1,543 @@
+#include "Server.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <new>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+using namespace wasmdec;
+
+namespace {
+	volatile sig_atomic_t stopRequested = 0;
+
+	void requestStop(int) {
+		stopRequested = 1;
+	}
+	bool writeAll(int fd, const char* data, size_t size) {
+		while (size) {
+			ssize_t n = write(fd, data, size);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return false;
+			}
+			data += n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+	// Reads until the buffer holds an empty line, returns the position of that "\n\n"
+	size_t readHeader(int fd, string& buffer) {
+		char chunk[4096];
+		size_t end;
+		while ((end = buffer.find("\n\n")) == string::npos) {
+			if (buffer.size() > ServeProtocol::maxHeaderSize) {
+				return string::npos;
+			}
+			ssize_t n = read(fd, chunk, sizeof(chunk));
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return string::npos;
+			}
+			buffer.append(chunk, (size_t)n);
+		}
+		return end;
+	}
+	// Content hash of uploaded modules: FNV-1a and a multiply-rotate mix over the bytes
+	string hashBytes(const vector<char>& bytes) {
+		uint64_t fnv = 0xcbf29ce484222325ULL;
+		uint64_t mix = 0x9e3779b97f4a7c15ULL;
+		for (char c : bytes) {
+			fnv ^= (unsigned char)c;
+			fnv *= 0x100000001b3ULL;
+			mix ^= (unsigned char)c;
+			mix *= 0xff51afd7ed558ccdULL;
+			mix = (mix << 31) | (mix >> 33);
+		}
+		char buf[33];
+		snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)fnv, (unsigned long long)mix);
+		return string(buf);
+	}
+	bool fillAddress(const string& path, struct sockaddr_un& addr) {
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path)) {
+			return false;
+		}
+		strcpy(addr.sun_path, path.c_str());
+		return true;
+	}
+}
+
+// Protocol
+string ServeProtocol::modeName(DisasmMode mode) {
+	if (mode == DisasmMode::Wast) {
+		return "wast";
+	} else if (mode == DisasmMode::AsmJs) {
+		return "js";
+	}
+	return "wasm";
+}
+string ServeProtocol::encodeRequest(const DisasmConfig& conf, const string& path, size_t payloadSize) {
+	string header;
+	if (path.size()) {
+		header += "path=" + path + "\n";
+	} else {
+		header += "size=" + to_string(payloadSize) + "\n";
+	}
+	header += "mode=" + modeName(conf.mode) + "\n";
+	header += string("debug=") + (conf.debug ? "1" : "0") + "\n";
+	header += string("extra=") + (conf.extra ? "1" : "0") + "\n";
+	header += string("preamble=") + (conf.includePreamble ? "1" : "0") + "\n";
+	header += "jobs=" + to_string(conf.jobs) + "\n";
+	if (conf.fnPreface.size()) {
+		header += "preface=" + conf.fnPreface + "\n";
+	}
+	for (auto& pattern : conf.only) {
+		header += "only=" + pattern + "\n";
+	}
+	for (auto& pattern : conf.exclude) {
+		header += "exclude=" + pattern + "\n";
+	}
+	if (conf.reachableFromExports) {
+		header += "reachable=1\n";
+	}
+	if (conf.compilable) {
+		header += "compilable=1\n";
+	}
+	if (conf.fastTraps) {
+		header += "traps=fast\n";
+	}
+	for (auto& pattern : conf.roots) {
+		header += "root=" + pattern + "\n";
+	}
+	if (conf.cacheDir.size()) {
+		header += "cache=" + conf.cacheDir + "\n";
+		header += "cache-size=" + to_string(conf.cacheSize) + "\n";
+	}
+	header += "\n";
+	return header;
+}
+string ServeProtocol::trailer(size_t codeSize) {
+	char buf[trailerSize + 1];
+	snprintf(buf, sizeof(buf), "\nend %016llx\n", (unsigned long long)codeSize);
+	return string(buf, trailerSize);
+}
+bool ServeProtocol::decodeRequest(const string& header, DisasmConfig& conf, string& path, size_t& payloadSize) {
+	path = "";
+	payloadSize = 0;
+	bool hasInput = false;
+	size_t pos = 0;
+	try {
+		while (pos < header.size()) {
+			size_t eol = header.find('\n', pos);
+			if (eol == string::npos) {
+				eol = header.size();
+			}
+			string line = header.substr(pos, eol - pos);
+			pos = eol + 1;
+			if (!line.size()) {
+				continue;
+			}
+			size_t eq = line.find('=');
+			if (eq == string::npos) {
+				return false;
+			}
+			string key = line.substr(0, eq);
+			string value = line.substr(eq + 1);
+			if (key == "path") {
+				path = value;
+				hasInput = true;
+			} else if (key == "size") {
+				payloadSize = stoul(value);
+				hasInput = true;
+			} else if (key == "mode") {
+				if (value == "wast") {
+					conf.mode = DisasmMode::Wast;
+				} else if (value == "js") {
+					conf.mode = DisasmMode::AsmJs;
+				} else {
+					conf.mode = DisasmMode::Wasm;
+				}
+			} else if (key == "debug") {
+				conf.debug = value == "1";
+			} else if (key == "extra") {
+				conf.extra = value == "1";
+			} else if (key == "preamble") {
+				conf.includePreamble = value == "1";
+			} else if (key == "jobs") {
+				conf.jobs = stoi(value);
+			} else if (key == "preface") {
+				conf.fnPreface = value;
+			} else if (key == "only") {
+				conf.only.push_back(value);
+			} else if (key == "exclude") {
+				conf.exclude.push_back(value);
+			} else if (key == "reachable") {
+				conf.reachableFromExports = value == "1";
+			} else if (key == "root") {
+				conf.roots.push_back(value);
+			} else if (key == "compilable") {
+				conf.compilable = value == "1";
+			} else if (key == "traps") {
+				conf.fastTraps = value == "fast";
+			} else if (key == "cache") {
+				conf.cacheDir = value;
+			} else if (key == "cache-size") {
+				conf.cacheSize = stoul(value);
+			}
+			// Unknown keys are ignored so newer clients can talk to older servers
+		}
+	} catch (exception& err) {
+		return false;
+	}
+	if (conf.jobs < 1) {
+		conf.jobs = 1;
+	}
+	return hasInput;
+}
+
+// Server
+Server::Server(string _socketPath, size_t _maxModules) {
+	socketPath = _socketPath;
+	maxModules = _maxModules < 1 ? 1 : _maxModules;
+	listenFd = -1;
+	parses = 0;
+	reuses = 0;
+}
+bool Server::listen() {
+	struct sockaddr_un addr;
+	if (!fillAddress(socketPath, addr)) {
+		cerr << "wasmdec: socket path is too long: " << socketPath << endl;
+		return false;
+	}
+	// Replace a socket left behind by a previous server, but never any other kind of file
+	struct stat st;
+	if (lstat(socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+		unlink(socketPath.c_str());
+	}
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0) {
+		return false;
+	}
+	if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd, 64) != 0) {
+		cerr << "wasmdec: can't listen on " << socketPath << ": " << strerror(errno) << endl;
+		::close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+	return true;
+}
+void Server::run() {
+	// A client that hangs up early must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+	// No SA_RESTART, so accept() returns when a stop is requested
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestStop;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+	stopRequested = 0;
+	while (!stopRequested) {
+		int client = accept(listenFd, nullptr, nullptr);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			cerr << "wasmdec: accept failed: " << strerror(errno) << endl;
+			break;
+		}
+		handle(client);
+	}
+	cerr << "wasmdec: served " << (parses + reuses) << " requests, "
+		<< reuses << " on already parsed modules" << endl;
+}
+void Server::close() {
+	if (listenFd >= 0) {
+		::close(listenFd);
+		listenFd = -1;
+		unlink(socketPath.c_str());
+	}
+	moduleIndex.clear();
+	modules.clear();
+}
+void Server::reply(int fd, const string& msg) {
+	writeAll(fd, msg.data(), msg.size());
+	::close(fd);
+}
+void Server::handle(int fd) {
+	bool streaming = false;
+	try {
+		respond(fd, streaming);
+	} catch (exception& err) {
+		// Once the code is streaming, the missing trailer tells the client it failed
+		if (streaming) {
+			::close(fd);
+		} else {
+			reply(fd, string("error ") + (dynamic_cast<bad_alloc*>(&err) ? "out of memory" : err.what()) + "\n");
+		}
+	}
+}
+void Server::respond(int fd, bool& streaming) {
+	string buffer;
+	size_t end = readHeader(fd, buffer);
+	if (end == string::npos) {
+		reply(fd, "error malformed request\n");
+		return;
+	}
+	DisasmConfig conf(false, false, DisasmMode::Wasm);
+	string path;
+	size_t payloadSize;
+	if (!ServeProtocol::decodeRequest(buffer.substr(0, end + 1), conf, path, payloadSize)) {
+		reply(fd, "error malformed request\n");
+		return;
+	}
+	// Modules are cached per input mode as well as per content
+	string key = ServeProtocol::modeName(conf.mode) + ":";
+	vector<char> bytes;
+	if (path.size()) {
+		// Files are identified by where they are and when they last changed, so
+		// unchanged inputs are recognized without reading them
+		char resolved[PATH_MAX];
+		struct stat st;
+		if (!realpath(path.c_str(), resolved) || stat(resolved, &st) != 0) {
+			reply(fd, "error can't read input file " + path + "\n");
+			return;
+		}
+		key += string("path:") + resolved + ":" + to_string(st.st_dev) + ":" + to_string(st.st_ino)
+			+ ":" + to_string(st.st_size) + ":" + to_string(st.st_mtim.tv_sec) + "." + to_string(st.st_mtim.tv_nsec);
+	} else {
+		if (payloadSize > ServeProtocol::maxPayloadSize) {
+			reply(fd, "error input is larger than " + to_string(ServeProtocol::maxPayloadSize) + " bytes\n");
+			return;
+		}
+		bytes.assign(buffer.begin() + end + 2, buffer.end());
+		if (bytes.size() > payloadSize) {
+			reply(fd, "error malformed request\n");
+			return;
+		}
+		bytes.resize(payloadSize);
+		size_t done = buffer.size() - (end + 2);
+		while (done < payloadSize) {
+			ssize_t n = read(fd, bytes.data() + done, payloadSize - done);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				::close(fd);
+				return;
+			}
+			done += (size_t)n;
+		}
+		key += "bytes:" + hashBytes(bytes) + ":" + to_string(bytes.size());
+	}
+	Decompiler* decompiler = getDecompiler(key, conf, path, bytes);
+	if (!decompiler) {
+		reply(fd, "error failed to parse the input\n");
+		return;
+	}
+	// The emitter owns a duplicate of the connection and closes it when done, so the
+	// trailer can follow on the original
+	int out = dup(fd);
+	if (out < 0) {
+		reply(fd, "error out of file descriptors\n");
+		return;
+	}
+	if (!writeAll(fd, "ok\n", 3)) {
+		::close(out);
+		::close(fd);
+		return;
+	}
+	streaming = true;
+	size_t before = decompiler->getStats().outputBytes;
+	decompiler->setOutputFd(out);
+	try {
+		decompiler->decompile();
+	} catch (...) {
+		decompiler->finishOutput();
+		throw;
+	}
+	if (decompiler->finishOutput()) {
+		string end = ServeProtocol::trailer(decompiler->getStats().outputBytes - before);
+		writeAll(fd, end.data(), end.size());
+	}
+	::close(fd);
+}
+Decompiler* Server::getDecompiler(const string& key, DisasmConfig& conf, const string& path, const vector<char>& bytes) {
+	auto found = moduleIndex.find(key);
+	if (found != moduleIndex.end()) {
+		modules.splice(modules.begin(), modules, found->second);
+		Decompiler* decompiler = modules.front().second.get();
+		decompiler->configure(conf);
+		reuses++;
+		if (conf.debug) {
+			cerr << "wasmdec: reusing parsed module " << key << endl;
+		}
+		return decompiler;
+	}
+	// The module is shared by later requests with other filters, so every body is decoded
+	DisasmConfig parseConf = conf;
+	parseConf.only.clear();
+	parseConf.exclude.clear();
+	unique_ptr<Decompiler> decompiler;
+	if (path.size()) {
+		InputFile input;
+		if (!input.open(path)) {
+			return nullptr;
+		}
+		decompiler.reset(new Decompiler(parseConf, input.span()));
+	} else {
+		decompiler.reset(new Decompiler(parseConf, ByteSpan(bytes)));
+	}
+	decompiler->configure(conf);
+	if (decompiler->failed()) {
+		return nullptr;
+	}
+	parses++;
+	modules.emplace_front(key, move(decompiler));
+	moduleIndex[key] = modules.begin();
+	while (modules.size() > maxModules) {
+		moduleIndex.erase(modules.back().first);
+		modules.pop_back();
+	}
+	return modules.front().second.get();
+}
+
+// Client
+Client::Client(string _socketPath) {
+	socketPath = _socketPath;
+}
+string Client::getError() {
+	return error;
+}
+bool Client::decompile(DisasmConfig conf, string input, bool upload, string outfile) {
+	if (conf.cacheDir.size() && conf.cacheDir[0] != '/') {
+		// Paths are resolved by the server, which may run in another directory
+		char cwd[PATH_MAX];
+		if (getcwd(cwd, sizeof(cwd))) {
+			conf.cacheDir = string(cwd) + "/" + conf.cacheDir;
+		}
+	}
+	InputFile file;
+	string header;
+	if (upload) {
+		if (!file.open(input)) {
+			error = "failed to read the input file!";
+			return false;
+		}
+		header = ServeProtocol::encodeRequest(conf, "", file.span().size);
+	} else {
+		char resolved[PATH_MAX];
+		if (!realpath(input.c_str(), resolved)) {
+			error = "failed to read the input file!";
+			return false;
+		}
+		header = ServeProtocol::encodeRequest(conf, resolved, 0);
+	}
+	struct sockaddr_un addr;
+	if (!fillAddress(socketPath, addr)) {
+		error = "socket path is too long";
+		return false;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		error = "can't connect to " + socketPath + ": " + strerror(errno);
+		if (fd >= 0) {
+			::close(fd);
+		}
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	bool sent = writeAll(fd, header.data(), header.size());
+	if (sent && upload) {
+		sent = writeAll(fd, file.span().data, file.span().size);
+	}
+	file.close();
+	if (!sent) {
+		error = "lost the connection to the server";
+		::close(fd);
+		return false;
+	}
+	// Status line, then the C code streams in until the server closes the connection
+	string status;
+	char chunk[1 << 16];
+	ssize_t n = 0;
+	while (status.find('\n') == string::npos) {
+		n = read(fd, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		status.append(chunk, (size_t)n);
+	}
+	size_t eol = status.find('\n');
+	if (eol == string::npos) {
+		error = "lost the connection to the server";
+		::close(fd);
+		return false;
+	}
+	if (status.compare(0, 3, "ok\n") != 0) {
+		error = status.substr(0, eol);
+		if (error.compare(0, 6, "error ") == 0) {
+			error = error.substr(6);
+		}
+		::close(fd);
+		return false;
+	}
+	int out = open(outfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out < 0) {
+		error = "failed to write the output file.";
+		::close(fd);
+		return false;
+	}
+	// The last trailerSize bytes received may be the trailer, so they are held back
+	// until the next read or the end of the reply
+	string pending = status.substr(eol + 1);
+	size_t written = 0;
+	bool ok = true;
+	while (ok) {
+		if (pending.size() > ServeProtocol::trailerSize) {
+			size_t size = pending.size() - ServeProtocol::trailerSize;
+			ok = writeAll(out, pending.data(), size);
+			if (!ok) {
+				error = "failed to write the output file.";
+				break;
+			}
+			written += size;
+			pending.erase(0, size);
+		}
+		n = read(fd, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			error = "lost the connection to the server";
+			ok = false;
+		}
+		if (n <= 0) {
+			break;
+		}
+		pending.append(chunk, (size_t)n);
+	}
+	if (ok && pending != ServeProtocol::trailer(written)) {
+		error = "the server stopped before the end of the output";
+		ok = false;
+	}
+	::close(fd);
+	if (::close(out) != 0 && ok) {
+		error = "failed to write the output file.";
+		ok = false;
+	}
+	return ok;
+}
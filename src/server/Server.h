@@ -0,0 +1,70 @@
+#ifndef _WASMDEC_SERVER_H
+#define _WASMDEC_SERVER_H
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "../decompiler/Decompiler.h"
+using namespace std;
+
+namespace wasmdec {
+	// Wire format between the client and the server, over a Unix stream socket.
+	// A request is a header of "key=value" lines ending with an empty line:
+	//   path=<input file>     or     size=<bytes of input following the header>
+	//   mode=wasm|wast|js, debug=0|1, extra=0|1, preamble=0|1, jobs=<n>,
+	//   preface=<function name prefix>, cache=<directory>, cache-size=<bytes>
+	// The reply is "ok\n" followed by the decompiled C and a trailer holding its size,
+	// then the server closes the connection; or it is "error <message>\n". A reply
+	// without its trailer was cut short.
+	class ServeProtocol {
+	public:
+		static string encodeRequest(const DisasmConfig&, const string& path, size_t payloadSize);
+		static bool decodeRequest(const string& header, DisasmConfig& conf, string& path, size_t& payloadSize);
+		static string modeName(DisasmMode);
+		// "\nend <size in 16 hex digits>\n", always trailerSize bytes
+		static string trailer(size_t codeSize);
+		static const size_t trailerSize = 22;
+		static const size_t maxHeaderSize = 64 << 10;
+		static const size_t maxPayloadSize = (size_t)1 << 30;
+	};
+
+	// Resident decompiler. Requests are served one at a time; parsed modules are
+	// kept in a bounded LRU so a module that was decompiled recently is never parsed again.
+	class Server {
+	public:
+		Server(string socketPath, size_t maxModules);
+		bool listen();
+		void run(); // Serves until SIGINT or SIGTERM
+		void close();
+	protected:
+		// Answers one request; errors, including running out of memory, only fail that request
+		void handle(int);
+		void respond(int, bool& streaming);
+		// Cached decompiler for the input, parsing it on a miss; nullptr when parsing fails
+		Decompiler* getDecompiler(const string& key, DisasmConfig&, const string& path, const vector<char>& bytes);
+		void reply(int, const string&);
+
+		string socketPath;
+		size_t maxModules;
+		int listenFd;
+		// Most recently used first
+		list<pair<string, unique_ptr<Decompiler>>> modules;
+		unordered_map<string, list<pair<string, unique_ptr<Decompiler>>>::iterator> moduleIndex;
+		size_t parses;
+		size_t reuses;
+	};
+
+	// Sends one request to a server and writes the reply to a file
+	class Client {
+	public:
+		Client(string socketPath);
+		// Input is sent by path, or uploaded when upload is set
+		bool decompile(DisasmConfig, string input, bool upload, string outfile);
+		string getError();
+	protected:
+		string socketPath;
+		string error;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_SERVER_H
@@ -0,0 +1,50 @@
+#include "Allocations.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+#ifdef WASMDEC_COUNT_ALLOCATIONS
+// Replacements for the global allocation functions that count every allocation.
+// The array and nothrow forms forward to these by default. The Makefile defines
+// WASMDEC_COUNT_ALLOCATIONS for the native tool and the benchmarks only, so the
+// emscripten build and other embedders of the sources keep their own allocator.
+
+static atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw bad_alloc();
+	}
+	return p;
+}
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	allocations.fetch_add(1, memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+void operator delete(void* p) noexcept {
+	free(p);
+}
+void operator delete(void* p, const nothrow_t&) noexcept {
+	free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+size_t wasmdec::stats::allocationCount() {
+	return allocations.load(memory_order_relaxed);
+}
+bool wasmdec::stats::countsAllocations() {
+	return true;
+}
+#else
+size_t wasmdec::stats::allocationCount() {
+	return 0;
+}
+bool wasmdec::stats::countsAllocations() {
+	return false;
+}
+#endif
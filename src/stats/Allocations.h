@@ -0,0 +1,17 @@
+#ifndef _WASMDEC_ALLOCATIONS_H
+#define _WASMDEC_ALLOCATIONS_H
+
+#include <cstddef>
+
+namespace wasmdec {
+	namespace stats {
+		// Number of heap allocations made through operator new by the whole process so far.
+		// Every thread is counted; take the difference of two readings to measure a phase.
+		// Always 0 unless the build defines WASMDEC_COUNT_ALLOCATIONS, which replaces the
+		// global operator new and delete to count them.
+		size_t allocationCount();
+		bool countsAllocations();
+	}
+} // namespace wasmdec
+
+#endif // _WASMDEC_ALLOCATIONS_H
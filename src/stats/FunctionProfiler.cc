@@ -0,0 +1,73 @@
+#include "FunctionProfiler.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+using namespace wasmdec::stats;
+
+namespace {
+	string csvField(const string& s) {
+		if (s.find_first_of(",\"\n") == string::npos) {
+			return s;
+		}
+		string quoted = "\"";
+		for (char c : s) {
+			if (c == '"') {
+				quoted += '"';
+			}
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+}
+
+void FunctionProfiler::record(FunctionProfile profile) {
+	lock_guard<mutex> guard(lock);
+	profiles.push_back(profile);
+}
+string FunctionProfiler::slowest(size_t count) {
+	lock_guard<mutex> guard(lock);
+	vector<const FunctionProfile*> order;
+	for (auto& p : profiles) {
+		order.push_back(&p);
+	}
+	count = min(count, order.size());
+	partial_sort(order.begin(), order.begin() + count, order.end(), [](const FunctionProfile* a, const FunctionProfile* b) {
+		return a->seconds > b->seconds;
+	});
+	stringstream out;
+	out << "Slowest " << count << " of " << profiles.size() << " functions:" << endl;
+	out << setw(12) << "Time (ms)" << setw(10) << "Nodes" << setw(8) << "Depth" << setw(12) << "Output"
+		<< "  Function" << endl;
+	out << fixed << setprecision(3);
+	for (size_t i = 0; i < count; ++i) {
+		const FunctionProfile* p = order[i];
+		out << setw(12) << p->seconds * 1000 << setw(10) << p->nodes << setw(8) << p->depth
+			<< setw(12) << p->outputBytes << "  " << p->name << " (#" << p->index << ")"
+			<< (p->cached ? " [cached]" : "") << endl;
+	}
+	return out.str();
+}
+bool FunctionProfiler::writeCsv(string path) {
+	lock_guard<mutex> guard(lock);
+	vector<const FunctionProfile*> order;
+	for (auto& p : profiles) {
+		order.push_back(&p);
+	}
+	// Profiles are recorded in completion order, which differs between threaded runs
+	sort(order.begin(), order.end(), [](const FunctionProfile* a, const FunctionProfile* b) {
+		return a->index < b->index;
+	});
+	ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	file << "index,name,seconds,nodes,depth,output_bytes,cached" << endl;
+	file << setprecision(9);
+	for (auto* p : order) {
+		file << p->index << "," << csvField(p->name) << "," << p->seconds << "," << p->nodes << ","
+			<< p->depth << "," << p->outputBytes << "," << (p->cached ? 1 : 0) << endl;
+	}
+	file.close();
+	return !file.fail();
+}
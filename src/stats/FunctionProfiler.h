@@ -0,0 +1,37 @@
+#ifndef _WASMDEC_FUNCTION_PROFILER_H
+#define _WASMDEC_FUNCTION_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+using namespace std;
+
+namespace wasmdec {
+	namespace stats {
+		// Cost of decompiling one function body
+		struct FunctionProfile {
+			size_t index;
+			string name; // C name
+			double seconds;
+			size_t nodes; // Expressions in the body
+			size_t depth; // Deepest expression nesting
+			size_t outputBytes; // Bytes of C in the body
+			bool cached; // Taken from the function cache rather than decompiled
+		};
+		// Collects function profiles from any number of threads
+		class FunctionProfiler {
+		public:
+			void record(FunctionProfile);
+			// Table of the slowest functions, slowest first
+			string slowest(size_t count);
+			// Every function, in module order
+			bool writeCsv(string path);
+		protected:
+			mutex lock;
+			vector<FunctionProfile> profiles;
+		};
+	}
+} // namespace wasmdec
+
+#endif // _WASMDEC_FUNCTION_PROFILER_H
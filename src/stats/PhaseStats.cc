@@ -0,0 +1,138 @@
+#include "PhaseStats.h"
+#include "Allocations.h"
+#include "Trace.h"
+#include <ctime>
+#include <sstream>
+#include <iomanip>
+#include <sys/resource.h>
+using namespace wasmdec::stats;
+
+double wasmdec::stats::wallSeconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+double wasmdec::stats::cpuSeconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+double wasmdec::stats::threadCpuSeconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+size_t wasmdec::stats::peakResidentBytes() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+	return (size_t)usage.ru_maxrss * 1024; // Reported in KiB on Linux
+}
+
+PhaseTimer::PhaseTimer(const char* _name) {
+	name = _name;
+	wallStart = wallSeconds();
+	cpuStart = cpuSeconds();
+	allocationsStart = allocationCount();
+	traceStart = name && Trace::isEnabled() ? Trace::now() : 0;
+}
+PhaseTime PhaseTimer::elapsed() {
+	if (name && Trace::isEnabled()) {
+		Trace::record("phase", name, traceStart, Trace::now());
+		name = nullptr;
+	}
+	return PhaseTime{wallSeconds() - wallStart, cpuSeconds() - cpuStart, allocationCount() - allocationsStart};
+}
+
+RunStats::RunStats() {
+	functions = 0;
+	inputBytes = 0;
+	outputBytes = 0;
+	hasCache = false;
+	cacheHits = cacheMisses = cacheEvictions = 0;
+	// Every run reports the same phases, in the order they run, so reports can be compared
+	for (auto name : {"read", "parse", "globals", "functions", "exports", "write"}) {
+		phases.push_back(Phase{name, PhaseTime{0, 0, 0}});
+	}
+}
+void RunStats::add(const string& name, PhaseTime time) {
+	for (auto& p : phases) {
+		if (p.name == name) {
+			p.time.wallSeconds += time.wallSeconds;
+			p.time.cpuSeconds += time.cpuSeconds;
+			p.time.allocations += time.allocations;
+			return;
+		}
+	}
+	phases.push_back(Phase{name, time});
+}
+PhaseTime RunStats::get(const string& name) {
+	for (auto& p : phases) {
+		if (p.name == name) {
+			return p.time;
+		}
+	}
+	return PhaseTime{0, 0, 0};
+}
+string RunStats::text() {
+	stringstream out;
+	out << fixed << setprecision(6);
+	bool allocations = countsAllocations();
+	out << left << setw(12) << "Phase" << right << setw(12) << "Wall (s)" << setw(12) << "CPU (s)";
+	if (allocations) {
+		out << setw(14) << "Allocations";
+	}
+	out << endl;
+	for (auto& p : phases) {
+		out << left << setw(12) << p.name << right << setw(12) << p.time.wallSeconds
+			<< setw(12) << p.time.cpuSeconds;
+		if (allocations) {
+			out << setw(14) << p.time.allocations;
+		}
+		out << endl;
+	}
+	PhaseTime fn = get("functions");
+	out << setprecision(1);
+	out << "Functions: " << functions << " decompiled, "
+		<< (fn.wallSeconds > 0 ? functions / fn.wallSeconds : 0.0) << " per second" << endl;
+	out << "Input: " << inputBytes << " bytes, output: " << outputBytes << " bytes of C" << endl;
+	out << "Peak RSS: " << peakResidentBytes() / (1024.0 * 1024.0) << " MiB";
+	if (allocations) {
+		out << ", " << allocationCount() << " heap allocations in total";
+	}
+	out << endl;
+	if (hasCache) {
+		out << "Function cache (" << cacheDirectory << "): " << cacheHits << " hits, " << cacheMisses << " misses, "
+			<< cacheEvictions << " evicted" << endl;
+	}
+	return out.str();
+}
+string RunStats::json() {
+	stringstream out;
+	out << setprecision(9);
+	out << "{\"phases\":{";
+	for (size_t i = 0; i < phases.size(); ++i) {
+		out << (i ? "," : "") << "\"" << phases[i].name << "\":{\"wallSeconds\":" << phases[i].time.wallSeconds
+			<< ",\"cpuSeconds\":" << phases[i].time.cpuSeconds;
+		if (countsAllocations()) {
+			out << ",\"allocations\":" << phases[i].time.allocations;
+		}
+		out << "}";
+	}
+	PhaseTime fn = get("functions");
+	out << "},\"functions\":" << functions
+		<< ",\"functionsPerSecond\":" << (fn.wallSeconds > 0 ? functions / fn.wallSeconds : 0.0)
+		<< ",\"inputBytes\":" << inputBytes
+		<< ",\"outputBytes\":" << outputBytes
+		<< ",\"peakRssBytes\":" << peakResidentBytes();
+	if (countsAllocations()) {
+		out << ",\"allocations\":" << allocationCount();
+	}
+	if (hasCache) {
+		out << ",\"cache\":{\"hits\":" << cacheHits << ",\"misses\":" << cacheMisses
+			<< ",\"evictions\":" << cacheEvictions << "}";
+	}
+	out << "}";
+	return out.str();
+}
@@ -0,0 +1,62 @@
+#ifndef _WASMDEC_PHASE_STATS_H
+#define _WASMDEC_PHASE_STATS_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+namespace wasmdec {
+	namespace stats {
+		// Resources spent in one phase of a run
+		struct PhaseTime {
+			double wallSeconds;
+			double cpuSeconds; // Every thread of the process
+			size_t allocations;
+		};
+		// Measures a phase from its construction. A named phase is also recorded as a trace
+		// span when elapsed() is first read.
+		class PhaseTimer {
+		public:
+			PhaseTimer(const char* name = nullptr);
+			PhaseTime elapsed();
+		protected:
+			const char* name;
+			double wallStart;
+			double cpuStart;
+			size_t allocationsStart;
+			double traceStart;
+		};
+		// Phase times and throughput of a run, printable as text or JSON
+		class RunStats {
+		public:
+			RunStats();
+			// Times of a phase that runs more than once are added up
+			void add(const string& phase, PhaseTime);
+			PhaseTime get(const string& phase);
+			size_t functions; // Function bodies decompiled
+			size_t inputBytes;
+			size_t outputBytes; // Bytes of C written
+			bool hasCache;
+			string cacheDirectory;
+			size_t cacheHits;
+			size_t cacheMisses;
+			size_t cacheEvictions;
+			string text();
+			string json();
+		protected:
+			struct Phase {
+				string name;
+				PhaseTime time;
+			};
+			vector<Phase> phases; // In the order they first ran
+		};
+		double wallSeconds();
+		double cpuSeconds();
+		double threadCpuSeconds(); // Calling thread only
+		// Peak resident set size of the process so far
+		size_t peakResidentBytes();
+	}
+} // namespace wasmdec
+
+#endif // _WASMDEC_PHASE_STATS_H
@@ -0,0 +1,78 @@
+#include "Trace.h"
+#include <mutex>
+#include <vector>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+using namespace wasmdec::stats;
+
+bool Trace::enabled = false;
+
+namespace {
+	struct Event {
+		const char* category;
+		const char* name;
+		double start;
+		double end;
+		long tid;
+	};
+	mutex eventsLock;
+	vector<Event> events;
+	double origin = 0;
+
+	long threadId() {
+		static thread_local long tid = syscall(SYS_gettid);
+		return tid;
+	}
+	void writeString(FILE* out, const char* s) {
+		fputc('"', out);
+		for (; *s; ++s) {
+			unsigned char c = (unsigned char)*s;
+			if (c == '"' || c == '\\') {
+				fputc('\\', out);
+				fputc(c, out);
+			} else if (c < 0x20) {
+				fprintf(out, "\\u%04x", c);
+			} else {
+				fputc(c, out);
+			}
+		}
+		fputc('"', out);
+	}
+}
+
+void Trace::enable() {
+	origin = 0;
+	origin = now();
+	enabled = true;
+}
+double Trace::now() {
+	// Microseconds since tracing was enabled, the unit trace viewers expect
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3 - origin;
+}
+void Trace::record(const char* category, const char* name, double start, double end) {
+	long tid = threadId();
+	lock_guard<mutex> guard(eventsLock);
+	events.push_back(Event{category, name, start, end, tid});
+}
+bool Trace::write(string path) {
+	FILE* out = fopen(path.c_str(), "w");
+	if (!out) {
+		return false;
+	}
+	lock_guard<mutex> guard(eventsLock);
+	long pid = getpid();
+	fprintf(out, "{\"traceEvents\":[\n");
+	fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":\"main\"}}", pid, threadId());
+	for (auto& e : events) {
+		fprintf(out, ",\n{\"name\":");
+		writeString(out, e.name);
+		fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+			e.category, e.start, e.end - e.start, pid, e.tid);
+	}
+	fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return fclose(out) == 0;
+}
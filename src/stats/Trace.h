@@ -0,0 +1,51 @@
+#ifndef _WASMDEC_TRACE_H
+#define _WASMDEC_TRACE_H
+
+#include <string>
+using namespace std;
+
+namespace wasmdec {
+	namespace stats {
+		// Chrome trace event recording for the whole process.
+		// When tracing is off a span costs one branch: names are never copied and the
+		// clock is never read.
+		class Trace {
+		public:
+			static void enable();
+			static bool isEnabled() {
+				return enabled;
+			}
+			// Writes every span recorded so far as Chrome/Perfetto trace event JSON
+			static bool write(string path);
+			static void record(const char* category, const char* name, double start, double end);
+			static double now();
+		protected:
+			static bool enabled;
+		};
+		// Records a span from construction to destruction on the calling thread.
+		// The name must outlive the trace; interned wasm names and literals do.
+		class TraceSpan {
+		public:
+			TraceSpan(const char* _category, const char* _name) {
+				if (Trace::isEnabled()) {
+					category = _category;
+					name = _name;
+					start = Trace::now();
+				}
+			}
+			~TraceSpan() {
+				if (Trace::isEnabled()) {
+					Trace::record(category, name, start, Trace::now());
+				}
+			}
+		protected:
+			TraceSpan(const TraceSpan&) = delete;
+			TraceSpan& operator=(const TraceSpan&) = delete;
+			const char* category = nullptr;
+			const char* name = nullptr;
+			double start = 0;
+		};
+	}
+} // namespace wasmdec
+
+#endif // _WASMDEC_TRACE_H
@@ -0,0 +1,244 @@
+#include "BinaryIndex.h"
+#include <cstring>
+using namespace wasmdec;
+
+namespace {
+	// Section ids from the binary format
+	enum SectionId {
+		CustomSection = 0,
+		ImportSection = 2,
+		FunctionSection = 3,
+		ExportSection = 7,
+		CodeSection = 10
+	};
+	const uint8_t stubBody[] = { 0x03, 0x00, 0x00, 0x0b }; // size 3, no locals, unreachable, end
+}
+
+uint8_t BinaryIndex::Reader::byte() {
+	if (pos >= end) {
+		ok = false;
+		return 0;
+	}
+	return *pos++;
+}
+uint64_t BinaryIndex::Reader::uleb() {
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t b = byte();
+		value |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return value;
+		}
+	}
+	ok = false;
+	return 0;
+}
+string BinaryIndex::Reader::str() {
+	size_t len = uleb();
+	if (!ok || len > (size_t)(end - pos)) {
+		ok = false;
+		return "";
+	}
+	string s((const char*)pos, len);
+	pos += len;
+	return s;
+}
+void BinaryIndex::Reader::skip(size_t n) {
+	if (n > (size_t)(end - pos)) {
+		ok = false;
+		pos = end;
+	} else {
+		pos += n;
+	}
+}
+
+bool BinaryIndex::build(ByteSpan _input) {
+	input = _input;
+	importedFunctions = 0;
+	definedFunctions = 0;
+	codeStart = codeEnd = 0;
+	bodies.clear();
+	names.clear();
+	exportNames.clear();
+	const uint8_t* data = (const uint8_t*)input.data;
+	if (input.size < 8 || memcmp(data, "\0asm", 4) != 0) {
+		return false;
+	}
+	// Sections are collected first: exports and names refer to the whole function
+	// index space, which is only known once imports and functions have been read
+	Reader imports{nullptr, nullptr, false}, exports{nullptr, nullptr, false}, code{nullptr, nullptr, false};
+	vector<Reader> customs;
+	Reader r{data + 8, data + input.size, true};
+	while (r.ok && r.pos < r.end) {
+		size_t start = r.pos - data;
+		uint8_t id = r.byte();
+		size_t size = r.uleb();
+		if (!r.ok || size > (size_t)(r.end - r.pos)) {
+			return false;
+		}
+		Reader section{r.pos, r.pos + size, true};
+		r.skip(size);
+		if (id == ImportSection) {
+			imports = section;
+		} else if (id == FunctionSection) {
+			definedFunctions = section.uleb();
+			if (!section.ok) {
+				return false;
+			}
+		} else if (id == ExportSection) {
+			exports = section;
+		} else if (id == CodeSection) {
+			code = section;
+			codeStart = start;
+			codeEnd = r.pos - data;
+		} else if (id == CustomSection) {
+			customs.push_back(section);
+		}
+	}
+	if (!r.ok || (imports.ok && !readImports(imports))) {
+		return false;
+	}
+	// Unnamed functions are named after their index among the defined functions, as the
+	// binary parser does
+	names.resize(getFunctionCount());
+	for (size_t i = importedFunctions; i < names.size(); ++i) {
+		names[i] = to_string(i - importedFunctions);
+	}
+	exportNames.resize(getFunctionCount());
+	if ((exports.ok && !readExports(exports)) || !code.ok || !readCode(code)) {
+		return false;
+	}
+	for (auto& section : customs) {
+		if (section.str() == "name" && section.ok) {
+			readNames(section);
+		}
+	}
+	return true;
+}
+bool BinaryIndex::readImports(Reader r) {
+	size_t count = r.uleb();
+	for (size_t i = 0; i < count && r.ok; ++i) {
+		r.str(); // Module
+		r.str(); // Base
+		uint8_t kind = r.byte();
+		if (kind == 0) { // Function: type index
+			r.uleb();
+			importedFunctions++;
+		} else if (kind == 1) { // Table: element type, limits
+			r.byte();
+			if (r.uleb() & 1) {
+				r.uleb();
+			}
+			r.uleb();
+		} else if (kind == 2) { // Memory: limits
+			if (r.uleb() & 1) {
+				r.uleb();
+			}
+			r.uleb();
+		} else if (kind == 3) { // Global: value type, mutability
+			r.byte();
+			r.byte();
+		} else {
+			return false;
+		}
+	}
+	return r.ok;
+}
+bool BinaryIndex::readExports(Reader r) {
+	size_t count = r.uleb();
+	for (size_t i = 0; i < count && r.ok; ++i) {
+		string name = r.str();
+		uint8_t kind = r.byte();
+		size_t index = r.uleb();
+		if (kind == 0 && index < exportNames.size()) {
+			exportNames[index].push_back(name);
+		}
+	}
+	return r.ok;
+}
+bool BinaryIndex::readCode(Reader r) {
+	const uint8_t* data = (const uint8_t*)input.data;
+	size_t count = r.uleb();
+	if (!r.ok || count != definedFunctions) {
+		return false;
+	}
+	bodies.reserve(count);
+	for (size_t i = 0; i < count && r.ok; ++i) {
+		size_t offset = r.pos - data;
+		size_t size = r.uleb();
+		r.skip(size);
+		bodies.push_back(Body{offset, (size_t)(r.pos - data) - offset});
+	}
+	return r.ok;
+}
+void BinaryIndex::readNames(Reader r) {
+	// A malformed name section only loses names, the bodies are still usable
+	while (r.ok && r.pos < r.end) {
+		uint8_t id = r.byte();
+		size_t size = r.uleb();
+		if (!r.ok || size > (size_t)(r.end - r.pos)) {
+			return;
+		}
+		Reader sub{r.pos, r.pos + size, true};
+		r.skip(size);
+		if (id != 1) { // Function names
+			continue;
+		}
+		size_t count = sub.uleb();
+		for (size_t i = 0; i < count && sub.ok; ++i) {
+			size_t index = sub.uleb();
+			string name = sub.str();
+			if (sub.ok && index < names.size()) {
+				names[index] = name;
+			}
+		}
+	}
+}
+size_t BinaryIndex::getFunctionCount() {
+	return importedFunctions + definedFunctions;
+}
+size_t BinaryIndex::getImportedFunctionCount() {
+	return importedFunctions;
+}
+const string& BinaryIndex::getName(size_t index) {
+	return names.at(index);
+}
+const vector<string>& BinaryIndex::getExportNames(size_t index) {
+	return exportNames.at(index);
+}
+void BinaryIndex::stripBodies(const vector<bool>& keep, vector<char>& out) {
+	const char* data = input.data;
+	auto appendUleb = [&](uint64_t value) {
+		do {
+			uint8_t b = value & 0x7f;
+			value >>= 7;
+			out.push_back((char)(value ? b | 0x80 : b));
+		} while (value);
+	};
+	auto ulebSize = [](uint64_t value) {
+		size_t n = 1;
+		while (value >>= 7) {
+			n++;
+		}
+		return n;
+	};
+	// The code section is rebuilt in place; everything around it is copied unchanged
+	size_t sectionSize = ulebSize(bodies.size());
+	for (size_t i = 0; i < bodies.size(); ++i) {
+		sectionSize += keep.at(importedFunctions + i) ? bodies[i].size : sizeof(stubBody);
+	}
+	out.clear();
+	out.reserve(codeStart + 1 + ulebSize(sectionSize) + sectionSize + (input.size - codeEnd));
+	out.insert(out.end(), data, data + codeStart);
+	out.push_back((char)CodeSection);
+	appendUleb(sectionSize);
+	appendUleb(bodies.size());
+	for (size_t i = 0; i < bodies.size(); ++i) {
+		if (keep.at(importedFunctions + i)) {
+			out.insert(out.end(), data + bodies[i].offset, data + bodies[i].offset + bodies[i].size);
+		} else {
+			out.insert(out.end(), stubBody, stubBody + sizeof(stubBody));
+		}
+	}
+	out.insert(out.end(), data + codeEnd, data + input.size);
+}
@@ -0,0 +1,58 @@
+#ifndef _WASMDEC_BINARY_INDEX_H
+#define _WASMDEC_BINARY_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "../io/InputFile.h"
+using namespace std;
+
+namespace wasmdec {
+	// Locates every function body in a wasm binary without decoding any of them.
+	// Only section headers, imports, exports and the name section are read, so indexing
+	// a module costs far less than parsing it.
+	class BinaryIndex {
+	public:
+		// Fails on anything it can't make sense of; the module is then parsed in full
+		bool build(ByteSpan);
+		// Functions in the module's index space, imports first
+		size_t getFunctionCount();
+		size_t getImportedFunctionCount();
+		// Name from the name section; defined functions without one are named after their
+		// index among the defined functions, and imports are left unnamed
+		const string& getName(size_t);
+		const vector<string>& getExportNames(size_t);
+		// Copy of the indexed binary where every defined function not marked in keep has
+		// its body replaced by a lone unreachable
+		void stripBodies(const vector<bool>& keep, vector<char>& out);
+	protected:
+		struct Reader {
+			const uint8_t* pos;
+			const uint8_t* end;
+			bool ok;
+			uint8_t byte();
+			uint64_t uleb();
+			string str();
+			void skip(size_t);
+		};
+		struct Body {
+			size_t offset; // Start of the body's size prefix
+			size_t size; // Including the size prefix
+		};
+		bool readImports(Reader);
+		bool readExports(Reader);
+		bool readCode(Reader);
+		void readNames(Reader);
+
+		ByteSpan input = ByteSpan(nullptr, 0, false);
+		size_t codeStart = 0; // Start of the code section's id byte
+		size_t codeEnd = 0;
+		size_t importedFunctions = 0;
+		size_t definedFunctions = 0;
+		vector<Body> bodies;
+		vector<string> names;
+		vector<vector<string>> exportNames;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_BINARY_INDEX_H
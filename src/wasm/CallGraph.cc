@@ -0,0 +1,118 @@
+#include "CallGraph.h"
+#include "wasm-traversal.h"
+#include <algorithm>
+using namespace wasmdec;
+
+namespace {
+	// Collects the calls made by one function body
+	struct CallCollector : public PostWalker<CallCollector> {
+		vector<Name> direct;
+		vector<Name> indirect; // Signature names
+		void visitCall(Call* curr) {
+			direct.push_back(curr->target);
+		}
+		void visitCallIndirect(CallIndirect* curr) {
+			indirect.push_back(curr->fullType);
+		}
+	};
+}
+
+void CallGraph::build(Module* m) {
+	module = m;
+	nodes.clear();
+	tableEntries.clear();
+	indices.clear();
+	indices.reserve(m->functions.size());
+	for (size_t i = 0; i < m->functions.size(); ++i) {
+		indices[m->functions[i]->name.str] = i;
+	}
+	nodes.resize(m->functions.size());
+	for (size_t i = 0; i < m->functions.size(); ++i) {
+		Function* fn = m->functions[i].get();
+		if (fn->imported()) {
+			continue;
+		}
+		CallCollector calls;
+		calls.walk(fn->body);
+		for (auto& target : calls.direct) {
+			size_t callee = getIndex(target);
+			if (callee < nodes.size()) {
+				nodes[i].callees.push_back(callee);
+			}
+		}
+		for (auto& typeName : calls.indirect) {
+			// An unknown signature is kept as null, which matches every table entry
+			nodes[i].indirectTypes.push_back(m->getFunctionTypeOrNull(typeName));
+		}
+	}
+	if (m->table.exists) {
+		for (auto& seg : m->table.segments) {
+			for (auto& name : seg.data) {
+				size_t entry = getIndex(name);
+				if (entry < nodes.size()) {
+					tableEntries.push_back(entry);
+				}
+			}
+		}
+	}
+	tableIsExternal = m->table.exists && m->table.imported();
+	for (auto& expt : m->exports) {
+		if (expt->kind == ExternalKind::Table) {
+			tableIsExternal = true;
+		}
+	}
+}
+size_t CallGraph::getIndex(Name name) {
+	auto found = indices.find(name.str);
+	return found == indices.end() ? nodes.size() : found->second;
+}
+bool CallGraph::matchesSignature(size_t index, FunctionType* type) {
+	if (!type) {
+		return true;
+	}
+	Function* fn = module->functions[index].get();
+	return fn->result == type->result && fn->params == type->params;
+}
+vector<bool> CallGraph::reachableFrom(const vector<size_t>& roots) {
+	vector<bool> reached(nodes.size(), false);
+	vector<size_t> pending;
+	auto reach = [&](size_t index) {
+		if (index < reached.size() && !reached[index]) {
+			reached[index] = true;
+			pending.push_back(index);
+		}
+	};
+	for (size_t root : roots) {
+		reach(root);
+	}
+	if (module && module->start.is()) {
+		reach(getIndex(module->start));
+	}
+	if (tableIsExternal) {
+		for (size_t entry : tableEntries) {
+			reach(entry);
+		}
+	}
+	// Signatures of indirect calls seen so far; each table entry is checked against a
+	// signature once, when it is first seen
+	vector<FunctionType*> indirectTypes;
+	while (pending.size()) {
+		size_t index = pending.back();
+		pending.pop_back();
+		for (size_t callee : nodes[index].callees) {
+			reach(callee);
+		}
+		for (FunctionType* type : nodes[index].indirectTypes) {
+			if (find(indirectTypes.begin(), indirectTypes.end(), type) != indirectTypes.end()) {
+				continue;
+			}
+			indirectTypes.push_back(type);
+			for (size_t entry : tableEntries) {
+				if (matchesSignature(entry, type)) {
+					reach(entry);
+				}
+			}
+		}
+	}
+	return reached;
+}
@@ -0,0 +1,36 @@
+#ifndef _WASMDEC_CALL_GRAPH_H
+#define _WASMDEC_CALL_GRAPH_H
+
+#include <vector>
+#include <unordered_map>
+#include "wasm.h"
+using namespace std;
+using namespace wasm;
+
+namespace wasmdec {
+	// Direct and indirect call edges between a module's functions, by function index.
+	// An indirect call can reach any function in the table with the same signature.
+	class CallGraph {
+	public:
+		void build(Module*);
+		size_t getIndex(Name); // Index of a function, or the function count if there is none
+		// Functions reachable from the roots. The start function is always a root, and so
+		// is every table entry when the table is imported or exported, since the host can
+		// call through it.
+		vector<bool> reachableFrom(const vector<size_t>& roots);
+	protected:
+		struct Node {
+			vector<size_t> callees;
+			vector<FunctionType*> indirectTypes; // Signatures of this function's indirect calls
+		};
+		bool matchesSignature(size_t, FunctionType*);
+
+		Module* module = nullptr;
+		vector<Node> nodes;
+		vector<size_t> tableEntries;
+		bool tableIsExternal = false;
+		unordered_map<const char*, size_t> indices; // Names are interned, so keyed by pointer
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_CALL_GRAPH_H
@@ -0,0 +1,127 @@
+#include "SymbolIndex.h"
+#include "../convert/Conversion.h"
+#include "../native/Native.h"
+#include <unordered_set>
+using namespace wasmdec;
+
+void SymbolIndex::build(Module* m) {
+	functions.clear();
+	functionTypes.clear();
+	globals.clear();
+	exports.clear();
+	nativeGlobals.clear();
+	signatureIds.clear();
+	hasNativeNames = false;
+	functions.reserve(m->functions.size());
+	for (auto& fn : m->functions) {
+		functions[fn->name] = FunctionSymbol{fn.get(), Convert::getFName(fn->name)};
+	}
+	functionTypes.reserve(m->functionTypes.size());
+	for (auto& typ : m->functionTypes) {
+		functionTypes[typ->name] = typ.get();
+	}
+	globals.reserve(m->globals.size());
+	for (auto& glb : m->globals) {
+		globals[glb->name] = glb.get();
+	}
+	exports.reserve(m->exports.size());
+	for (auto& expt : m->exports) {
+		exports[expt->name] = expt.get();
+	}
+}
+Function* SymbolIndex::getFunction(Name name) {
+	auto it = functions.find(name);
+	return it == functions.end() ? nullptr : it->second.function;
+}
+FunctionType* SymbolIndex::getFunctionType(Name name) {
+	auto it = functionTypes.find(name);
+	return it == functionTypes.end() ? nullptr : it->second;
+}
+Global* SymbolIndex::getGlobal(Name name) {
+	auto it = globals.find(name);
+	return it == globals.end() ? nullptr : it->second;
+}
+Export* SymbolIndex::getExport(Name name) {
+	auto it = exports.find(name);
+	return it == exports.end() ? nullptr : it->second;
+}
+void SymbolIndex::getFName(Name name, string& out) {
+	auto it = functions.find(name);
+	if (it != functions.end()) {
+		out += it->second.cName;
+	} else {
+		// Not a function of this module (e.g. an export of another kind)
+		Convert::getFName(name, out);
+	}
+}
+namespace {
+	string signatureKey(Type result, const vector<Type>& params) {
+		string key(1, '0' + (int)result);
+		for (Type param : params) {
+			key += '0' + (int)param;
+		}
+		return key;
+	}
+	string nativeName(Importable* item, const char* prefix, Name name, unordered_set<string>& taken) {
+		string base;
+		if (item->imported()) {
+			native::identifier(item->module.str, base);
+			base += "_";
+			native::identifier(item->base.str, base);
+			if (base[0] == '_' || native::isKeyword(base)) {
+				base = "import" + base;
+			}
+		} else {
+			base = prefix;
+			native::identifier(name.str, base);
+		}
+		string unique = base;
+		for (size_t n = 1; !taken.insert(unique).second; ++n) {
+			unique = base + "_" + to_string(n);
+		}
+		return unique;
+	}
+}
+void SymbolIndex::buildNativeNames(Module* m) {
+	if (hasNativeNames) {
+		return;
+	}
+	unordered_set<string> taken;
+	for (auto& fn : m->functions) {
+		functions[fn->name].nativeName = nativeName(fn.get(), "f_", fn->name, taken);
+	}
+	nativeGlobals.reserve(m->globals.size());
+	for (auto& glb : m->globals) {
+		nativeGlobals[glb->name] = nativeName(glb.get(), "g_", glb->name, taken);
+	}
+	// Ids start at 1, so that they never match an empty table entry
+	for (auto& typ : m->functionTypes) {
+		signatureIds.emplace(signatureKey(typ->result, typ->params), signatureIds.size() + 1);
+	}
+	for (auto& fn : m->functions) {
+		signatureIds.emplace(signatureKey(fn->result, fn->params), signatureIds.size() + 1);
+	}
+	hasNativeNames = true;
+}
+void SymbolIndex::getNativeName(Name name, string& out) {
+	auto it = functions.find(name);
+	if (it != functions.end()) {
+		out += it->second.nativeName;
+	} else {
+		out += "f_";
+		native::identifier(name.str, out);
+	}
+}
+uint32_t SymbolIndex::getSignatureId(Type result, const vector<Type>& params) {
+	auto it = signatureIds.find(signatureKey(result, params));
+	return it == signatureIds.end() ? 0 : it->second;
+}
+void SymbolIndex::getNativeGlobal(Name name, string& out) {
+	auto it = nativeGlobals.find(name);
+	if (it != nativeGlobals.end()) {
+		out += it->second;
+	} else {
+		out += "g_";
+		native::identifier(name.str, out);
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef _WASMDEC_SYMBOL_INDEX_H
+#define _WASMDEC_SYMBOL_INDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "wasm.h"
+using namespace std;
+using namespace wasm;
+
+namespace wasmdec {
+	// Hash lookups from names to a module's functions, function types, globals and
+	// exports, plus the C identifier of every function.
+	// Built once after parsing; read only (and safe to share between threads) after that.
+	class SymbolIndex {
+	public:
+		void build(Module*);
+		Function* getFunction(Name);
+		FunctionType* getFunctionType(Name);
+		Global* getGlobal(Name);
+		Export* getExport(Name);
+		// C identifier of the function with the given name, as Convert::getFName would produce
+		void getFName(Name, string&);
+		// Names of functions and globals in compilable output, which are valid and
+		// distinct C identifiers: "f_" and "g_" and the sanitized wasm name for those
+		// defined in the module, module_base for imports
+		void buildNativeNames(Module*);
+		void getNativeName(Name, string&);
+		void getNativeGlobal(Name, string&);
+		// Number of a signature in compilable output, the same for every function and
+		// function type with equal parameter and result types, as call_indirect compares
+		// them. Defined for the signatures of the module once native names are built.
+		uint32_t getSignatureId(Type result, const vector<Type>& params);
+	protected:
+		// Names are interned, so they are hashed and compared by pointer
+		struct NameHash {
+			size_t operator()(const Name& name) const {
+				return hash<const char*>()(name.str);
+			}
+		};
+		struct FunctionSymbol {
+			Function* function;
+			string cName;
+			string nativeName;
+		};
+		unordered_map<Name, FunctionSymbol, NameHash> functions;
+		unordered_map<Name, FunctionType*, NameHash> functionTypes;
+		unordered_map<Name, Global*, NameHash> globals;
+		unordered_map<Name, Export*, NameHash> exports;
+		unordered_map<Name, string, NameHash> nativeGlobals;
+		unordered_map<string, uint32_t> signatureIds; // Keyed by the letters of the types
+		bool hasNativeNames = false;
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_SYMBOL_INDEX_H
@@ -3,9 +3,14 @@ using namespace wasmdec;
 
 Context::Context(Function* _fn, Module* _md, DecompilerCtx* _dctx) {
 	isGlobal = false;
+	isIfCondition = false;
 	fn = _fn;
 	mod = _md;
 	depth = 0;
+	lastSetLocal = 0;
+	lastExpr = nullptr;
+	functionLevelExpression = false;
+	native = nullptr;
 	if (_dctx) {
 		hasDecompilerCtx = true;
 		dctx = _dctx;
@@ -16,6 +21,14 @@ Context::Context(Function* _fn, Module* _md, DecompilerCtx* _dctx) {
 }
 Context::Context(Module* _md) {
 	isGlobal = true;
+	isIfCondition = false;
 	fn = nullptr; // No function context in global
 	mod = _md;
+	depth = 0;
+	lastSetLocal = 0;
+	hasDecompilerCtx = false;
+	dctx = nullptr;
+	lastExpr = nullptr;
+	functionLevelExpression = false;
+	native = nullptr;
 }
\ No newline at end of file
@@ -1,12 +1,17 @@
 #ifndef _WASM_CONTEXT_H
 #define _WASM_CONTEXT_H
 
+#include <vector>
+#include <unordered_set>
 #include "wasm.h"
 using namespace wasm;
 
 #include "../decompiler/DecompilerCtx.h"
 
 namespace wasmdec {
+	namespace native {
+		struct FunctionState;
+	}
 	// Context is a union between WASM functions and modules
 	class Context {
 	public:
@@ -25,6 +30,12 @@ namespace wasmdec {
 		Expression* lastExpr;
 		// Whether or not the expression is exactly one layer below a function
 		bool functionLevelExpression;
+		// State of the compilable backend, null when writing pseudo C
+		native::FunctionState* native;
+		// Blocks and loops enclosing the pseudo C being written, innermost last
+		vector<Expression*> scopes;
+		// Labels some goto of the pseudo C refers to
+		unordered_set<const char*> gotoLabels;
 	};
 } // namespace wasmdec
 
@@ -1,24 +1,45 @@
 #include "WasmUtils.h"
+#include "wasm-traversal.h"
+#include <cerrno>
+#include <sys/stat.h>
 using namespace wasmdec;
 
-FunctionType* util::resolveFType(Module* m, Name nm) {
-	for (unsigned int i = 0; i < m->functionTypes.size(); ++i) {
-		if (m->functionTypes[i]->name == nm) {
-			return m->functionTypes[i].get();
+namespace {
+	// Counts every node in an expression tree
+	struct ExpressionCounter : public PostWalker<ExpressionCounter, UnifiedExpressionVisitor<ExpressionCounter>> {
+		size_t count = 0;
+		void visitExpression(Expression* curr) {
+			count++;
 		}
-	}
-	return nullptr;
+	};
+	// Finds the deepest nesting of an expression tree, with tasks around every node
+	// that track the current depth
+	struct DepthMeasurer : public PostWalker<DepthMeasurer, UnifiedExpressionVisitor<DepthMeasurer>> {
+		size_t depth = 0;
+		size_t maxDepth = 0;
+		static void doEnter(DepthMeasurer* self, Expression** currp) {
+			if (++self->depth > self->maxDepth) {
+				self->maxDepth = self->depth;
+			}
+		}
+		static void doLeave(DepthMeasurer* self, Expression** currp) {
+			self->depth--;
+		}
+		static void scan(DepthMeasurer* self, Expression** currp) {
+			self->pushTask(doLeave, currp);
+			PostWalker<DepthMeasurer, UnifiedExpressionVisitor<DepthMeasurer>>::scan(self, currp);
+			self->pushTask(doEnter, currp);
+		}
+		void visitExpression(Expression* curr) { }
+	};
 }
-string util::tab(int tabTimes) {
+
+void util::tab(int tabTimes, string& out) {
 	// Util for generating nicer looking C
-	string ret;
 	if (tabTimes < 1) {
 		tabTimes = 1;
 	}
-	for (int i = 0; i < tabTimes; ++i) {
-		ret += "\t";
-	}
-	return ret;
+	out.append(tabTimes, '\t');
 }
 string util::getLiteralValue(Literal* val) {
 	int32_t conv_i32;
@@ -63,4 +84,30 @@ string util::getAddrStr(Address* addr) {
 string util::boolStr(bool b) {
 	if (b) return "true";
 	else return "false";
+}
+size_t util::countExpressions(Expression* ex) {
+	ExpressionCounter counter;
+	counter.walk(ex);
+	return counter.count;
+}
+size_t util::maxDepth(Expression* ex) {
+	if (!ex) {
+		return 0;
+	}
+	DepthMeasurer measurer;
+	measurer.walk(ex);
+	return measurer.maxDepth;
+}
+bool util::makeDirectories(const string& path) {
+	// Creates every missing directory along the path
+	for (size_t i = 1; i <= path.size(); ++i) {
+		if (i == path.size() || path[i] == '/') {
+			string prefix = path.substr(0, i);
+			if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+				return false;
+			}
+		}
+	}
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
 }
\ No newline at end of file
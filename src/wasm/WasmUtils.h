@@ -8,12 +8,14 @@ using namespace std;
 namespace wasmdec {
 	class util {
 	public:
-		static FunctionType* resolveFType(Module*, Name);
-		static string tab(int);
+		static void tab(int, string&);
 		static string getLiteralValue(Literal*);
 		static int getLocalIndex(Function*, int);
 		static string getAddrStr(Address*);
 		static string boolStr(bool);
+		static size_t countExpressions(Expression*);
+		static size_t maxDepth(Expression*);
+		static bool makeDirectories(const string&);
 		template<typename T>
 		static string getHex(T val);
 	};
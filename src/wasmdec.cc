@@ -6,32 +6,46 @@
 #include <string>
 #include <iostream>
 #include <iterator>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "cxxopts.hpp"
 #include "decompiler/MultiDecompiler.h"
+#include "decompiler/BatchDecompiler.h"
+#include "stats/Allocations.h"
+#include "server/Server.h"
 
 // Global variables to be passed to the decompiler
 bool debugging = false,
 		extra = false,
-		memdump = false;
+		memdump = false,
+		printStats = false,
+		profiling = false,
+		compilable = false, // Emit C that compiles, see src/native
+		fastTraps = false; // Leave out trap checks of compilable output
+std::string statsJson; // File to write statistics to as JSON
+wasmdec::stats::PhaseTime readTime = {0, 0, 0}; // Time taken to open the input
+size_t profileTop = 10; // Slowest functions to list when profiling
+std::string profileCsv; // File to write every function's profile to
+std::string traceFile; // File to write a Chrome trace of the run to
+int jobs = 1; // Number of threads to decompile functions with
+std::string cacheDir; // Function cache directory, empty when caching is off
+size_t cacheSize = 256; // Function cache size cap in MiB
+std::string serveSocket, connectSocket; // Unix sockets of the decompilation server
+size_t serveModules = 16; // Parsed modules kept by the server
+std::string batchInput; // Directory or list file of modules to decompile in batch mode
+std::string trapMode = "strict"; // Trap semantics of compilable output, strict or fast
+int batchJobs = 0; // Modules decompiled at once in batch mode, 0 = one per core
+size_t memoryBudget = 0; // Memory shared by the modules of a batch in MiB, 0 = half of RAM
+std::vector<std::string> onlyFunctions, excludedFunctions; // Function filters, see FunctionFilter
+bool reachableFromExports = false;
+std::vector<std::string> rootFunctions; // Extra roots of the reachability search
 std::string infile, outfile;
 std::vector<std::string> infiles; // will be empty if there's only one file to decompile
 DisasmMode dmode;
 
 // Helper functions
-bool readFile(vector<char>* data, string path) {
-	ifstream file(path);
-	if (!file.eof() && !file.fail()) {
-	    file.seekg(0, ios_base::end);
-	    streampos fileSize = file.tellg();
-	    data->resize(fileSize);
-	    file.seekg(0, ios_base::beg);
-	    file.read(&(data->operator[](0)), fileSize);
-		return true;
-	} else {
-		return false;
-	}
-}
 bool writeFile(string path, string data) {
 	ofstream file(path);
 	if (!file.eof() && !file.fail()) {
@@ -83,16 +97,31 @@ void setOutfile(string _outf) {
 void setInfile(string _inf) {
 	infile = _inf;
 }
+// Decompiler configuration from the command line options
+DisasmConfig getConfig(DisasmMode mode) {
+	DisasmConfig conf(debugging, extra, mode);
+	conf.jobs = jobs;
+	conf.cacheDir = cacheDir;
+	conf.cacheSize = cacheSize << 20;
+	conf.only = onlyFunctions;
+	conf.exclude = excludedFunctions;
+	conf.reachableFromExports = reachableFromExports;
+	conf.roots = rootFunctions;
+	conf.compilable = compilable;
+	conf.fastTraps = fastTraps;
+	return conf;
+}
 int performMemdump() {
 	// Initialize a decompiler for memory dumping
 	dmode = getDisasmMode(infile);
 	DisasmConfig conf(debugging, extra, dmode);
-	std::vector<char>* input = new std::vector<char>();
-	if (!readFile(input, infile)) {
+	InputFile input;
+	if (!input.open(infile)) {
 		std::cout << "ERROR: failed to read the input file!" << std::endl;
 		return 1;
 	}
-	Decompiler decompiler(conf, input);
+	Decompiler decompiler(conf, input.span());
+	input.close();
 
 	// Dump the memory and table
 	std::vector<char> mem = decompiler.dumpMemory();
@@ -111,20 +140,64 @@ int performMemdump() {
 	return 0;
 }
 int decompile(Decompiler* decompiler) {
+	if (decompiler->failed()) {
+		std::cout << "ERROR: failed to decompile the binary." << std::endl;
+		return 1;
+	}
+	// Stream the output to disk as functions are finished instead of holding all of it
+	if (!decompiler->setOutputFile(outfile)) {
+		std::cout << "ERROR: failed to write the output file." << std::endl;
+		return 1;
+	}
+	size_t allocationsBefore = wasmdec::stats::allocationCount();
 	decompiler->decompile();
+	if (debugging && wasmdec::stats::countsAllocations()) {
+		std::cerr << "wasmdec: " << (wasmdec::stats::allocationCount() - allocationsBefore)
+			<< " heap allocations during code generation" << std::endl;
+	}
 	if (decompiler->failed()) {
+		decompiler->finishOutput();
 		std::cout << "ERROR: failed to decompile the binary." << std::endl;
 		return 1;
 	}
-	string decompiledCode = decompiler->getEmittedCode();
-	if (!writeFile(outfile, decompiledCode)) {
+	if (!decompiler->finishOutput()) {
 		std::cout << "ERROR: failed to write the output file." << std::endl;
 		return 1;
 	}
+	if (printStats || statsJson.size()) {
+		wasmdec::stats::RunStats& runStats = decompiler->getStats();
+		runStats.add("read", readTime);
+		if (printStats) {
+			std::cout << runStats.text();
+		}
+		if (statsJson.size() && !writeFile(statsJson, runStats.json() + "\n")) {
+			std::cout << "ERROR: failed to write the statistics file." << std::endl;
+			return 1;
+		}
+	}
+	if (traceFile.size() && !wasmdec::stats::Trace::write(traceFile)) {
+		std::cout << "ERROR: failed to write the trace file." << std::endl;
+		return 1;
+	}
+	if (profiling) {
+		wasmdec::stats::FunctionProfiler& profiler = decompiler->getProfiler();
+		if (profileTop) {
+			std::cout << profiler.slowest(profileTop);
+		}
+		if (profileCsv.size() && !profiler.writeCsv(profileCsv)) {
+			std::cout << "ERROR: failed to write the profile file." << std::endl;
+			return 1;
+		}
+	}
 	return 0;
 }
 int multiDecompile(void) {
-	DisasmConfig conf(debugging, extra, DisasmMode::Wasm);
+	if (compilable) {
+		// Every module has its own memory, table and wasm_init()
+		std::cout << "ERROR: --compilable takes one input file at a time." << std::endl;
+		return 1;
+	}
+	DisasmConfig conf = getConfig(DisasmMode::Wasm);
 	MultiDecompiler m(infiles, conf);
 	if (m.failed) {
 		std::cout << "ERROR: MultiDecompiler failed to decompile input." << std::endl;
@@ -137,6 +210,58 @@ int multiDecompile(void) {
 	}
 	return 0;
 }
+int batchDecompile(void) {
+	DisasmConfig conf = getConfig(DisasmMode::Wasm);
+	if (batchJobs < 1) {
+		batchJobs = (int)std::thread::hardware_concurrency();
+	}
+	size_t budget = memoryBudget << 20;
+	if (!budget) {
+		long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGE_SIZE);
+		if (pages > 0 && pageSize > 0) {
+			budget = (size_t)pages * (size_t)pageSize / 2;
+		}
+	}
+	BatchDecompiler batch(conf, batchJobs, budget);
+	struct stat st;
+	if (stat(batchInput.c_str(), &st) != 0) {
+		std::cout << "ERROR: failed to read '" << batchInput << "'" << std::endl;
+		return 1;
+	}
+	bool ok = S_ISDIR(st.st_mode) ? batch.addDirectory(batchInput, outfile) : batch.addList(batchInput, outfile);
+	if (!ok) {
+		std::cout << "ERROR: no readable modules to decompile in '" << batchInput << "'" << std::endl;
+		return 1;
+	}
+	batch.run();
+	std::cout << "Batch: " << batch.getSucceeded() << " decompiled, "
+		<< batch.getFailed() << " failed" << std::endl;
+	if (traceFile.size() && !wasmdec::stats::Trace::write(traceFile)) {
+		std::cout << "ERROR: failed to write the trace file." << std::endl;
+		return 1;
+	}
+	return batch.getFailed() || batch.getSucceeded() < batch.getJobCount() ? 1 : 0;
+}
+int serve(void) {
+	Server server(serveSocket, serveModules);
+	if (!server.listen()) {
+		std::cout << "ERROR: failed to start the server." << std::endl;
+		return 1;
+	}
+	std::cerr << "wasmdec: serving on " << serveSocket << std::endl;
+	server.run();
+	server.close();
+	return 0;
+}
+int clientDecompile(bool upload) {
+	DisasmConfig conf = getConfig(getDisasmMode(infile));
+	Client client(connectSocket);
+	if (!client.decompile(conf, infile, upload, outfile)) {
+		std::cout << "ERROR: " << client.getError() << std::endl;
+		return 1;
+	}
+	return 0;
+}
 int main(int argc, char* argv[]) {
 	// Set up options
 	cxxopts::Options opt("wasmdec", "WebAssembly to C decompiler");
@@ -145,7 +270,28 @@ int main(int argc, char* argv[]) {
 		("d,debug", "Enable debug output")
 		("m,memdump", "Dump memory instead of decompiling")
 		("e,extra", "Output extra information to decompiled binary")
+		("j,jobs", "Number of threads to decompile functions with (0 = one per core)", cxxopts::value<int>(jobs))
 		("o,output", "Output C file", cxxopts::value<string>(outfile))
+		("cache", "Reuse decompiled functions from this cache directory", cxxopts::value<string>(cacheDir))
+		("cache-size", "Size limit of the function cache in MiB (default 256)", cxxopts::value<size_t>(cacheSize))
+		("stats", "Print phase timings, throughput and memory use after decompiling")
+		("stats-json", "Write the statistics to this file as JSON", cxxopts::value<string>(statsJson))
+		("profile", "Time every function and list this many of the slowest (default 10)", cxxopts::value<size_t>(profileTop))
+		("profile-csv", "Write the profile of every function to this CSV file", cxxopts::value<string>(profileCsv))
+		("trace", "Write a Chrome trace event file of the run, viewable in chrome://tracing or Perfetto", cxxopts::value<string>(traceFile))
+		("serve", "Run as a server listening on this Unix socket", cxxopts::value<string>(serveSocket))
+		("serve-modules", "Number of parsed modules the server keeps (default 16)", cxxopts::value<size_t>(serveModules))
+		("connect", "Decompile through the server listening on this Unix socket", cxxopts::value<string>(connectSocket))
+		("upload", "Send the input's contents to the server instead of its path")
+		("batch", "Decompile every module in a directory, or listed in a file, into the output directory", cxxopts::value<string>(batchInput))
+		("batch-jobs", "Number of modules to decompile at once in batch mode (0 = one per core)", cxxopts::value<int>(batchJobs))
+		("memory-budget", "Memory shared by the modules of a batch in MiB (default half of RAM)", cxxopts::value<size_t>(memoryBudget))
+		("only", "Only decompile the bodies of functions matching this name, index or regex", cxxopts::value<std::vector<std::string>>())
+		("exclude", "Don't decompile the bodies of functions matching this name, index or regex", cxxopts::value<std::vector<std::string>>())
+		("reachable-from-exports", "Only emit functions that the exports can reach through calls or the table")
+		("root", "Also emit functions reachable from functions matching this name, index or regex", cxxopts::value<std::vector<std::string>>())
+		("compilable", "Emit C that compiles and runs natively: exact wasm semantics, linear memory and a runtime")
+		("traps", "Trap semantics of compilable output: strict checks every operation that traps, fast uses raw C operators (default strict)", cxxopts::value<string>(trapMode))
 		("positional", "Input file", cxxopts::value<std::vector<std::string>>())
 		("h,help", "Print usage")
 		;
@@ -164,7 +310,7 @@ int main(int argc, char* argv[]) {
 	}
 	// Set default output file if there is none
 	if (!res.count("o")) {
-		outfile = "out.c";
+		outfile = res.count("batch") ? "wasmdec_out" : "out.c";
 	}
 	// Parse decompiler flags
 	if (res.count("d")) {
@@ -177,6 +323,57 @@ int main(int argc, char* argv[]) {
 	if (res.count("e")) {
 		enableExtra();
 	}
+	if (res.count("stats")) {
+		printStats = true;
+	}
+	if (res.count("only")) {
+		onlyFunctions = res["only"].as<std::vector<std::string>>();
+	}
+	if (res.count("exclude")) {
+		excludedFunctions = res["exclude"].as<std::vector<std::string>>();
+	}
+	if (traceFile.size()) {
+		wasmdec::stats::Trace::enable();
+	}
+	if (res.count("profile") || res.count("profile-csv")) {
+		profiling = true;
+		if (!res.count("profile")) {
+			profileTop = 0;
+		}
+	}
+	if (res.count("reachable-from-exports")) {
+		reachableFromExports = true;
+	}
+	if (res.count("root")) {
+		rootFunctions = res["root"].as<std::vector<std::string>>();
+	}
+	if (res.count("compilable")) {
+		compilable = true;
+	}
+	if (res.count("traps") && !compilable) {
+		std::cout << "ERROR: --traps only applies to --compilable output." << std::endl;
+		return 1;
+	}
+	if (trapMode == "fast") {
+		fastTraps = true;
+	} else if (trapMode != "strict") {
+		std::cout << "ERROR: --traps must be strict or fast." << std::endl;
+		return 1;
+	}
+	if (jobs < 1) {
+		jobs = (int)std::thread::hardware_concurrency();
+		if (jobs < 1) {
+			jobs = 1;
+		}
+	}
+	if (res.count("serve")) {
+		// The server takes its inputs and options from each request
+		return serve();
+	}
+	if (res.count("batch")) {
+		// Inputs come from the directory or list, -o names the output directory
+		return batchDecompile();
+	}
 	// Parse input file(s)
 	if (res.count("positional")) {
 		std::vector<std::string> _infiles;
@@ -199,6 +396,13 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
+	if (res.count("connect")) {
+		if (!infile.size() || memdump) {
+			std::cout << "ERROR: --connect takes exactly one input file." << std::endl;
+			return 1;
+		}
+		return clientDecompile(res.count("upload") > 0);
+	}
 	if (!memdump) {
 		if (!infile.size()) {
 			return multiDecompile();
@@ -207,15 +411,20 @@ int main(int argc, char* argv[]) {
 
 			// Configure the decompiler
 			dmode = getDisasmMode(infile);
-			DisasmConfig conf(debugging, extra, dmode);
-			std::vector<char>* input = new std::vector<char>();
-			if (!readFile(input, infile)) {
+			DisasmConfig conf = getConfig(dmode);
+			conf.profile = profiling;
+			wasmdec::stats::PhaseTimer readTimer("read");
+			InputFile input;
+			if (!input.open(infile)) {
 				std::cout << "ERROR: failed to read the input file!" << std::endl;
 				return 1;
 			}
+			readTime = readTimer.elapsed();
 
 			// Now that everything is parsed, initialize the decompiler
-			Decompiler decompiler(conf, input);
+			Decompiler decompiler(conf, input.span());
+			// The module holds everything it needs, the input can be unmapped
+			input.close();
 			return decompile(&decompiler);
 		}
 	} else {
@@ -0,0 +1,236 @@
+// End to end benchmark of the Decompiler API.
+// Every input is decompiled to /dev/null after some warmup runs, then timed over a
+// number of repetitions. Inputs are the files given on the command line plus generated
+// modules, which stand in for large real world binaries.
+//
+// Usage: bench [--reps N] [--warmup N] [--jobs N] [--json FILE] [--baseline FILE]
+//              [--threshold PERCENT] [--no-synthetic] [input files...]
+// With --baseline, exits with status 1 when any input's median time is more than
+// the threshold (default 10%) slower than in the baseline JSON.
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "../../src/decompiler/Decompiler.h"
+#include "../../tools/wasmgen/ModuleGenerator.h"
+using namespace std;
+using namespace wasm;
+using namespace wasmdec;
+
+// A file, or a generated module when generated is set
+struct Input {
+	string name;
+	DisasmMode mode;
+	bool generated;
+	GeneratorOptions shape;
+};
+struct Result {
+	string name;
+	size_t bytes;
+	size_t functions;
+	double median;
+	double p95;
+	size_t peakRss;
+	bool failed;
+};
+
+static vector<char> readFile(const string& path) {
+	ifstream file(path, ios::binary);
+	return vector<char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+// Resets the peak resident set size where the kernel allows it, so each input's peak
+// is measured on its own
+static void resetPeakRss() {
+	int fd = open("/proc/self/clear_refs", O_WRONLY);
+	if (fd >= 0) {
+		if (write(fd, "5", 1) != 1) { }
+		close(fd);
+	}
+}
+static size_t peakRss() {
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return stoul(line.substr(6)) * 1024;
+		}
+	}
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (size_t)usage.ru_maxrss * 1024;
+}
+
+static Result run(const Input& input, int warmup, int reps, int jobs) {
+	// Inputs are loaded one at a time, and freed memory is returned first, so the
+	// peak only covers decompiling this input
+	vector<char> bytes = input.generated ? ModuleGenerator(input.shape).generateBinary() : readFile(input.name);
+	malloc_trim(0);
+	resetPeakRss();
+	Result result{input.name, bytes.size(), 0, 0, 0, 0, false};
+	DisasmConfig conf(false, false, input.mode);
+	conf.jobs = jobs;
+	vector<double> times;
+	for (int r = 0; r < warmup + reps; ++r) {
+		auto start = chrono::steady_clock::now();
+		Decompiler decompiler(conf, ByteSpan(bytes));
+		if (decompiler.failed()) {
+			result.failed = true;
+			return result;
+		}
+		decompiler.setOutputFd(open("/dev/null", O_WRONLY));
+		decompiler.decompile();
+		decompiler.finishOutput();
+		double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if (r >= warmup) {
+			times.push_back(t);
+		}
+		result.functions = decompiler.getStats().functions;
+	}
+	sort(times.begin(), times.end());
+	result.median = times.size() % 2 ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+	result.p95 = times[(size_t)ceil(times.size() * 0.95) - 1];
+	result.peakRss = peakRss();
+	return result;
+}
+
+static string jsonString(const string& s) {
+	string out = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+		}
+		out += c;
+	}
+	return out + "\"";
+}
+static string toJson(const vector<Result>& results, int warmup, int reps, int jobs) {
+	stringstream out;
+	out << setprecision(9);
+	out << "{\"warmup\":" << warmup << ",\"reps\":" << reps << ",\"jobs\":" << jobs << ",\"inputs\":[";
+	bool first = true;
+	for (auto& r : results) {
+		if (r.failed) {
+			continue;
+		}
+		out << (first ? "" : ",") << "\n{\"name\":" << jsonString(r.name) << ",\"bytes\":" << r.bytes
+			<< ",\"functions\":" << r.functions << ",\"medianSeconds\":" << r.median
+			<< ",\"p95Seconds\":" << r.p95 << ",\"functionsPerSecond\":" << r.functions / r.median
+			<< ",\"peakRssBytes\":" << r.peakRss << "}";
+		first = false;
+	}
+	out << "\n]}\n";
+	return out.str();
+}
+// Median time of an input in a JSON document written by toJson, or 0 if it isn't there
+static double baselineMedian(const string& json, const string& name) {
+	size_t at = json.find("{\"name\":" + jsonString(name) + ",");
+	if (at == string::npos) {
+		return 0;
+	}
+	size_t median = json.find("\"medianSeconds\":", at);
+	size_t end = json.find('}', at);
+	if (median == string::npos || median > end) {
+		return 0;
+	}
+	return stod(json.substr(median + 16));
+}
+
+int main(int argc, char** argv) {
+	int reps = 10, warmup = 2, jobs = 1;
+	double threshold = 10;
+	bool synthetic = true;
+	string jsonPath, baselinePath;
+	vector<Input> inputs;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--reps" && hasValue) {
+			reps = max(1, stoi(argv[++i]));
+		} else if (arg == "--warmup" && hasValue) {
+			warmup = max(0, stoi(argv[++i]));
+		} else if (arg == "--jobs" && hasValue) {
+			jobs = max(1, stoi(argv[++i]));
+		} else if (arg == "--json" && hasValue) {
+			jsonPath = argv[++i];
+		} else if (arg == "--baseline" && hasValue) {
+			baselinePath = argv[++i];
+		} else if (arg == "--threshold" && hasValue) {
+			threshold = stod(argv[++i]);
+		} else if (arg == "--no-synthetic") {
+			synthetic = false;
+		} else {
+			inputs.push_back(Input{arg, getDisasmModeForFile(arg), false, GeneratorOptions()});
+		}
+	}
+	if (synthetic) {
+		// Many small functions, like compiled C, then a few huge ones, then deep nesting
+		auto generated = [&](string name, size_t functions, size_t statements, size_t depth) {
+			GeneratorOptions shape;
+			shape.functions = functions;
+			shape.statements = statements;
+			shape.depth = depth;
+			shape.brTableWidth = 8;
+			shape.dataSize = 64 * 1024;
+			inputs.push_back(Input{"synthetic:" + name, DisasmMode::Wasm, true, shape});
+		};
+		generated("1k-functions", 1000, 40, 4);
+		generated("20k-functions", 20000, 40, 4);
+		generated("large-functions", 50, 4000, 4);
+		generated("depth-100", 200, 10, 100);
+		generated("depth-1k", 50, 10, 1000);
+	}
+
+	cout << "Median and p95 of " << reps << " runs after " << warmup << " warmup runs, " << jobs << " thread(s)" << endl;
+	cout << left << setw(40) << "Input" << right << setw(10) << "Functions" << setw(12) << "Median ms"
+		<< setw(12) << "p95 ms" << setw(14) << "Functions/s" << setw(12) << "Peak MiB" << endl;
+	vector<Result> results;
+	for (auto& input : inputs) {
+		Result r = run(input, warmup, reps, jobs);
+		results.push_back(r);
+		cout << left << setw(40) << r.name << right;
+		if (r.failed) {
+			cout << "  skipped, failed to parse" << endl;
+			continue;
+		}
+		cout << setw(10) << r.functions << fixed << setprecision(3) << setw(12) << r.median * 1e3
+			<< setw(12) << r.p95 * 1e3 << setprecision(0) << setw(14) << r.functions / r.median
+			<< setprecision(1) << setw(12) << r.peakRss / (1024.0 * 1024.0) << endl;
+	}
+	string json = toJson(results, warmup, reps, jobs);
+	if (jsonPath.size()) {
+		ofstream(jsonPath) << json;
+	}
+	if (!baselinePath.size()) {
+		return 0;
+	}
+	ifstream baselineFile(baselinePath);
+	if (!baselineFile) {
+		cerr << "bench: can't read baseline " << baselinePath << endl;
+		return 1;
+	}
+	string baseline((istreambuf_iterator<char>(baselineFile)), istreambuf_iterator<char>());
+	int regressions = 0;
+	cout << endl << "Against " << baselinePath << " (threshold " << threshold << "%):" << endl;
+	for (auto& r : results) {
+		double before = r.failed ? 0 : baselineMedian(baseline, r.name);
+		if (before <= 0) {
+			continue;
+		}
+		double change = (r.median / before - 1) * 100;
+		bool regressed = change > threshold;
+		regressions += regressed;
+		cout << left << setw(40) << r.name << right << fixed << setprecision(1) << setw(8)
+			<< showpos << change << noshowpos << "%" << (regressed ? "  REGRESSION" : "") << endl;
+	}
+	return regressions ? 1 : 0;
+}
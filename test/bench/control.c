@@ -0,0 +1,176 @@
+// Driver of the structured output test, linked against the output of
+// wasmdec --compilable for control.wast. Runs every function over a range of inputs
+// and compares each result with a plain C version of the wasm function, computed
+// with the same 32 bit wrapping arithmetic. Prints every mismatch, and exits with 1
+// if there was one.
+//
+// Usage: control
+#include <stdint.h>
+#include <stdio.h>
+
+void wasm_init(void);
+int32_t wasm_export_sum_to(int32_t n);
+int32_t wasm_export_digits(int32_t n);
+int32_t wasm_export_collatz(int32_t n);
+int32_t wasm_export_grade(int32_t x);
+int32_t wasm_export_classify(int32_t x);
+int32_t wasm_export_machine(int32_t n);
+int32_t wasm_export_dispatch(int32_t x);
+int32_t wasm_export_nested(int32_t n);
+
+static int32_t sum_to(int32_t n) {
+	uint32_t s = 0;
+	for (int32_t i = 0; i < n; ++i) {
+		s += (uint32_t)i * (uint32_t)i;
+	}
+	return (int32_t)s;
+}
+static int32_t digits(int32_t n) {
+	uint32_t u = (uint32_t)n;
+	int32_t count = 0;
+	do {
+		count++;
+		u /= 10;
+	} while (u);
+	return count;
+}
+static int32_t collatz(int32_t n) {
+	uint32_t u = (uint32_t)n;
+	int32_t steps = 0;
+	while (u > 1 && steps < 1000) {
+		u = u & 1 ? u * 3 + 1 : u >> 1;
+		steps++;
+	}
+	return steps;
+}
+static int32_t grade(int32_t x) {
+	switch (x) {
+		case 0:
+			return 10;
+		case 1:
+		case 3:
+			return 20;
+		case 2:
+			return 105;
+		default:
+			return 100;
+	}
+}
+static int32_t classify(int32_t x) {
+	switch (x) {
+		case 0:
+		case 2:
+			return 30;
+		case 1:
+		case 3:
+			return 1;
+		default:
+			return 40;
+	}
+}
+static int32_t machine(int32_t n) {
+	uint32_t acc = 0;
+	int32_t state = 0;
+	int32_t i = 0;
+	do {
+		if (state == 0) {
+			acc += (uint32_t)i;
+			state = 1;
+		} else if (state == 1) {
+			acc ^= (uint32_t)i << 3;
+			state = i & 2 ? 2 : 0;
+		} else {
+			if (acc > 100000) {
+				break;
+			}
+			acc -= 7;
+			state = 0;
+		}
+		acc++;
+		i++;
+	} while (i < n);
+	return (int32_t)acc;
+}
+static int32_t dispatch(int32_t x) {
+	uint32_t u = (uint32_t)x;
+	uint32_t r = 0;
+	for (;;) {
+		r++;
+		u--;
+		uint32_t index = u & 7;
+		if (index == 2) {
+			break;
+		}
+		if (index != 1) {
+			continue;
+		}
+		r += 10;
+		if (r >= 200) {
+			break;
+		}
+	}
+	return (int32_t)r;
+}
+static int32_t nested(int32_t n) {
+	uint32_t c = 0;
+	for (int32_t i = 0; i < n; ++i) {
+		for (int32_t j = 0; j <= i; ++j) {
+			if ((int32_t)c > 50000) {
+				return (int32_t)c;
+			}
+			c += (uint32_t)j + 1;
+		}
+	}
+	return (int32_t)c;
+}
+
+struct function {
+	const char* name;
+	int32_t (*compiled)(int32_t);
+	int32_t (*reference)(int32_t);
+	int bounded; // Runs in a few steps for any input
+};
+static const struct function functions[] = {
+	{ "sum_to", wasm_export_sum_to, sum_to, 0 },
+	{ "digits", wasm_export_digits, digits, 1 },
+	{ "collatz", wasm_export_collatz, collatz, 1 },
+	{ "grade", wasm_export_grade, grade, 1 },
+	{ "classify", wasm_export_classify, classify, 1 },
+	{ "machine", wasm_export_machine, machine, 0 },
+	{ "dispatch", wasm_export_dispatch, dispatch, 1 },
+	{ "nested", wasm_export_nested, nested, 1 }
+};
+// Inputs past the small range; the large ones only for bounded functions
+static const int32_t inputs[] = { 1000, 4096, 65535, 99999 };
+static const int32_t largeInputs[] = { INT32_MAX, INT32_MIN, -1, 123456789, -987654321 };
+
+static int failures = 0;
+static int checks = 0;
+
+static void check(const struct function* fn, int32_t input) {
+	int32_t expected = fn->reference(input);
+	int32_t actual = fn->compiled(input);
+	checks++;
+	if (actual != expected) {
+		printf("%s(%d): got %d, expected %d\n", fn->name, input, actual, expected);
+		failures++;
+	}
+}
+
+int main(void) {
+	wasm_init();
+	for (size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); ++f) {
+		const struct function* fn = &functions[f];
+		for (int32_t input = -8; input <= 300; ++input) {
+			check(fn, input);
+		}
+		for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+			check(fn, inputs[i]);
+		}
+		for (size_t i = 0; fn->bounded && i < sizeof(largeInputs) / sizeof(largeInputs[0]); ++i) {
+			check(fn, largeInputs[i]);
+		}
+	}
+	printf("%d checks, %d failures\n", checks, failures);
+	return failures ? 1 : 0;
+}
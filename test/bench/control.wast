@@ -0,0 +1,132 @@
+;; Control flow of the structured output test: one function per shape the compilable
+;; backend recovers, while, do/while and until loops, br_table chains written as a
+;; switch with fall through, breaks and continues from inside a switch, and the
+;; branches across loops that stay gotos
+(module
+  (memory 1)
+  (export "sum_to" (func $sum_to))
+  (export "digits" (func $digits))
+  (export "collatz" (func $collatz))
+  (export "grade" (func $grade))
+  (export "classify" (func $classify))
+  (export "machine" (func $machine))
+  (export "dispatch" (func $dispatch))
+  (export "nested" (func $nested))
+  ;; while: the loop starts by branching out and ends by branching back
+  (func $sum_to (param $n i32) (result i32)
+    (local $i i32)
+    (local $s i32)
+    (block $done
+      (loop $next
+        (br_if $done (i32.ge_s (get_local $i) (get_local $n)))
+        (set_local $s (i32.add (get_local $s) (i32.mul (get_local $i) (get_local $i))))
+        (set_local $i (i32.add (get_local $i) (i32.const 1)))
+        (br $next)))
+    (get_local $s))
+  ;; do/while: a conditional branch back at the end, with no effects
+  (func $digits (param $n i32) (result i32)
+    (local $count i32)
+    (loop $next
+      (set_local $count (i32.add (get_local $count) (i32.const 1)))
+      (set_local $n (i32.div_u (get_local $n) (i32.const 10)))
+      (br_if $next (i32.ne (get_local $n) (i32.const 0))))
+    (get_local $count))
+  ;; Until: the condition of the branch back has effects, and the body an if/else
+  (func $collatz (param $n i32) (result i32)
+    (local $steps i32)
+    (block $done
+      (loop $next
+        (br_if $done (i32.le_u (get_local $n) (i32.const 1)))
+        (if (i32.and (get_local $n) (i32.const 1))
+          (set_local $n (i32.add (i32.mul (get_local $n) (i32.const 3)) (i32.const 1)))
+          (set_local $n (i32.shr_u (get_local $n) (i32.const 1))))
+        (br_if $next (i32.lt_u (tee_local $steps (i32.add (get_local $steps) (i32.const 1))) (i32.const 1000)))))
+    (get_local $steps))
+  ;; Switch: cases sharing a block, a case falling through to the default, and
+  ;; indices past the table
+  (func $grade (param $x i32) (result i32)
+    (local $r i32)
+    (block $end
+      (block $default
+        (block $c2
+          (block $c1
+            (block $c0
+              (br_table $c0 $c1 $c2 $c1 $default (get_local $x)))
+            (set_local $r (i32.const 10))
+            (br $end))
+          (set_local $r (i32.const 20))
+          (br $end))
+        (set_local $r (i32.add (get_local $r) (i32.const 5))))
+      (set_local $r (i32.add (get_local $r) (i32.const 100))))
+    (get_local $r))
+  ;; A switch whose table also branches to the outermost block, as "case 1: break;"
+  ;; compiles, while indices past the table go to the default
+  (func $classify (param $x i32) (result i32)
+    (local $r i32)
+    (set_local $r (i32.const 1))
+    (block $end
+      (block $default
+        (block $c0
+          (br_table $c0 $end $c0 $end $default (get_local $x)))
+        (set_local $r (i32.const 30))
+        (br $end))
+      (set_local $r (i32.const 40)))
+    (get_local $r))
+  ;; A switch in a loop: its cases break out of the switch, and one leaves the loop,
+  ;; which has to be a goto since break would only leave the switch
+  (func $machine (param $n i32) (result i32)
+    (local $i i32)
+    (local $state i32)
+    (local $acc i32)
+    (block $exit
+      (loop $next
+        (block $c3
+          (block $c2
+            (block $c1
+              (block $c0
+                (br_table $c0 $c1 $c2 $c3 (get_local $state)))
+              (set_local $acc (i32.add (get_local $acc) (get_local $i)))
+              (set_local $state (i32.const 1))
+              (br $c3))
+            (set_local $acc (i32.xor (get_local $acc) (i32.shl (get_local $i) (i32.const 3))))
+            (set_local $state (select (i32.const 2) (i32.const 0) (i32.and (get_local $i) (i32.const 2))))
+            (br $c3))
+          (br_if $exit (i32.gt_u (get_local $acc) (i32.const 100000)))
+          (set_local $acc (i32.sub (get_local $acc) (i32.const 7)))
+          (set_local $state (i32.const 0)))
+        (set_local $acc (i32.add (get_local $acc) (i32.const 1)))
+        (br_if $next (i32.lt_s (tee_local $i (i32.add (get_local $i) (i32.const 1))) (get_local $n)))))
+    (get_local $acc))
+  ;; A br_table that isn't a switch chain: its targets are the loop, a block in it
+  ;; and the loop's exit
+  (func $dispatch (param $x i32) (result i32)
+    (local $r i32)
+    (block $out
+      (loop $again
+        (set_local $r (i32.add (get_local $r) (i32.const 1)))
+        (block $b
+          (br_table $again $b $out $again $again
+            (i32.and (tee_local $x (i32.sub (get_local $x) (i32.const 1))) (i32.const 7))))
+        (set_local $r (i32.add (get_local $r) (i32.const 10)))
+        (br_if $again (i32.lt_u (get_local $r) (i32.const 200)))))
+    (get_local $r))
+  ;; An inner loop that continues the outer one and leaves both
+  (func $nested (param $n i32) (result i32)
+    (local $i i32)
+    (local $j i32)
+    (local $c i32)
+    (block $done
+      (loop $outer
+        (br_if $done (i32.ge_s (get_local $i) (get_local $n)))
+        (set_local $j (i32.const 0))
+        (loop $inner
+          (br_if $done (i32.gt_s (get_local $c) (i32.const 50000)))
+          (set_local $c (i32.add (get_local $c) (i32.add (get_local $j) (i32.const 1))))
+          (set_local $j (i32.add (get_local $j) (i32.const 1)))
+          (if (i32.gt_s (get_local $j) (get_local $i))
+            (block
+              (set_local $i (i32.add (get_local $i) (i32.const 1)))
+              (br $outer)))
+          (br $inner))))
+    (get_local $c))
+)
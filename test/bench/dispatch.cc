@@ -0,0 +1,242 @@
+// Microbenchmark for wasmdec::parsers::expression dispatch.
+// Builds a synthetic function of about a million expressions and times
+//  1. dispatch alone: every node through the old if/else chain of is<T>() checks
+//     and through a switch on the expression id, both calling empty handlers
+//  2. a full conversion of the function body with Convert::getFuncBody
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include "wasm-builder.h"
+#include "wasm-traversal.h"
+#include "../../src/convert/Conversion.h"
+using namespace std;
+using namespace wasm;
+using namespace wasmdec;
+
+#define NOINLINE __attribute__((noinline))
+
+static size_t handled[Expression::NumExpressionIds];
+
+// One empty handler per node kind, like the parsers the chain used to call
+template<Expression::Id id>
+NOINLINE static void handle(Expression* ex) {
+	handled[id]++;
+}
+
+// The dispatch parsers::expression used before, in the same order (If is tested twice)
+NOINLINE static void chainDispatch(Expression* ex) {
+	if (ex->is<Block>()) {
+		handle<Expression::BlockId>(ex);
+	} else if (ex->is<Binary>()) {
+		handle<Expression::BinaryId>(ex);
+	} else if (ex->is<GetLocal>()) {
+		handle<Expression::GetLocalId>(ex);
+	} else if (ex->is<CallIndirect>()) {
+		handle<Expression::CallIndirectId>(ex);
+	} else if (ex->is<SetLocal>()) {
+		handle<Expression::SetLocalId>(ex);
+	} else if (ex->is<Load>()) {
+		handle<Expression::LoadId>(ex);
+	} else if (ex->is<Store>()) {
+		handle<Expression::StoreId>(ex);
+	} else if (ex->is<Unary>()) {
+		handle<Expression::UnaryId>(ex);
+	} else if (ex->is<AtomicRMW>()) {
+		handle<Expression::AtomicRMWId>(ex);
+	} else if (ex->is<AtomicCmpxchg>()) {
+		handle<Expression::AtomicCmpxchgId>(ex);
+	} else if (ex->is<Select>()) {
+		handle<Expression::SelectId>(ex);
+	} else if (ex->is<Drop>()) {
+		handle<Expression::DropId>(ex);
+	} else if (ex->is<Host>()) {
+		handle<Expression::HostId>(ex);
+	} else if (ex->is<Unreachable>()) {
+		handle<Expression::UnreachableId>(ex);
+	} else if (ex->is<SetGlobal>()) {
+		handle<Expression::SetGlobalId>(ex);
+	} else if (ex->is<GetGlobal>()) {
+		handle<Expression::GetGlobalId>(ex);
+	} else if (ex->is<Loop>()) {
+		handle<Expression::LoopId>(ex);
+	} else if (ex->is<Switch>()) {
+		handle<Expression::SwitchId>(ex);
+	} else if (ex->is<Call>()) {
+		handle<Expression::CallId>(ex);
+	} else if (ex->is<If>()) {
+		handle<Expression::IfId>(ex);
+	} else if (ex->is<Nop>()) {
+		handle<Expression::NopId>(ex);
+	} else if (ex->is<If>()) {
+		handle<Expression::IfId>(ex);
+	} else if (ex->is<Const>()) {
+		handle<Expression::ConstId>(ex);
+	} else if (ex->is<Return>()) {
+		handle<Expression::ReturnId>(ex);
+	} else if (ex->is<Break>()) {
+		handle<Expression::BreakId>(ex);
+	}
+}
+
+// The dispatch parsers::expression uses now
+NOINLINE static void switchDispatch(Expression* ex) {
+	switch (ex->_id) {
+		case Expression::BlockId: handle<Expression::BlockId>(ex); break;
+		case Expression::IfId: handle<Expression::IfId>(ex); break;
+		case Expression::LoopId: handle<Expression::LoopId>(ex); break;
+		case Expression::BreakId: handle<Expression::BreakId>(ex); break;
+		case Expression::SwitchId: handle<Expression::SwitchId>(ex); break;
+		case Expression::CallId: handle<Expression::CallId>(ex); break;
+		case Expression::CallIndirectId: handle<Expression::CallIndirectId>(ex); break;
+		case Expression::GetLocalId: handle<Expression::GetLocalId>(ex); break;
+		case Expression::SetLocalId: handle<Expression::SetLocalId>(ex); break;
+		case Expression::GetGlobalId: handle<Expression::GetGlobalId>(ex); break;
+		case Expression::SetGlobalId: handle<Expression::SetGlobalId>(ex); break;
+		case Expression::LoadId: handle<Expression::LoadId>(ex); break;
+		case Expression::StoreId: handle<Expression::StoreId>(ex); break;
+		case Expression::ConstId: handle<Expression::ConstId>(ex); break;
+		case Expression::UnaryId: handle<Expression::UnaryId>(ex); break;
+		case Expression::BinaryId: handle<Expression::BinaryId>(ex); break;
+		case Expression::SelectId: handle<Expression::SelectId>(ex); break;
+		case Expression::DropId: handle<Expression::DropId>(ex); break;
+		case Expression::ReturnId: handle<Expression::ReturnId>(ex); break;
+		case Expression::HostId: handle<Expression::HostId>(ex); break;
+		case Expression::NopId: handle<Expression::NopId>(ex); break;
+		case Expression::UnreachableId: handle<Expression::UnreachableId>(ex); break;
+		case Expression::AtomicRMWId: handle<Expression::AtomicRMWId>(ex); break;
+		case Expression::AtomicCmpxchgId: handle<Expression::AtomicCmpxchgId>(ex); break;
+		default: break;
+	}
+}
+
+// Straight line code mixing the node kinds a compiled function is made of
+static Function* buildFunction(Module& module, size_t targetNodes) {
+	Builder builder(module);
+	vector<Expression*> groups;
+	size_t nodes = 0;
+	int n = 0;
+	while (nodes < targetNodes) {
+		Name label = Name("group" + to_string(groups.size()));
+		vector<Expression*> list;
+		for (int i = 0; i < 200; ++i, ++n) {
+			Index local = n % 4;
+			switch (n % 6) {
+				case 0: // local0 = local1 + 1
+					list.push_back(builder.makeSetLocal(local, builder.makeBinary(AddInt32,
+						builder.makeGetLocal((local + 1) % 4, i32), builder.makeConst(Literal(int32_t(n))))));
+					nodes += 4;
+					break;
+				case 1: // *(local + 4) = *(local)
+					list.push_back(builder.makeStore(4, 0, 4,
+						builder.makeBinary(AddInt32, builder.makeGetLocal(local, i32), builder.makeConst(Literal(int32_t(4)))),
+						builder.makeLoad(4, false, 0, 4, builder.makeGetLocal(local, i32), i32), i32));
+					nodes += 6;
+					break;
+				case 2: // if (local < n) local = 0
+					list.push_back(builder.makeIf(
+						builder.makeBinary(LtSInt32, builder.makeGetLocal(local, i32), builder.makeConst(Literal(int32_t(n)))),
+						builder.makeSetLocal(local, builder.makeConst(Literal(int32_t(0))))));
+					nodes += 6;
+					break;
+				case 3: // drop(f(n, local))
+					list.push_back(builder.makeDrop(builder.makeCall(Name("callee"),
+						{ builder.makeConst(Literal(int32_t(n))), builder.makeGetLocal(local, i32) }, i32)));
+					nodes += 4;
+					break;
+				case 4: // if (local == 0) break
+					list.push_back(builder.makeBreak(label, nullptr,
+						builder.makeUnary(EqZInt32, builder.makeGetLocal(local, i32))));
+					nodes += 3;
+					break;
+				case 5: // local = (int)(long)local
+					list.push_back(builder.makeSetLocal(local, builder.makeUnary(WrapInt64,
+						builder.makeUnary(ExtendSInt32, builder.makeGetLocal(local, i32)))));
+					nodes += 4;
+					break;
+			}
+		}
+		Block* group = builder.makeBlock(list);
+		group->name = label;
+		groups.push_back(group);
+		nodes++;
+	}
+	groups.push_back(builder.makeReturn(builder.makeGetLocal(0, i32)));
+	Block* body = builder.makeBlock(groups);
+	return Builder::makeFunction(Name("bench"), { i32, i32 }, i32, { i32, i32 }, body);
+}
+
+struct Collector : public PostWalker<Collector, UnifiedExpressionVisitor<Collector>> {
+	vector<Expression*> nodes;
+	void visitExpression(Expression* curr) {
+		nodes.push_back(curr);
+	}
+};
+
+template<typename F>
+static double bestOf(int reps, F f) {
+	double best = 1e30;
+	for (int r = 0; r < reps; ++r) {
+		auto start = chrono::steady_clock::now();
+		f();
+		double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if (t < best) {
+			best = t;
+		}
+	}
+	return best;
+}
+
+static void compare(const char* title, const vector<Expression*>& nodes, int reps) {
+	double chain = bestOf(reps, [&]() {
+		for (auto* ex : nodes) chainDispatch(ex);
+	});
+	double sw = bestOf(reps, [&]() {
+		for (auto* ex : nodes) switchDispatch(ex);
+	});
+	cout << left << setw(24) << title << right
+		<< setw(10) << fixed << setprecision(2) << chain * 1e9 / nodes.size() << " ns"
+		<< setw(10) << sw * 1e9 / nodes.size() << " ns"
+		<< setw(9) << setprecision(2) << chain / sw << "x" << endl;
+}
+
+int main(int argc, char** argv) {
+	size_t targetNodes = argc > 1 ? stoul(argv[1]) : 1000000;
+	int reps = argc > 2 ? stoi(argv[2]) : 10;
+	Module module;
+	Function* fn = buildFunction(module, targetNodes);
+	module.addFunction(fn);
+	Collector collector;
+	collector.walk(fn->body);
+	cout << "Synthetic function: " << collector.nodes.size() << " expressions, best of " << reps << " runs" << endl << endl;
+
+	cout << left << setw(24) << "Dispatch only (per node)" << right << setw(13) << "if/else" << setw(13) << "switch" << setw(10) << "speedup" << endl;
+	compare("all nodes", collector.nodes, reps);
+	// Kinds near the bottom of the old chain paid for every check above them
+	const Expression::Id kinds[] = { Expression::BlockId, Expression::BinaryId, Expression::GetLocalId,
+		Expression::SetLocalId, Expression::LoadId, Expression::StoreId, Expression::UnaryId,
+		Expression::DropId, Expression::CallId, Expression::IfId, Expression::ConstId,
+		Expression::ReturnId, Expression::BreakId };
+	for (auto kind : kinds) {
+		vector<Expression*> subset;
+		for (auto* ex : collector.nodes) {
+			if (ex->_id == kind) subset.push_back(ex);
+		}
+		if (subset.size() < 1000) continue;
+		string title = "  " + string(getExpressionName(subset[0]));
+		compare(title.c_str(), subset, reps);
+	}
+
+	string out;
+	double convert = bestOf(reps, [&]() {
+		string().swap(out);
+		Context ctx(fn, &module, nullptr);
+		ctx.functionLevelExpression = true;
+		Convert::getFuncBody(ctx, false, out);
+	});
+	cout << endl << "Convert::getFuncBody: " << setprecision(3) << convert * 1e3 << " ms, "
+		<< setprecision(1) << convert * 1e9 / collector.nodes.size() << " ns per expression, "
+		<< out.size() << " bytes of C" << endl;
+	return 0;
+}
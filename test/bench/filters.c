@@ -0,0 +1,71 @@
+// Driver of the counted loop benchmark, linked against the output of
+// wasmdec --compilable for filters.wast. Runs every filter over a 1024x1024 RGBA
+// image in linear memory, prints a checksum of the image after each filter to
+// stdout, so builds can be compared, and the run time of each filter to stderr.
+//
+// Usage: filters-(build) [repetitions]
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void wasm_init(void);
+void wasm_export_fill(int32_t p, int32_t len, int32_t seed);
+int32_t wasm_export_checksum(int32_t p, int32_t len);
+void wasm_export_invert(int32_t p, int32_t len);
+void wasm_export_brighten(int32_t p, int32_t len, int32_t delta);
+void wasm_export_grayscale(int32_t p, int32_t len);
+void wasm_export_blend(int32_t out, int32_t a, int32_t b, int32_t len);
+void wasm_export_blur(int32_t out, int32_t in, int32_t len);
+
+// Three images, one after the other
+#define IMAGE_BYTES (1024 * 1024 * 4)
+#define IMAGE_A 1024
+#define IMAGE_B (IMAGE_A + IMAGE_BYTES)
+#define IMAGE_OUT (IMAGE_B + IMAGE_BYTES)
+
+enum { INVERT, BRIGHTEN, GRAYSCALE, BLEND, BLUR, FILTERS };
+static const char* names[FILTERS] = { "invert", "brighten", "grayscale", "blend", "blur" };
+
+static void run(int filter, int rep) {
+	switch (filter) {
+		case INVERT:
+			wasm_export_invert(IMAGE_A, IMAGE_BYTES);
+			break;
+		case BRIGHTEN:
+			wasm_export_brighten(IMAGE_A, IMAGE_BYTES, rep % 2 ? 20 : -20);
+			break;
+		case GRAYSCALE:
+			wasm_export_grayscale(IMAGE_B, IMAGE_BYTES);
+			break;
+		case BLEND:
+			wasm_export_blend(IMAGE_OUT, IMAGE_A, IMAGE_B, IMAGE_BYTES);
+			break;
+		case BLUR:
+			wasm_export_blur(IMAGE_B, IMAGE_OUT, IMAGE_BYTES);
+			break;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int reps = argc > 1 ? atoi(argv[1]) : 100;
+	double total = 0;
+	wasm_init();
+	wasm_export_fill(IMAGE_A, IMAGE_BYTES, 12345);
+	wasm_export_fill(IMAGE_B, IMAGE_BYTES, 67890);
+	for (int filter = 0; filter < FILTERS; ++filter) {
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int rep = 0; rep < reps; ++rep) {
+			run(filter, rep);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		total += seconds;
+		printf("%s %d\n", names[filter], wasm_export_checksum(IMAGE_A, 3 * IMAGE_BYTES));
+		fprintf(stderr, "%s %s: %.3f ms per image, %.2f GB/s\n", argv[0], names[filter],
+			seconds * 1e3 / reps, (double)IMAGE_BYTES * reps / seconds / 1e9);
+	}
+	fprintf(stderr, "%s: %.3f s\n", argv[0], total);
+	return 0;
+}
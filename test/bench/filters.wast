@@ -0,0 +1,111 @@
+;; Kernels of the counted loop benchmark: image filters over RGBA pixels, with their
+;; loops in the shape compilers give them in wasm, a guard followed by
+;; "do { body } while ((i += step) < n)"
+(module
+  (memory 200)
+  (export "fill" (func $fill))
+  (export "checksum" (func $checksum))
+  (export "invert" (func $invert))
+  (export "brighten" (func $brighten))
+  (export "grayscale" (func $grayscale))
+  (export "blend" (func $blend))
+  (export "blur" (func $blur))
+  ;; Pseudo random bytes
+  (func $fill (param $p i32) (param $len i32) (param $seed i32)
+    (local $i i32)
+    (block $done
+      (br_if $done (i32.le_s (get_local $len) (i32.const 0)))
+      (loop $next
+        (set_local $seed (i32.xor (get_local $seed) (i32.shl (get_local $seed) (i32.const 13))))
+        (set_local $seed (i32.xor (get_local $seed) (i32.shr_u (get_local $seed) (i32.const 17))))
+        (set_local $seed (i32.xor (get_local $seed) (i32.shl (get_local $seed) (i32.const 5))))
+        (i32.store8 (i32.add (get_local $p) (get_local $i)) (get_local $seed))
+        (br_if $next (i32.lt_s (tee_local $i (i32.add (get_local $i) (i32.const 1))) (get_local $len))))))
+  (func $checksum (param $p i32) (param $len i32) (result i32)
+    (local $i i32)
+    (local $sum i32)
+    (block $done
+      (br_if $done (i32.le_s (get_local $len) (i32.const 0)))
+      (loop $next
+        (set_local $sum
+          (i32.xor (i32.mul (get_local $sum) (i32.const 33))
+            (i32.load8_u (i32.add (get_local $p) (get_local $i)))))
+        (br_if $next (i32.lt_s (tee_local $i (i32.add (get_local $i) (i32.const 1))) (get_local $len)))))
+    (get_local $sum))
+  ;; 255 - c of each color, keeping alpha
+  (func $invert (param $p i32) (param $len i32)
+    (local $i i32)
+    (block $done
+      (br_if $done (i32.le_s (get_local $len) (i32.const 0)))
+      (loop $next
+        (i32.store8 (i32.add (get_local $p) (get_local $i))
+          (i32.sub (i32.const 255) (i32.load8_u (i32.add (get_local $p) (get_local $i)))))
+        (i32.store8 offset=1 (i32.add (get_local $p) (get_local $i))
+          (i32.sub (i32.const 255) (i32.load8_u offset=1 (i32.add (get_local $p) (get_local $i)))))
+        (i32.store8 offset=2 (i32.add (get_local $p) (get_local $i))
+          (i32.sub (i32.const 255) (i32.load8_u offset=2 (i32.add (get_local $p) (get_local $i)))))
+        (br_if $next (i32.lt_s (tee_local $i (i32.add (get_local $i) (i32.const 4))) (get_local $len))))))
+  ;; c + delta of every byte, clamped to 0..255
+  (func $brighten (param $p i32) (param $len i32) (param $delta i32)
+    (local $i i32)
+    (local $v i32)
+    (block $done
+      (br_if $done (i32.le_s (get_local $len) (i32.const 0)))
+      (loop $next
+        (set_local $v (i32.add (i32.load8_u (i32.add (get_local $p) (get_local $i))) (get_local $delta)))
+        (set_local $v (select (i32.const 255) (get_local $v) (i32.gt_s (get_local $v) (i32.const 255))))
+        (set_local $v (select (i32.const 0) (get_local $v) (i32.lt_s (get_local $v) (i32.const 0))))
+        (i32.store8 (i32.add (get_local $p) (get_local $i)) (get_local $v))
+        (set_local $i (i32.add (get_local $i) (i32.const 1)))
+        (br_if $next (i32.ne (get_local $i) (get_local $len))))))
+  ;; Luma of each pixel, (77 r + 150 g + 29 b) / 256, into its three colors
+  (func $grayscale (param $p i32) (param $len i32)
+    (local $i i32)
+    (local $y i32)
+    (block $done
+      (br_if $done (i32.le_s (get_local $len) (i32.const 0)))
+      (loop $next
+        (set_local $y
+          (i32.shr_u
+            (i32.add
+              (i32.add
+                (i32.mul (i32.load8_u (i32.add (get_local $p) (get_local $i))) (i32.const 77))
+                (i32.mul (i32.load8_u offset=1 (i32.add (get_local $p) (get_local $i))) (i32.const 150)))
+              (i32.mul (i32.load8_u offset=2 (i32.add (get_local $p) (get_local $i))) (i32.const 29)))
+            (i32.const 8)))
+        (i32.store8 (i32.add (get_local $p) (get_local $i)) (get_local $y))
+        (i32.store8 offset=1 (i32.add (get_local $p) (get_local $i)) (get_local $y))
+        (i32.store8 offset=2 (i32.add (get_local $p) (get_local $i)) (get_local $y))
+        (br_if $next (i32.lt_s (tee_local $i (i32.add (get_local $i) (i32.const 4))) (get_local $len))))))
+  ;; Rounded average of two images
+  (func $blend (param $out i32) (param $a i32) (param $b i32) (param $len i32)
+    (local $i i32)
+    (block $done
+      (br_if $done (i32.le_s (get_local $len) (i32.const 0)))
+      (loop $next
+        (i32.store8 (i32.add (get_local $out) (get_local $i))
+          (i32.shr_u
+            (i32.add
+              (i32.add
+                (i32.load8_u (i32.add (get_local $a) (get_local $i)))
+                (i32.load8_u (i32.add (get_local $b) (get_local $i))))
+              (i32.const 1))
+            (i32.const 1)))
+        (br_if $next (i32.lt_u (tee_local $i (i32.add (get_local $i) (i32.const 1))) (get_local $len))))))
+  ;; Horizontal [1 2 1] / 4 blur of every byte, between pixels of the same channel
+  (func $blur (param $out i32) (param $in i32) (param $len i32)
+    (local $i i32)
+    (local $end i32)
+    (set_local $end (i32.sub (get_local $len) (i32.const 8)))
+    (block $done
+      (br_if $done (i32.le_s (get_local $end) (i32.const 0)))
+      (loop $next
+        (i32.store8 offset=4 (i32.add (get_local $out) (get_local $i))
+          (i32.shr_u
+            (i32.add
+              (i32.add
+                (i32.load8_u (i32.add (get_local $in) (get_local $i)))
+                (i32.shl (i32.load8_u offset=4 (i32.add (get_local $in) (get_local $i))) (i32.const 1)))
+              (i32.add (i32.load8_u offset=8 (i32.add (get_local $in) (get_local $i))) (i32.const 2)))
+            (i32.const 2)))
+        (br_if $next (i32.lt_s (tee_local $i (i32.add (get_local $i) (i32.const 1))) (get_local $end)))))))
@@ -0,0 +1,76 @@
+// Microbenchmark of the bit operations that the pseudo C preamble and the runtime of
+// --compilable output share. Writes a C file made of Emitter::runtime() and a kernel that wraps every operation
+// in a function of its own, so the Makefile can check from the assembly that each
+// one compiled to a single instruction, then time them over a buffer of values.
+//
+// Usage: intrinsics-gen (output C file)
+#include <fstream>
+#include <iostream>
+#include "../../src/Emitter.h"
+using namespace std;
+using namespace wasmdec;
+
+static const char* kernel = R"(
+#include <stdio.h>
+#include <time.h>
+#define BENCH_VALUES 4096
+#define BENCH_REPS 20000
+// Zero is among the values, so the zero case of clz and ctz is exercised
+static uint64_t values[BENCH_VALUES];
+#define BENCH_UNARY(name, T, op) __attribute__((noinline)) T bench_##name(T value) { return op(value); }
+#define BENCH_ROTATE(name, T, op) __attribute__((noinline)) T bench_##name(T value, T shift) { return op(value, shift); }
+BENCH_ROTATE(rotl32, uint32_t, wasm_i32_rotl)
+BENCH_ROTATE(rotr32, uint32_t, wasm_i32_rotr)
+BENCH_ROTATE(rotl64, uint64_t, wasm_i64_rotl)
+BENCH_ROTATE(rotr64, uint64_t, wasm_i64_rotr)
+BENCH_UNARY(clz32, uint32_t, wasm_i32_clz)
+BENCH_UNARY(clz64, uint64_t, wasm_i64_clz)
+BENCH_UNARY(ctz32, uint32_t, wasm_i32_ctz)
+BENCH_UNARY(ctz64, uint64_t, wasm_i64_ctz)
+BENCH_UNARY(popcnt32, uint32_t, wasm_i32_popcnt)
+BENCH_UNARY(popcnt64, uint64_t, wasm_i64_popcnt)
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+#define TIME(name, T, call) { \
+	double start = now(); \
+	uint64_t sum = 0; \
+	for (int rep = 0; rep < BENCH_REPS; ++rep) \
+		for (int i = 0; i < BENCH_VALUES; ++i) { T value = (T)values[i]; sum += call; } \
+	double ns = (now() - start) * 1e9 / ((double)BENCH_REPS * BENCH_VALUES); \
+	printf("%-10s %6.2f ns/op  (checksum %llu)\n", #name, ns, (unsigned long long)sum); }
+int main(void) {
+	uint64_t x = 88172645463325252ULL;
+	for (int i = 0; i < BENCH_VALUES; ++i) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		values[i] = i % 64 ? x >> (i % 64) : 0;
+	}
+	TIME(rotl32, uint32_t, bench_rotl32(value, i))
+	TIME(rotr32, uint32_t, bench_rotr32(value, i))
+	TIME(rotl64, uint64_t, bench_rotl64(value, i))
+	TIME(rotr64, uint64_t, bench_rotr64(value, i))
+	TIME(clz32, uint32_t, bench_clz32(value))
+	TIME(clz64, uint64_t, bench_clz64(value))
+	TIME(ctz32, uint32_t, bench_ctz32(value))
+	TIME(ctz64, uint64_t, bench_ctz64(value))
+	TIME(popcnt32, uint32_t, bench_popcnt32(value))
+	TIME(popcnt64, uint64_t, bench_popcnt64(value))
+	return 0;
+}
+)";
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " (output C file)" << endl;
+		return 1;
+	}
+	Emitter emit;
+	emit.runtime();
+	ofstream out(argv[1]);
+	out << emit.getCode() << kernel;
+	return out ? 0 : 1;
+}
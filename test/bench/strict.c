@@ -0,0 +1,126 @@
+// Driver of the strict trap test. Includes the output of
+// wasmdec --compilable --traps=strict for strict.wast, with WASM_TRAP defined to
+// return here, and calls each operator with operands that must trap and operands
+// that must not: division by zero, INT_MIN / -1, and conversions of NaN and of values
+// just outside and just inside the integer range. Prints every mismatch, and exits
+// with 1 if there was one.
+//
+// Usage: strict
+#include <math.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static jmp_buf trapJump;
+static const char* trapReason;
+
+__attribute__((noreturn)) static void trapped(const char* reason) {
+	trapReason = reason;
+	longjmp(trapJump, 1);
+}
+#define WASM_TRAP(reason) trapped(reason)
+#include "strict-out.c"
+
+static int failures = 0;
+static int checks = 0;
+
+static void fail(const char* call, const char* what) {
+	printf("%s: %s\n", call, what);
+	failures++;
+}
+// The call must return the value, as a 64 bit integer
+#define EXPECT(call, expected) do { \
+		checks++; \
+		if (!setjmp(trapJump)) { \
+			volatile int64_t value = (int64_t)(call); \
+			if (value != (int64_t)(expected)) { \
+				char what[64]; \
+				snprintf(what, sizeof(what), "got %lld, expected %lld", (long long)value, (long long)(expected)); \
+				fail(#call, what); \
+			} \
+		} else { \
+			fail(#call, trapReason); \
+		} \
+	} while (0)
+// The call must trap with the reason
+#define EXPECT_TRAP(call, reason) do { \
+		checks++; \
+		if (!setjmp(trapJump)) { \
+			volatile int64_t value = (int64_t)(call); \
+			(void)value; \
+			fail(#call, "didn't trap"); \
+		} else if (strcmp(trapReason, reason)) { \
+			fail(#call, trapReason); \
+		} \
+	} while (0)
+
+int main(void) {
+	wasm_init();
+	// Division by zero, and INT_MIN / -1, the only quotient out of range
+	EXPECT(wasm_export_i32_div_s(-7, 2), -3);
+	EXPECT(wasm_export_i32_div_s(INT32_MIN, 1), INT32_MIN);
+	EXPECT(wasm_export_i32_div_s(INT32_MAX, -1), -INT32_MAX);
+	EXPECT_TRAP(wasm_export_i32_div_s(1, 0), "integer divide by zero");
+	EXPECT_TRAP(wasm_export_i32_div_s(INT32_MIN, -1), "integer overflow");
+	EXPECT(wasm_export_i32_div_u(-1, 2), INT32_MAX);
+	EXPECT_TRAP(wasm_export_i32_div_u(1, 0), "integer divide by zero");
+	EXPECT(wasm_export_i32_rem_s(-7, 2), -1);
+	EXPECT(wasm_export_i32_rem_s(INT32_MIN, -1), 0);
+	EXPECT_TRAP(wasm_export_i32_rem_s(1, 0), "integer divide by zero");
+	EXPECT(wasm_export_i32_rem_u(-1, 10), 5);
+	EXPECT_TRAP(wasm_export_i32_rem_u(1, 0), "integer divide by zero");
+	EXPECT(wasm_export_i64_div_s(-9, 4), -2);
+	EXPECT(wasm_export_i64_div_s(INT64_MIN, 2), INT64_MIN / 2);
+	EXPECT_TRAP(wasm_export_i64_div_s(1, 0), "integer divide by zero");
+	EXPECT_TRAP(wasm_export_i64_div_s(INT64_MIN, -1), "integer overflow");
+	EXPECT(wasm_export_i64_div_u(-1, 2), INT64_MAX);
+	EXPECT_TRAP(wasm_export_i64_div_u(1, 0), "integer divide by zero");
+	EXPECT(wasm_export_i64_rem_s(INT64_MIN, -1), 0);
+	EXPECT_TRAP(wasm_export_i64_rem_s(1, 0), "integer divide by zero");
+	EXPECT(wasm_export_i64_rem_u(-1, 10), 5);
+	EXPECT_TRAP(wasm_export_i64_rem_u(1, 0), "integer divide by zero");
+	// Conversions at the largest and smallest values in range, the next float past
+	// them, infinities and NaN
+	EXPECT(wasm_export_i32_trunc_s_f32(-1.5f), -1);
+	EXPECT(wasm_export_i32_trunc_s_f32(2147483520.0f), 2147483520);
+	EXPECT(wasm_export_i32_trunc_s_f32(-2147483648.0f), INT32_MIN);
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f32(2147483648.0f), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f32(-2147483904.0f), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f32(INFINITY), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f32(NAN), "invalid conversion to integer");
+	EXPECT(wasm_export_i32_trunc_u_f32(-0.9f), 0);
+	EXPECT(wasm_export_i32_trunc_u_f32(4294967040.0f), (int32_t)4294967040u);
+	EXPECT_TRAP(wasm_export_i32_trunc_u_f32(-1.0f), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_u_f32(4294967296.0f), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_u_f32(NAN), "invalid conversion to integer");
+	EXPECT(wasm_export_i32_trunc_s_f64(2147483647.9), INT32_MAX);
+	EXPECT(wasm_export_i32_trunc_s_f64(-2147483648.9), INT32_MIN);
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f64(2147483648.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f64(-2147483649.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f64(-INFINITY), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_s_f64(NAN), "invalid conversion to integer");
+	EXPECT(wasm_export_i32_trunc_u_f64(4294967295.9), -1);
+	EXPECT(wasm_export_i32_trunc_u_f64(-0.99), 0);
+	EXPECT_TRAP(wasm_export_i32_trunc_u_f64(4294967296.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i32_trunc_u_f64(-1.0), "integer overflow");
+	EXPECT(wasm_export_i64_trunc_s_f32(-9223372036854775808.0f), INT64_MIN);
+	EXPECT(wasm_export_i64_trunc_s_f32(9223371487098961920.0f), 9223371487098961920);
+	EXPECT_TRAP(wasm_export_i64_trunc_s_f32(9223372036854775808.0f), "integer overflow");
+	EXPECT_TRAP(wasm_export_i64_trunc_s_f32(NAN), "invalid conversion to integer");
+	EXPECT(wasm_export_i64_trunc_u_f32(18446742974197923840.0f), (int64_t)18446742974197923840u);
+	EXPECT_TRAP(wasm_export_i64_trunc_u_f32(18446744073709551616.0f), "integer overflow");
+	EXPECT_TRAP(wasm_export_i64_trunc_u_f32(-1.0f), "integer overflow");
+	EXPECT(wasm_export_i64_trunc_s_f64(9223372036854774784.0), 9223372036854774784);
+	EXPECT(wasm_export_i64_trunc_s_f64(-9223372036854775808.0), INT64_MIN);
+	EXPECT_TRAP(wasm_export_i64_trunc_s_f64(9223372036854775808.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i64_trunc_s_f64(-9223372036854777856.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i64_trunc_s_f64(NAN), "invalid conversion to integer");
+	EXPECT(wasm_export_i64_trunc_u_f64(18446744073709549568.0), (int64_t)18446744073709549568u);
+	EXPECT(wasm_export_i64_trunc_u_f64(-0.5), 0);
+	EXPECT_TRAP(wasm_export_i64_trunc_u_f64(18446744073709551616.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i64_trunc_u_f64(-1.0), "integer overflow");
+	EXPECT_TRAP(wasm_export_i64_trunc_u_f64(INFINITY), "integer overflow");
+	printf("%d checks, %d failures\n", checks, failures);
+	return failures ? 1 : 0;
+}
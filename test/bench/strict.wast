@@ -0,0 +1,54 @@
+;; Operators of the strict trap test: every integer division and remainder, and every
+;; float to integer conversion, each in a function of its own so the driver can call
+;; it with operands that trap and operands that don't
+(module
+  (memory 1)
+  (export "i32_div_s" (func $i32_div_s))
+  (export "i32_div_u" (func $i32_div_u))
+  (export "i32_rem_s" (func $i32_rem_s))
+  (export "i32_rem_u" (func $i32_rem_u))
+  (export "i64_div_s" (func $i64_div_s))
+  (export "i64_div_u" (func $i64_div_u))
+  (export "i64_rem_s" (func $i64_rem_s))
+  (export "i64_rem_u" (func $i64_rem_u))
+  (export "i32_trunc_s_f32" (func $i32_trunc_s_f32))
+  (export "i32_trunc_u_f32" (func $i32_trunc_u_f32))
+  (export "i32_trunc_s_f64" (func $i32_trunc_s_f64))
+  (export "i32_trunc_u_f64" (func $i32_trunc_u_f64))
+  (export "i64_trunc_s_f32" (func $i64_trunc_s_f32))
+  (export "i64_trunc_u_f32" (func $i64_trunc_u_f32))
+  (export "i64_trunc_s_f64" (func $i64_trunc_s_f64))
+  (export "i64_trunc_u_f64" (func $i64_trunc_u_f64))
+  (func $i32_div_s (param $a i32) (param $b i32) (result i32)
+    (i32.div_s (get_local $a) (get_local $b)))
+  (func $i32_div_u (param $a i32) (param $b i32) (result i32)
+    (i32.div_u (get_local $a) (get_local $b)))
+  (func $i32_rem_s (param $a i32) (param $b i32) (result i32)
+    (i32.rem_s (get_local $a) (get_local $b)))
+  (func $i32_rem_u (param $a i32) (param $b i32) (result i32)
+    (i32.rem_u (get_local $a) (get_local $b)))
+  (func $i64_div_s (param $a i64) (param $b i64) (result i64)
+    (i64.div_s (get_local $a) (get_local $b)))
+  (func $i64_div_u (param $a i64) (param $b i64) (result i64)
+    (i64.div_u (get_local $a) (get_local $b)))
+  (func $i64_rem_s (param $a i64) (param $b i64) (result i64)
+    (i64.rem_s (get_local $a) (get_local $b)))
+  (func $i64_rem_u (param $a i64) (param $b i64) (result i64)
+    (i64.rem_u (get_local $a) (get_local $b)))
+  (func $i32_trunc_s_f32 (param $x f32) (result i32)
+    (i32.trunc_s/f32 (get_local $x)))
+  (func $i32_trunc_u_f32 (param $x f32) (result i32)
+    (i32.trunc_u/f32 (get_local $x)))
+  (func $i32_trunc_s_f64 (param $x f64) (result i32)
+    (i32.trunc_s/f64 (get_local $x)))
+  (func $i32_trunc_u_f64 (param $x f64) (result i32)
+    (i32.trunc_u/f64 (get_local $x)))
+  (func $i64_trunc_s_f32 (param $x f32) (result i64)
+    (i64.trunc_s/f32 (get_local $x)))
+  (func $i64_trunc_u_f32 (param $x f32) (result i64)
+    (i64.trunc_u/f32 (get_local $x)))
+  (func $i64_trunc_s_f64 (param $x f64) (result i64)
+    (i64.trunc_s/f64 (get_local $x)))
+  (func $i64_trunc_u_f64 (param $x f64) (result i64)
+    (i64.trunc_u/f64 (get_local $x)))
+)
@@ -0,0 +1,25 @@
+// Driver of the trap mode benchmark, linked against the output of
+// wasmdec --compilable for traps.wast. Prints the kernel's result to stdout, so the
+// modes can be compared, and its run time to stderr.
+//
+// Usage: traps-(mode) [iterations]
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void wasm_init(void);
+int64_t wasm_export_run(int32_t n);
+
+int main(int argc, char* argv[]) {
+	int32_t n = argc > 1 ? atoi(argv[1]) : 100000000;
+	struct timespec start, end;
+	wasm_init();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int64_t result = wasm_export_run(n);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%lld\n", (long long)result);
+	fprintf(stderr, "%s: %d iterations in %.3f s, %.2f ns each\n", argv[0], n, seconds, seconds * 1e9 / n);
+	return 0;
+}
@@ -0,0 +1,30 @@
+;; Kernel of the trap mode benchmark: divisions, remainders and float to int
+;; conversions on a pseudo random sequence, none of which trap
+(module
+  (memory 1)
+  (export "run" (func $run))
+  (func $run (param $n i32) (result i64)
+    (local $i i32)
+    (local $x i32)
+    (local $acc i64)
+    (set_local $x (i32.const 12345))
+    (block $done
+      (loop $next
+        (br_if $done (i32.ge_u (get_local $i) (get_local $n)))
+        (set_local $x (i32.xor (get_local $x) (i32.shl (get_local $x) (i32.const 13))))
+        (set_local $x (i32.xor (get_local $x) (i32.shr_u (get_local $x) (i32.const 17))))
+        (set_local $x (i32.xor (get_local $x) (i32.shl (get_local $x) (i32.const 5))))
+        (set_local $acc
+          (i64.add (get_local $acc)
+            (i64.extend_s/i32
+              (i32.add
+                (i32.div_s (get_local $x) (i32.or (i32.and (get_local $i) (i32.const 255)) (i32.const 1)))
+                (i32.rem_u (get_local $x) (i32.add (get_local $i) (i32.const 3)))))))
+        (set_local $acc
+          (i64.add (get_local $acc)
+            (i64.rem_s
+              (i64.trunc_s/f64 (f64.div (f64.convert_s/i32 (get_local $x)) (f64.const 7)))
+              (i64.const 1000003))))
+        (set_local $i (i32.add (get_local $i) (i32.const 1)))
+        (br $next)))
+    (get_local $acc)))
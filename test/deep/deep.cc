@@ -0,0 +1,122 @@
+// Converts a function whose expressions nest 100k levels deep (or the depth given as the
+// first argument) on a thread with a small stack. The conversion must not depend on the
+// native stack, so this crashes if any part of it recurses once per level.
+//
+// Usage: deep [depth]
+#include <string>
+#include <iostream>
+#include <pthread.h>
+#include "wasm-builder.h"
+#include "../../src/convert/Conversion.h"
+#include "../../src/cache/FunctionCache.h"
+using namespace std;
+using namespace wasm;
+using namespace wasmdec;
+
+static const size_t stackSize = 256 * 1024;
+
+struct Test {
+	Module module;
+	Function* fn;
+	size_t levels;
+	string out;
+	size_t depth;
+};
+
+static size_t count(const string& s, const string& what) {
+	size_t n = 0;
+	for (size_t at = s.find(what); at != string::npos; at = s.find(what, at + what.size())) {
+		n++;
+	}
+	return n;
+}
+
+// Chains of each kind of nesting the parsers handle: operators, blocks, ifs, loops,
+// loads, stores and calls. Blocks indent their contents and loops unindent them, so the
+// output stays linear in the depth.
+static Function* buildFunction(Module& module, size_t levels) {
+	Builder builder(module);
+	vector<Expression*> list;
+
+	Expression* sum = builder.makeGetLocal(0, i32);
+	for (size_t i = 0; i < levels; ++i) {
+		sum = builder.makeBinary(AddInt32, sum, builder.makeConst(Literal(int32_t(1))));
+	}
+	list.push_back(builder.makeSetLocal(2, sum));
+
+	Expression* flag = builder.makeGetLocal(1, i32);
+	for (size_t i = 0; i < levels; ++i) {
+		if (i % 2) {
+			flag = builder.makeUnary(EqZInt32, flag);
+		} else {
+			flag = builder.makeSelect(builder.makeGetLocal(0, i32), flag, builder.makeGetLocal(1, i32));
+		}
+	}
+	list.push_back(builder.makeSetLocal(2, flag));
+
+	Expression* nested = builder.makeNop();
+	for (size_t i = 0; i < levels; ++i) {
+		switch (i % 4) {
+			case 0:
+				nested = builder.makeBlock(nested);
+				break;
+			case 1:
+				nested = builder.makeIf(builder.makeGetLocal(0, i32), nested);
+				break;
+			case 2:
+				nested = builder.makeLoop(Name("loop" + to_string(i)), nested);
+				break;
+			case 3:
+				nested = builder.makeIf(builder.makeGetLocal(1, i32), nested,
+					builder.makeDrop(builder.makeCall(Name("callee"), { builder.makeGetLocal(0, i32) }, i32)));
+				break;
+		}
+	}
+	list.push_back(nested);
+
+	Expression* pointer = builder.makeGetLocal(0, i32);
+	for (size_t i = 0; i < levels; ++i) {
+		pointer = builder.makeLoad(4, false, 0, 4, pointer, i32);
+	}
+	list.push_back(builder.makeStore(4, 0, 4, pointer, builder.makeGetLocal(1, i32), i32));
+
+	list.push_back(builder.makeReturn(builder.makeGetLocal(2, i32)));
+	return Builder::makeFunction(Name("deep"), { i32, i32 }, i32, { i32 }, builder.makeBlock(list));
+}
+
+static void* convert(void* arg) {
+	Test* test = (Test*)arg;
+	test->depth = util::maxDepth(test->fn->body);
+	FunctionCache::hashFunction(test->fn, "");
+	Context ctx(test->fn, &test->module, nullptr);
+	ctx.functionLevelExpression = true;
+	Convert::getFuncBody(ctx, false, test->out);
+	return nullptr;
+}
+
+int main(int argc, char** argv) {
+	Test test;
+	test.levels = argc > 1 ? stoul(argv[1]) : 100000;
+	test.fn = buildFunction(test.module, test.levels);
+	test.module.addFunction(test.fn);
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, stackSize);
+	pthread_t thread;
+	if (pthread_create(&thread, &attr, convert, &test) != 0) {
+		cerr << "deep: can't start the conversion thread" << endl;
+		return 1;
+	}
+	pthread_join(thread, nullptr);
+
+	bool ok = test.depth > test.levels
+		&& count(test.out, " + 1") == test.levels
+		&& count(test.out, "while (1) {") == test.levels / 4 + (test.levels % 4 > 2)
+		&& count(test.out, "*(void*)(") == test.levels
+		&& test.out.find("return local2;") != string::npos;
+	cout << "deep: " << test.levels << " levels, expression depth " << test.depth << ", "
+		<< test.out.size() << " bytes of C with a " << stackSize / 1024 << " KiB stack: "
+		<< (ok ? "ok" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
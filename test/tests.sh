@@ -4,7 +4,7 @@
 # make sure you have wasmdec installed before running (run "make install" in the root dir)
 
 do_test () {
-	wasmdec -i $1 -o test.c -e -d
+	wasmdec -o test.c -e -d $1
 	if [ $? -eq 0 ]; then
 		# test succeeded!
 		echo "TEST SUCCESS: test $1 passed"
@@ -24,4 +24,37 @@ do_test "wasm/funcs.wasm"
 do_test "wasm/switch.wasm"
 do_test "wasm/switch.wast"
 do_test "wast-tests/addTwo.wast"
-do_test "wast-tests/funcs.wast"
\ No newline at end of file
+do_test "wast-tests/funcs.wast"
+
+# --only must decode the bodies it selects: imports.wasm has two imports, three
+# defined functions returning 10, 20 and 30, and no name section, so fn_1 is the
+# function at index 3 that returns 20
+do_filter_test () {
+	wasmdec -o test.c --only fn_1 wasm/imports.wasm && grep -q "20" test.c && ! grep -q "30" test.c
+	if [ $? -eq 0 ]; then
+		echo "TEST SUCCESS: filter test passed"
+	else
+		echo "TEST FAIL: filter test decoded the wrong bodies"
+		exit 1
+	fi
+	rm -f test.c
+}
+
+do_filter_test
+
+# compilable output must build with the system C compiler
+do_compile_test () {
+	wasmdec -o test.c --compilable $1 && cc -std=gnu99 -c test.c -o test.o
+	if [ $? -eq 0 ]; then
+		echo "TEST SUCCESS: compilable test $1 passed"
+	else
+		echo "TEST FAIL: compilable test $1 failed to build"
+		exit 1
+	fi
+	rm -f test.c test.o
+}
+
+do_compile_test "wasm/emcc.wasm"
+do_compile_test "wasm/funcs.wasm"
+do_compile_test "wasm/switch.wasm"
+do_compile_test "wast-tests/addTwo.wast"
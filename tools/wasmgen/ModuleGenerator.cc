@@ -0,0 +1,181 @@
+#include "ModuleGenerator.h"
+#include "wasm-binary.h"
+using namespace wasmdec;
+
+namespace {
+	const BinaryOp valueOps[] = { AddInt32, SubInt32, MulInt32, AndInt32, OrInt32, XorInt32, ShlInt32, ShrUInt32 };
+	const uint32_t dataOffset = 1024; // Where the data segment is placed in memory
+	const size_t maxTableSize = 1024;
+	Name functionName(size_t index) {
+		return Name("f" + to_string(index));
+	}
+}
+
+ModuleGenerator::ModuleGenerator(GeneratorOptions _options)
+: options(_options) { }
+
+void ModuleGenerator::generate(Module& _module) {
+	module = &_module;
+	builder.reset(new Builder(*module));
+	rng.seed(options.seed);
+	type = new FunctionType();
+	type->name = Name("ii_i");
+	type->params = { i32, i32 };
+	type->result = i32;
+	module->addFunctionType(type);
+
+	// Memory always exists, since functions store to it; it grows to fit the data
+	module->memory.exists = true;
+	module->memory.initial = (dataOffset + options.dataSize + Memory::kPageSize - 1) / Memory::kPageSize;
+	if (options.dataSize) {
+		vector<char> data(options.dataSize);
+		for (auto& byte : data) {
+			// Mostly text, like the string constants of a compiled program
+			byte = chance(0.75) ? (char)(' ' + random(95)) : (char)random(256);
+		}
+		module->memory.segments.push_back(Memory::Segment(builder->makeConst(Literal(int32_t(dataOffset))), &data[0], data.size()));
+	}
+	// Indirect calls need a table; it holds the first functions of the module
+	tableSize = options.callDensity > 0 ? min(options.functions, maxTableSize) : 0;
+	if (tableSize) {
+		vector<Name> entries;
+		for (size_t i = 0; i < tableSize; ++i) {
+			entries.push_back(functionName(i));
+		}
+		module->table.exists = true;
+		module->table.initial = module->table.max = tableSize;
+		module->table.segments.push_back(Table::Segment(builder->makeConst(Literal(int32_t(0))), entries));
+	}
+	for (size_t i = 0; i < options.functions; ++i) {
+		module->addFunction(makeFunction(i));
+		// The first function and every hundredth one after it are exported
+		if (i % 100 == 0) {
+			auto* exp = new Export();
+			exp->name = Name(i ? "export" + to_string(i) : string("main"));
+			exp->value = functionName(i);
+			exp->kind = ExternalKind::Function;
+			module->addExport(exp);
+		}
+	}
+	builder.reset();
+}
+vector<char> ModuleGenerator::generateBinary() {
+	Module generated;
+	generate(generated);
+	BufferWithRandomAccess buffer;
+	WasmBinaryWriter writer(&generated, buffer, false);
+	writer.write();
+	return vector<char>(buffer.begin(), buffer.end());
+}
+Function* ModuleGenerator::makeFunction(size_t index) {
+	labels = 0;
+	vector<Expression*> list;
+	// One statement reaches the full depth; the rest stay shallow
+	list.push_back(builder->makeSetLocal(randomLocal(), makeValue(options.depth)));
+	if (options.brTableWidth) {
+		list.push_back(makeSwitch());
+	}
+	for (size_t s = 1; s < options.statements; ++s) {
+		list.push_back(makeStatement());
+	}
+	list.push_back(builder->makeReturn(builder->makeGetLocal(randomLocal(), i32)));
+	vector<Type> vars(options.locals, i32);
+	Function* fn = Builder::makeFunction(functionName(index), { i32, i32 }, i32, move(vars), builder->makeBlock(list));
+	fn->type = type->name;
+	return fn;
+}
+Expression* ModuleGenerator::makeStatement() {
+	if (options.functions && chance(options.callDensity)) {
+		return builder->makeSetLocal(randomLocal(), makeCall());
+	}
+	size_t depth = 1 + random(min(options.depth, (size_t)3));
+	switch (random(4)) {
+		case 0:
+			return builder->makeSetLocal(randomLocal(), makeValue(depth));
+		case 1:
+			return builder->makeStore(4, 0, 4, builder->makeConst(Literal(int32_t(random(256) * 4))), makeValue(depth), i32);
+		case 2: {
+			Expression* condition = builder->makeBinary(LtSInt32, builder->makeGetLocal(randomLocal(), i32), makeLeaf());
+			Expression* ifFalse = chance(0.5) ? builder->makeSetLocal(randomLocal(), makeValue(depth)) : nullptr;
+			return builder->makeIf(condition, builder->makeSetLocal(randomLocal(), makeValue(depth)), ifFalse);
+		}
+		default: {
+			// A counting loop: local = local + 1 while local < limit
+			Name label = newLabel("loop");
+			Index counter = randomLocal();
+			vector<Expression*> body;
+			body.push_back(builder->makeSetLocal(counter, builder->makeBinary(AddInt32,
+				builder->makeGetLocal(counter, i32), builder->makeConst(Literal(int32_t(1))))));
+			body.push_back(builder->makeBreak(label, nullptr, builder->makeBinary(LtSInt32,
+				builder->makeGetLocal(counter, i32), builder->makeConst(Literal(int32_t(1 + random(100)))))));
+			return builder->makeLoop(label, builder->makeBlock(body));
+		}
+	}
+}
+Expression* ModuleGenerator::makeValue(size_t depth) {
+	Expression* value = makeLeaf();
+	for (size_t level = 1; level < depth; ++level) {
+		switch (random(8)) {
+			case 0:
+				value = builder->makeUnary(EqZInt32, value);
+				break;
+			case 1:
+				value = builder->makeSelect(makeLeaf(), value, makeLeaf());
+				break;
+			case 2:
+				value = builder->makeLoad(4, false, 0, 4, value, i32);
+				break;
+			case 3:
+				value = builder->makeBlock(value);
+				break;
+			default: {
+				BinaryOp op = valueOps[random(sizeof(valueOps) / sizeof(valueOps[0]))];
+				value = chance(0.5) ? builder->makeBinary(op, value, makeLeaf()) : builder->makeBinary(op, makeLeaf(), value);
+				break;
+			}
+		}
+	}
+	return value;
+}
+Expression* ModuleGenerator::makeLeaf() {
+	if (chance(0.5)) {
+		return builder->makeGetLocal(randomLocal(), i32);
+	}
+	return builder->makeConst(Literal(int32_t(random(1000))));
+}
+Expression* ModuleGenerator::makeCall() {
+	vector<Expression*> args = { makeLeaf(), makeLeaf() };
+	if (tableSize && random(4) == 0) {
+		return builder->makeCallIndirect(type, builder->makeConst(Literal(int32_t(random(tableSize)))), args);
+	}
+	return builder->makeCall(functionName(random(options.functions)), args, i32);
+}
+Expression* ModuleGenerator::makeSwitch() {
+	// block $default { block $caseN-1 { ... block $case0 { br_table } case 0 ... } case N-1 } default
+	vector<Name> targets;
+	for (size_t i = 0; i < options.brTableWidth; ++i) {
+		targets.push_back(newLabel("case"));
+	}
+	Name defaultTarget = newLabel("default");
+	Block* block = builder->makeBlock(targets[0], builder->makeSwitch(targets, defaultTarget, builder->makeGetLocal(0, i32)));
+	block->finalize();
+	for (size_t i = 1; i <= targets.size(); ++i) {
+		vector<Expression*> list = { block, builder->makeSetLocal(randomLocal(), makeLeaf()) };
+		block = builder->makeBlock(list);
+		block->name = i < targets.size() ? targets[i] : defaultTarget;
+		block->finalize();
+	}
+	return block;
+}
+Index ModuleGenerator::randomLocal() {
+	return random(2 + options.locals);
+}
+uint32_t ModuleGenerator::random(uint32_t bound) {
+	return bound ? rng() % bound : 0;
+}
+bool ModuleGenerator::chance(double p) {
+	return rng() < p * rng.max();
+}
+Name ModuleGenerator::newLabel(const char* prefix) {
+	return Name(prefix + to_string(labels++));
+}
@@ -0,0 +1,59 @@
+#ifndef _WASMDEC_MODULE_GENERATOR_H
+#define _WASMDEC_MODULE_GENERATOR_H
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include "wasm.h"
+#include "wasm-builder.h"
+using namespace std;
+using namespace wasm;
+
+namespace wasmdec {
+	// Shape of a generated module
+	struct GeneratorOptions {
+		size_t functions = 1000;
+		size_t locals = 4; // i32 locals of every function, besides its two parameters
+		size_t statements = 20; // Top level statements of every function
+		size_t depth = 4; // Nesting of the deepest expression in every function
+		size_t brTableWidth = 0; // Targets of a br_table in every function, 0 for none
+		size_t dataSize = 0; // Bytes in the data segment
+		double callDensity = 0.1; // Fraction of statements that are calls
+		uint32_t seed = 1;
+	};
+	// Builds valid modules of any size for scaling tests. Every function has the type
+	// (i32, i32) -> i32 and a random mix of local sets, stores, ifs, loops and calls,
+	// a quarter of them indirect through the table. The same options and seed always
+	// give the same module.
+	class ModuleGenerator {
+	public:
+		ModuleGenerator(GeneratorOptions);
+		void generate(Module&);
+		// The generated module in the binary format
+		vector<char> generateBinary();
+	protected:
+		Function* makeFunction(size_t index);
+		Expression* makeStatement();
+		// An i32 expression nested depth levels deep, built bottom up so any depth works
+		Expression* makeValue(size_t depth);
+		Expression* makeLeaf();
+		Expression* makeCall();
+		// A br_table to the given number of nested blocks, as a compiled switch looks
+		Expression* makeSwitch();
+		Index randomLocal();
+		uint32_t random(uint32_t bound);
+		bool chance(double);
+		Name newLabel(const char* prefix);
+
+		GeneratorOptions options;
+		mt19937 rng;
+		Module* module = nullptr;
+		unique_ptr<Builder> builder;
+		FunctionType* type = nullptr;
+		size_t tableSize = 0;
+		size_t labels = 0; // Labels used in the current function
+	};
+} // namespace wasmdec
+
+#endif // _WASMDEC_MODULE_GENERATOR_H
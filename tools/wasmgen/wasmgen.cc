@@ -0,0 +1,43 @@
+// Writes a synthetic WebAssembly module, for measuring how wasmdec scales with module
+// size, function size and nesting depth
+#include <fstream>
+#include <iostream>
+#include "cxxopts.hpp"
+#include "ModuleGenerator.h"
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	wasmdec::GeneratorOptions options;
+	string outfile = "out.wasm";
+	cxxopts::Options opt("wasmgen", "Synthetic WebAssembly module generator");
+	opt.add_options()
+		("o,output", "Output wasm file", cxxopts::value<string>(outfile))
+		("functions", "Number of functions (default 1000)", cxxopts::value<size_t>(options.functions))
+		("locals", "Locals of every function, besides its two parameters (default 4)", cxxopts::value<size_t>(options.locals))
+		("statements", "Top level statements of every function (default 20)", cxxopts::value<size_t>(options.statements))
+		("depth", "Nesting depth of the deepest expression of every function (default 4)", cxxopts::value<size_t>(options.depth))
+		("br-table", "Targets of a br_table in every function (default 0, none)", cxxopts::value<size_t>(options.brTableWidth))
+		("data", "Bytes in the data segment (default 0)", cxxopts::value<size_t>(options.dataSize))
+		("call-density", "Fraction of statements that are calls (default 0.1)", cxxopts::value<double>(options.callDensity))
+		("seed", "Random seed; the same options and seed give the same module (default 1)", cxxopts::value<uint32_t>(options.seed))
+		("h,help", "Print usage")
+		;
+	auto res = opt.parse(argc, argv);
+	if (res.count("h")) {
+		cout << opt.help({""}) << endl;
+		return 0;
+	}
+	if (options.depth < 1 || options.callDensity < 0 || options.callDensity > 1) {
+		cerr << "wasmgen: depth must be at least 1 and call density between 0 and 1" << endl;
+		return 1;
+	}
+	vector<char> binary = wasmdec::ModuleGenerator(options).generateBinary();
+	ofstream out(outfile, ios::binary);
+	out.write(binary.data(), binary.size());
+	if (!out) {
+		cerr << "wasmgen: can't write " << outfile << endl;
+		return 1;
+	}
+	cout << "Wrote " << options.functions << " functions, " << binary.size() << " bytes to " << outfile << endl;
+	return 0;
+}